@@ -1,8 +1,23 @@
 #!/bin/bash
+# btleshark.sh          capture with ubertooth-btle into the Wireshark GUI
+# btleshark.sh -a       the same, but only adverts with Apple data reach Wireshark
+# btleshark.sh -d DIR [continuity-capd options]
+#                       capture headless into a pcapng ring buffer in DIR,
+#                       using tools/continuity-capd (see tools/README.md)
 PIPE=/tmp/ble_pipe
+CAPD=${CAPD:-continuity-capd}
 if [ -p $PIPE ] ; then
     rm $PIPE
 fi
 mkfifo $PIPE
 ubertooth-btle -f -q $PIPE &
+if [ "$1" = "-d" ] ; then
+    DIR=${2:-.}
+    mkdir -p "$DIR"
+    exec $CAPD -r -w "$DIR/ble" -C 100 -W 100 -s "$DIR/stats.txt" "${@:3}" $PIPE
+fi
+if [ "$1" = "-a" ] ; then
+    $CAPD -A -w - $PIPE | wireshark -ni - -k -w $(date +%Y%m%d-%H%M%S)-ble.pcapng
+    exit
+fi
 wireshark -ni $PIPE -k -w $(date +%Y%m%d-%H%M%S)-ble.pcapng
@@ -0,0 +1,1736 @@
+/* packet-continuity.c
+ * Wireshark plugin for Apple's BLE Continuity protocol
+ *
+ * Registers on the btcommon.eir_ad.manufacturer_company_id table for Apple's
+ * company identifier (0x004C), so Continuity messages are decoded by a stock
+ * packet-bthci_cmd.c.  The TLV walk and field extraction live in
+ * libcontinuity/continuity.c; this file only builds the tree.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define WS_BUILD_DLL
+#include <wireshark.h>
+#include <epan/packet.h>
+#include <epan/expert.h>
+#include <epan/proto_data.h>
+#include <epan/stats_tree.h>
+#include <epan/tap.h>
+#include <epan/tfs.h>
+#include <wsutil/plugins.h>
+
+#include "continuity.h"
+
+#ifndef VERSION
+#define VERSION "0.0.0"
+#endif
+
+WS_DLL_PUBLIC_DEF const char plugin_version[] = VERSION;
+WS_DLL_PUBLIC_DEF const int plugin_want_major = WIRESHARK_VERSION_MAJOR;
+WS_DLL_PUBLIC_DEF const int plugin_want_minor = WIRESHARK_VERSION_MINOR;
+
+WS_DLL_PUBLIC void plugin_register(void);
+WS_DLL_PUBLIC uint32_t plugin_describe(void);
+
+/* Keys shared with packet-bluetooth.h and packet-bthci_cmd.c, whose headers
+ * are not part of the installed Wireshark development files.  The Flags and
+ * Tx Power context is only published by the patched 4.4.0 packet-bthci_cmd.c;
+ * without it no OS guess is made. */
+#define BLUETOOTH_DATA_SRC                          0
+#define PROTO_DATA_BLUETOOTH_EIR_AD_APPLE_CONTEXT   2
+
+static int proto_continuity;
+static int proto_bluetooth;
+static int proto_btcommon;
+
+static dissector_handle_t continuity_handle;
+
+static int continuity_handoff_tap;
+
+static expert_field ei_continuity_tlv_short;
+static expert_field ei_continuity_tlv_overlong;
+static expert_field ei_continuity_trailing;
+static expert_field ei_continuity_handoff_gap;
+static expert_field ei_continuity_handoff_reset;
+
+/* Hex public key strings, interned per capture file */
+static wmem_map_t *findmy_keys;
+
+/* Advertisers seen in the first pass, by address */
+static wmem_map_t *continuity_devices;
+
+static int ett_le_apple;
+static int ett_le_apple_tlv;
+static int ett_le_apple_device;
+static int ett_le_airpods;
+static int ett_le_airpods_battery;
+static int ett_le_airpods_charging;
+static int ett_le_airpods_case;
+
+/* Type-Length-Value Fields */
+static int hf_btcommon_apple_type;
+static int hf_btcommon_apple_length;
+
+/* 3 - AirPrint */
+static int hf_btcommon_apple_airprint_addrtype;
+static int hf_btcommon_apple_airprint_resourcepathtype;
+static int hf_btcommon_apple_airprint_securitytype;
+static int hf_btcommon_apple_airprint_qidport;
+static int hf_btcommon_apple_airprint_ipaddr;
+static int hf_btcommon_apple_airprint_power;
+
+/* 5 - AirDrop */
+static int hf_btcommon_apple_airdrop_prefix;
+static int hf_btcommon_apple_airdrop_version;
+static int hf_btcommon_apple_airdrop_appleid;
+static int hf_btcommon_apple_airdrop_phone;
+static int hf_btcommon_apple_airdrop_email;
+static int hf_btcommon_apple_airdrop_email2;
+static int hf_btcommon_apple_airdrop_suffix;
+
+/* 6 - HomeKit */
+static int hf_btcommon_apple_homekit_status;
+static int hf_btcommon_apple_homekit_deviceid;
+static int hf_btcommon_apple_homekit_category;
+static int hf_btcommon_apple_homekit_globalstatenum;
+static int hf_btcommon_apple_homekit_confignum;
+static int hf_btcommon_apple_homekit_compver;
+
+/* 7 - Proximity Pairing (AirPods) */
+static int hf_btcommon_apple_airpods_prefix;
+static int hf_btcommon_apple_airpods_devicemodel;
+static int hf_btcommon_apple_airpods_status;
+static int hf_btcommon_apple_airpods_leftbattery;
+static int hf_btcommon_apple_airpods_rightbattery;
+static int hf_btcommon_apple_airpods_leftcharging;
+static int hf_btcommon_apple_airpods_rightcharging;
+static int hf_btcommon_apple_airpods_casecharging;
+static int hf_btcommon_apple_airpods_casebattery;
+static int hf_btcommon_apple_airpods_opencount;
+static int hf_btcommon_apple_airpods_devicecolor;
+static int hf_btcommon_apple_airpods_suffix;
+static int hf_btcommon_apple_airpods_encdata;
+static int hf_btcommon_apple_airpods_battery_status;
+static int hf_btcommon_apple_airpods_charging_status;
+static int hf_btcommon_apple_airpods_casebattery_status;
+static int hf_btcommon_apple_airpods_battery_charging_status;
+
+/* 8 - "Hey Siri" */
+static int hf_btcommon_apple_siri_perphash;
+static int hf_btcommon_apple_siri_snr;
+static int hf_btcommon_apple_siri_confidence;
+static int hf_btcommon_apple_siri_deviceclass;
+static int hf_btcommon_apple_siri_randbyte;
+
+/* 9 - AirPlay Target */
+static int hf_btcommon_apple_airplay_flags;
+static int hf_btcommon_apple_airplay_seed;
+static int hf_btcommon_apple_airplay_ip;
+
+/* 10 - AirPlay Source */
+static int hf_btcommon_apple_airplay_data;
+
+/* 11 - Magic Switch */
+static int hf_btcommon_apple_magicswitch_data;
+static int hf_btcommon_apple_magicswitch_confidence;
+
+/* 12 - Handoff */
+static int hf_btcommon_apple_handoff_copy;
+static int hf_btcommon_apple_handoff_seqnum;
+static int hf_btcommon_apple_handoff_authtag;
+static int hf_btcommon_apple_handoff_encdata;
+static int hf_btcommon_apple_handoff_event;
+static int hf_btcommon_apple_handoff_seqnum_delta;
+static int hf_btcommon_apple_handoff_missed;
+static int hf_btcommon_apple_handoff_rollover;
+static int hf_btcommon_apple_handoff_rate;
+
+/* 13 - Tethering Target (Wi-Fi Settings Page) */
+static int hf_btcommon_apple_tethtgt_icloudid;
+
+/* 14 - Tethering Source (Instant Hotspot) */
+static int hf_btcommon_apple_tethsrc_version;
+static int hf_btcommon_apple_tethsrc_flags;
+static int hf_btcommon_apple_tethsrc_battery;
+static int hf_btcommon_apple_tethsrc_celltype;
+static int hf_btcommon_apple_tethsrc_cellbars;
+
+/* 15 - Nearby Action (Wi-Fi Join) */
+static int hf_btcommon_apple_nearbyaction_flags;
+static int hf_btcommon_apple_nearbyaction_flags_authtag;
+static int hf_btcommon_apple_nearbyaction_type;
+static int hf_btcommon_apple_nearbyaction_auth;
+static int hf_btcommon_apple_nearbyaction_setup_device_class;
+static int hf_btcommon_apple_nearbyaction_setup_device_model;
+static int hf_btcommon_apple_nearbyaction_setup_device_color;
+static int hf_btcommon_apple_nearbyaction_setup_msg_version;
+static int hf_btcommon_apple_nearbyaction_wifijoin_ssid;
+static int hf_btcommon_apple_nearbyaction_wifijoin_appleid;
+static int hf_btcommon_apple_nearbyaction_wifijoin_phonenumber;
+static int hf_btcommon_apple_nearbyaction_wifijoin_email;
+static int hf_btcommon_apple_nearbyaction_data;
+
+/* 16 - Nearby Info */
+static int hf_btcommon_apple_nearbyinfo_statusflags;
+static int hf_btcommon_apple_nearbyinfo_airdrop_status;
+static int hf_btcommon_apple_nearbyinfo_unk_flag; //seen with iPhone 11
+static int hf_btcommon_apple_nearbyinfo_unk_flag2;
+static int hf_btcommon_apple_nearbyinfo_primary_device;
+static int hf_btcommon_apple_nearbyinfo_action_code;
+static int hf_btcommon_apple_nearbyinfo_os;
+static int hf_btcommon_apple_nearbyinfo_dataflags;
+static int hf_btcommon_apple_nearbyinfo_autounlock_enabled;
+static int hf_btcommon_apple_nearbyinfo_autounlock_watch;
+static int hf_btcommon_apple_nearbyinfo_watch_locked;
+static int hf_btcommon_apple_nearbyinfo_authtag_present;
+static int hf_btcommon_apple_nearbyinfo_unk_flag3;
+static int hf_btcommon_apple_nearbyinfo_wifi_status;
+static int hf_btcommon_apple_nearbyinfo_authtag_fourbyte;
+static int hf_btcommon_apple_nearbyinfo_airpod_conn;
+static int hf_btcommon_apple_nearbyinfo_auth;
+static int hf_btcommon_apple_nearbyinfo_postauth;
+
+/* 18 - Find My Message */
+static int hf_btcommon_apple_findmy_status;
+static int hf_btcommon_apple_findmy_publickey;
+static int hf_btcommon_apple_findmy_publickeybits;
+static int hf_btcommon_apple_findmy_hint;
+static int hf_btcommon_apple_findmy_data;
+static int hf_btcommon_apple_findmy_publickeyxcoord;
+
+/* Unknown data fields */
+static int hf_btcommon_apple_data;
+
+/* Generated per-device links */
+static int hf_btcommon_apple_device;
+static int hf_btcommon_apple_device_prev_frame;
+static int hf_btcommon_apple_device_next_frame;
+static int hf_btcommon_apple_device_delta_time;
+static int hf_btcommon_apple_device_msg_count;
+static int hf_btcommon_apple_device_prev_type_frame;
+static int hf_btcommon_apple_device_next_type_frame;
+
+/* Format Identifier */
+static const value_string apple_vals[] = {
+    {  1, "Observed on iOS" },
+    {  2, "iBeacon" },
+    {  3, "AirPrint" },
+    {  5, "AirDrop" },
+    {  6, "Homekit" },
+    {  7, "AirPods (Proximity Pairing)" },
+    {  8, "Hey Siri" },
+    {  9, "AirPlay Destination" },
+    { 10, "AirPlay Source" },
+    { 11, "Magic Switch" },
+    { 12, "Handoff" },
+    { 13, "Tethering Target (Wi-Fi Settings)" },
+    { 14, "Tethering Source (Instant Hotspot)" },
+    { 15, "Nearby Action" },
+    { 16, "Nearby Info" },
+    { 18, "Find My Message" }, 
+    { 0, NULL }
+};
+
+static const value_string action_vals[] = {
+    {  0, "Activity Level Unknown" },
+    {  1, "Activity Reporting Disabled (Recently Updated/iPhone Setup)" },
+    {  2, "Apple iOS 13.6 Bug" },
+    {  3, "Locked Phone" },
+    {  4, "Apple iOS 13.6 Bug" },
+    {  5, "Audio is Playing with Screen off" }, /* Never Observed */
+    {  6, "Apple iOS 13.6 Bug" },
+    {  7, "Transition to Inactive User or from Locked Screen" },
+    {  8, "Apple iOS 13.6 Bug" },
+    {  9, "Screen is on and Video is playing" }, /* Never Observed */
+    { 10, "Locked Phone; Push Notifications to Watch" },
+    { 11, "Active User" },
+    { 12, "Apple iOS 13.6 Bug" },
+    { 13, "User is Driving a Vehicle (CarPlay)"},
+    { 14, "Phone/FaceTime Call" },
+    { 15, "Apple iOS 13.6 Bug" },
+    { 16, "Apple iOS 13.6 Bug" },
+    { 0, NULL }
+};
+
+static const value_string cellular_type_vals[] = {
+    { 0x0, "4G (GSM)" },
+    { 0x1, "1xRTT" },
+    { 0x2, "GPRS" },
+    { 0x3, "EDGE" },
+    { 0x4, "3G (EV-DO)" },
+    { 0x5, "3G" },
+    { 0x6, "4G" },
+    { 0x7, "LTE" },
+    { 0, NULL }
+};
+
+static const value_string nearbyaction_type_vals[] = {
+    { 0x01, "Apple TV Tap-To-Setup" },
+    { 0x04, "Mobile Backup" },
+    { 0x05, "Watch Setup" },
+    { 0x06, "Apple TV Pair" },
+    { 0x07, "Internet Relay" },
+    { 0x08, "Wi-Fi Password" },
+    { 0x09, "iOS Setup" },
+    { 0x0A, "Repair" },
+    { 0x0B, "Speaker Setup" },
+    { 0x0C, "Apple Pay" },
+    { 0x0D, "Whole Home Audio Setup" },
+    { 0x0E, "Developer Tools Pairing Request" },
+    { 0x0F, "Answered Call" },
+    { 0x10, "Ended Call" },
+    { 0x11, "DD Ping" },
+    { 0x12, "DD Pong" },
+    { 0x13, "Remote Auto Fill" },
+    { 0x14, "Companion Link Prox" },
+    { 0x15, "Remote Management" },
+    { 0x16, "Remote Auto Fill Pong" },
+    { 0x17, "Remote Display" },    
+    { 0, NULL }
+};
+
+static const value_string device_class_vals[] = {
+    { 0x2,  "iPhone" },
+    { 0x4,  "iPod" },
+    { 0x6,  "iPad" },
+    { 0x8,  "Audio accessory (HomePod)" },
+    { 0xA,  "Mac" },
+    { 0xC,  "AppleTV" },
+    { 0xE,  "Watch" },
+    { 0,    NULL }
+};
+
+static const value_string device_model_vals[] = {
+    { 0x0, "5, 6, 7, 8, SE (2nd Gen)" }, 
+    { 0x1, "D22 (X, XS, XSMax)" }, 
+    { 0x2, "SE (1st Gen)" },
+    { 0x3, "JEXX" },    
+    { 0, NULL }
+};
+
+static const value_string device_color_vals[] = {
+    { 0x00, "Unknown" },
+    { 0x01, "Black" },
+    { 0x02, "White" },
+    { 0x03, "Red" },
+    { 0x04, "Silver" },
+    { 0x05, "Pink" },
+    { 0x06, "Blue" },
+    { 0x07, "Yellow" },
+    { 0x08, "Gold" },
+    { 0x09, "Sparrow" },
+    { 0, NULL }
+};
+
+static const value_string airpods_status_vals[] = {
+    { 0x2b, "Both AirPods in ear" },
+    { 0x0b, "Both AirPods in ear" }, 
+    { 0x01, "AirPods: Both out of case, not in ear" }, 
+    { 0x21, "Both taken out of ears, Pause Audio" }, 
+    { 0x02, "Right in ear, Left in case" }, 
+    { 0x22, "Left in ear, Right in case" },
+    { 0x75, "Case: Both AirPods in case" }, 
+    { 0x55, "Case: Both AirPods in case" }, 
+    { 0x03, "AirPods: Right in ear, Left out of case" }, 
+    { 0x23, "AirPods: Left in ear, Right out of case" }, 
+    { 0x33, "AirPods: Left in ear, Right in case" }, 
+    { 0x53, "Case: Left in ear, Right in case" }, 
+    { 0x13, "AirPods: Right in ear, Left in case" }, 
+    { 0x73, "Case: Right in ear, Left in case" }, 
+    { 0x11, "AirPods: Right out of case, Left in case" }, 
+    { 0x71, "Case: Right out of case, Left in case" }, 
+    { 0x31, "AirPods: Left out of case, Right in case" },
+    { 0x51, "Case: Left out of case, Right in case" },
+    { 0, NULL}
+};
+
+static const value_string airpods_device_vals[] = {
+    { 0x0220, "AirPods 1" },
+    { 0x0f20, "AirPods 2" },
+    { 0x0e20, "AirPods Pro" },
+    { 0x0320, "Powerbeats3" },
+    { 0x0520, "BeatsX" },
+    { 0x0620, "Beats Solo 3" },
+    { 0, NULL}
+};
+
+static const value_string airpods_color_vals[] = {
+    { 0x00, "White" },
+    { 0x01, "Black" },
+    { 0x02, "Red" },
+    { 0x03, "Blue" },
+    { 0x04, "Pink" },
+    { 0x05, "Gray" },
+    { 0x06, "Silver" },
+    { 0x07, "Gold" },
+    { 0x08, "Rose Gold" },
+    { 0x09, "Space Gray" },
+    { 0x0A, "Dark Blue" },
+    { 0x0B, "Light Blue" },
+    { 0x0C, "Yellow" },
+    { 0, NULL }
+};
+
+static const value_string siri_device_vals[] = {
+    { 0x0002, "iPhone" }, 
+    { 0x0003, "iPad" }, 
+    { 0x0007, "HomePod" },
+    { 0x0009, "MacBook" },
+    { 0x000A, "Watch" }, 
+    { 0, NULL}
+};
+
+static const value_string wrist_confidence_vals[] = {
+    { 0x03, "Not on Wrist" }, 
+    { 0x1F, "Wrist detection disabled" }, 
+    { 0x3F, "On Wrist" },
+    { 0, NULL}
+};
+
+static const value_string findmy_status_vals[] = {
+    { 0x00, "Owner did not connect within key rotation period (15 min.)" }, 
+    { 0xe4, "Owner connected with key roation period, Battery Critically Low" }, 
+    { 0xa4, "Owner connected with key roation period, Battery Low" },
+    { 0x64, "Owner connected with key roation period, Battery Medium" },
+    { 0x24, "Owner connected with key roation period, Battery Full" },
+    { 0, NULL}
+};
+
+static const value_string findmy_publickeybits_vals[] = {
+    { 0x00, "bits 6 & 7 not set in public key" }, 
+    { 0x01, "bit 6 set in public key" }, 
+    { 0x02, "bit 7 set in public key" },
+    { 0x03, "bits 6 & 7 set in public key" },
+    { 0, NULL}
+};
+
+/* How a Handoff sequence number follows the device's previous one */
+typedef enum {
+    HANDOFF_FIRST,      /* first Handoff message from the device */
+    HANDOFF_REPEAT,     /* same activity advertised again */
+    HANDOFF_NEXT,       /* one newer */
+    HANDOFF_GAP,        /* newer, with sequence numbers missed */
+    HANDOFF_RESET,      /* older: the counter started over */
+    HANDOFF_EVENTS
+} handoff_event_t;
+
+static const value_string handoff_event_vals[] = {
+    { HANDOFF_FIRST,    "First Seen" },
+    { HANDOFF_REPEAT,   "Repeat" },
+    { HANDOFF_NEXT,     "Next Activity" },
+    { HANDOFF_GAP,      "Gap" },
+    { HANDOFF_RESET,    "Reset" },
+    { 0, NULL }
+};
+
+static const value_string homekit_category_vals[] = {
+    { 0x0000, "Unknown" },
+    { 0x0100, "Other" },
+    { 0x0200, "Bridge" },
+    { 0x0300, "Fan" },
+    { 0x0400, "Garage Door Opener" },
+    { 0x0500, "Lightbulb" },
+    { 0x0600, "Door Lock" },
+    { 0x0700, "Outlet" },
+    { 0x0800, "Switch" },
+    { 0x0900, "Thermostat" }, 
+    { 0x0A00, "Sensor" },
+    { 0x0B00, "Security System" },
+    { 0x0C00, "Door" },
+    { 0x0D00, "Window" },
+    { 0x0E00, "Window Covering" },
+    { 0x0F00, "Programmable Switch" },
+    { 0x1000, "Range Extender" },
+    { 0x1100, "IP Camera" },
+    { 0x1200, "Video Doorbell" },
+    { 0x1300, "Air Purifier" },
+    { 0x1400, "Heater" },
+    { 0x1500, "Air Conditioner" },
+    { 0x1600, "Humidifier" }, 
+    { 0x1700, "Dehumidifier" },
+    { 0x1C00, "Sprinklers" },
+    { 0x1D00, "Faucets" },
+    { 0x1E00, "Shower Systems" },
+    { 0, NULL }
+};
+
+/* Field descriptors for the fixed Apple message layouts, generated from
+ * libcontinuity/continuity_layouts.h, which continuity_fields.c walks for
+ * offline tools.  Offsets are relative to the start of the layout; a
+ * length of 0 runs to the end of the value.  A field with an ett opens a
+ * subtree that holds the following fields of the next depth. */
+#define APPLE_FIELD_REST        0
+#define APPLE_FIELD_MAX_DEPTH   2
+
+#define APPLE_ENC_BE            ENC_BIG_ENDIAN
+#define APPLE_ENC_LE            ENC_LITTLE_ENDIAN
+
+typedef struct {
+    int        *hf;
+    uint8_t     offset;
+    uint8_t     length;
+    uint32_t    encoding;
+    uint8_t     depth;
+    int        *ett;
+} apple_field_t;
+
+typedef struct {
+    const apple_field_t *fields;
+    unsigned             count;
+    uint8_t              min_length;    /* bytes needed for every field */
+} apple_layout_t;
+
+#define APPLE_LAYOUT(fields, min_length) { fields, array_length(fields), min_length }
+
+#define CONTINUITY_FIELD(hf, name, kind, offset, length, mask, endian, depth, ett) \
+    { &hf, offset, length, APPLE_ENC_##endian, depth, ett }
+#define CONTINUITY_LAYOUT(id, type, min_length, ...) \
+    static const apple_field_t apple_##id##_fields[] = { __VA_ARGS__ };
+#define CONTINUITY_PART_LAYOUT(id, min_length, ...) \
+    static const apple_field_t apple_##id##_fields[] = { __VA_ARGS__ }; \
+    static const apple_layout_t apple_##id##_layout = APPLE_LAYOUT(apple_##id##_fields, min_length);
+#include "continuity_layouts.h"
+
+/* Message types whose whole value is described by one table */
+#define CONTINUITY_FIELD(hf, name, kind, offset, length, mask, endian, depth, ett)
+#define CONTINUITY_LAYOUT(id, type, min_length, ...) \
+    [type] = APPLE_LAYOUT(apple_##id##_fields, min_length),
+#define CONTINUITY_PART_LAYOUT(id, min_length, ...)
+static const apple_layout_t apple_layouts[] = {
+#include "continuity_layouts.h"
+};
+
+/* Add the fields of one layout.  The value length is checked against the
+ * layout once; only a short value (AirPrint without Measured Power, Nearby
+ * Info without data flags) needs the per-field check. */
+static void
+add_apple_fields(proto_tree *tree, tvbuff_t *tvb, int offset, int length, const apple_layout_t *layout)
+{
+    proto_tree          *trees[APPLE_FIELD_MAX_DEPTH + 1];
+    proto_item          *item;
+    const apple_field_t *field = layout->fields;
+    const apple_field_t *end = layout->fields + layout->count;
+    int                  field_length;
+
+    trees[0] = tree;
+
+    if (length >= layout->min_length) {
+        for (; field < end; field++) {
+            field_length = field->length != APPLE_FIELD_REST ? field->length : length - field->offset;
+            item = proto_tree_add_item(trees[field->depth], *field->hf, tvb, offset + field->offset, field_length, field->encoding);
+            if (field->ett)
+                trees[field->depth + 1] = proto_item_add_subtree(item, *field->ett);
+        }
+        return;
+    }
+
+    for (; field < end; field++) {
+        if (field->offset + field->length > length)
+            break;
+        field_length = field->length != APPLE_FIELD_REST ? field->length : length - field->offset;
+        item = proto_tree_add_item(trees[field->depth], *field->hf, tvb, offset + field->offset, field_length, field->encoding);
+        if (field->ett)
+            trees[field->depth + 1] = proto_item_add_subtree(item, *field->ett);
+    }
+}
+
+/* Items are only worth building when the tree is shown or a filter, column
+ * or tap refers to an Apple field.  Priming a field for a filter also marks
+ * its protocol, so the protocol's own reference covers every field. */
+static bool
+apple_fields_referenced(proto_tree *tree)
+{
+    return tree && proto_field_is_referenced(tree, proto_continuity);
+}
+
+/* Where a frame sits among its advertiser's frames.  Filled in by the
+ * first pass, in frame order; next_frame and the next type links are set
+ * when the device is seen again, so a single pass (tshark without -2) only
+ * shows the backward links.  Frame numbers start at 1, so 0 means none. */
+typedef struct {
+    uint32_t    prev;
+    uint32_t    next;
+    uint8_t     type;
+} continuity_type_link_t;
+
+typedef struct {
+    uint32_t                frame;
+    uint32_t                prev_frame;
+    uint32_t                next_frame;
+    nstime_t                delta_time;     /* since prev_frame */
+    uint32_t                msg_count;      /* Apple frames from the device so far */
+    struct continuity_handoff_link *handoff;    /* NULL without a Handoff message */
+    unsigned                handoff_msg;
+    unsigned                type_count;
+    continuity_type_link_t  types[];        /* one per decoded message */
+} continuity_device_link_t;
+
+/* A frame's Handoff sequence number against the device's previous one.
+ * Also the continuity.handoff tap data. */
+typedef struct continuity_handoff_link {
+    uint16_t    seqnum;
+    uint16_t    delta;          /* seqnum - previous seqnum, mod 2^16 */
+    uint8_t     event;          /* handoff_event_t */
+    bool        rollover;       /* counted up through 0xffff */
+    uint32_t    missed;         /* sequence numbers skipped */
+    double      rate;           /* activities per minute; < 0 if unknown */
+} continuity_handoff_link_t;
+
+/* The Handoff counter of one device: a fixed size, however long the
+ * capture.  rate counts every sequence number the counter moved through
+ * since it was first seen or last reset. */
+typedef struct {
+    bool        seen;
+    uint16_t    seqnum;
+    nstime_t    since;
+    uint32_t    advance;
+} continuity_handoff_state_t;
+
+/* Message types whose last frame is remembered; the ones defined so far
+ * stop at 0x12. */
+#define CONTINUITY_DEVICE_TYPES     32
+
+typedef struct {
+    uint8_t                     addr[6];
+    uint32_t                    msg_count;
+    continuity_device_link_t   *last;
+    nstime_t                    last_time;
+    continuity_device_link_t   *type_last[CONTINUITY_DEVICE_TYPES];
+    continuity_handoff_state_t  handoff;
+} continuity_device_t;
+
+/* Decoded messages of one Apple manufacturer entry.  Kept in file-scope
+ * proto data, keyed by the entry's offset in the frame, so refiltering and
+ * later passes reuse the first pass's walk and OS guess. */
+typedef struct {
+    continuity_os_t             os;
+    unsigned                    os_msg;
+    unsigned                    count;
+    uint16_t                    trailing;
+    continuity_device_link_t   *device;     /* NULL without a source address */
+    continuity_msg_t            msgs[];
+} continuity_cache_t;
+
+static unsigned
+continuity_device_hash(const void *k)
+{
+    return wmem_strong_hash((const uint8_t *) k, 6);
+}
+
+static gboolean
+continuity_device_equal(const void *a, const void *b)
+{
+    return memcmp(a, b, 6) == 0;
+}
+
+/* Follow the device's Handoff counter.  Sequence numbers are compared in
+ * serial number arithmetic (RFC 1982): up to half the space ahead is
+ * newer, anything else means the counter was reset. */
+static continuity_handoff_link_t *
+continuity_handoff_track(continuity_handoff_state_t *state, packet_info *pinfo, uint16_t seqnum)
+{
+    continuity_handoff_link_t  *handoff;
+    nstime_t                    elapsed;
+    double                      secs;
+
+    handoff = wmem_new0(wmem_file_scope(), continuity_handoff_link_t);
+    handoff->seqnum = seqnum;
+    handoff->delta = (uint16_t) (seqnum - state->seqnum);
+
+    if (!state->seen) {
+        handoff->event = HANDOFF_FIRST;
+        handoff->delta = 0;
+    } else if (handoff->delta == 0) {
+        handoff->event = HANDOFF_REPEAT;
+    } else if (handoff->delta < 0x8000) {
+        handoff->event = handoff->delta == 1 ? HANDOFF_NEXT : HANDOFF_GAP;
+        handoff->missed = handoff->delta - 1U;
+        handoff->rollover = seqnum < state->seqnum;
+        state->advance += handoff->delta;
+    } else {
+        handoff->event = HANDOFF_RESET;
+    }
+
+    if (handoff->event == HANDOFF_FIRST || handoff->event == HANDOFF_RESET) {
+        state->since = pinfo->abs_ts;
+        state->advance = 0;
+    }
+    state->seen = true;
+    state->seqnum = seqnum;
+
+    nstime_delta(&elapsed, &pinfo->abs_ts, &state->since);
+    secs = nstime_to_sec(&elapsed);
+    handoff->rate = secs > 0 ? state->advance * 60.0 / secs : -1;
+
+    return handoff;
+}
+
+/* Link the first dissection of an entry to the advertiser's previous frame
+ * and to the last frame holding each of its message types.  Only the
+ * first Apple entry of a frame is linked. */
+static continuity_device_link_t *
+continuity_device_link(packet_info *pinfo, const continuity_cache_t *cache)
+{
+    continuity_device_t        *device;
+    continuity_device_link_t   *link;
+    continuity_device_link_t   *prev;
+    address                    *src_addr;
+    unsigned                    i;
+    unsigned                    j;
+
+    src_addr = (address *) p_get_proto_data(wmem_file_scope(), pinfo, proto_bluetooth, BLUETOOTH_DATA_SRC);
+    if (!src_addr || src_addr->len != 6)
+        return NULL;
+
+    device = (continuity_device_t *) wmem_map_lookup(continuity_devices, src_addr->data);
+    if (!device) {
+        device = wmem_new0(wmem_file_scope(), continuity_device_t);
+        memcpy(device->addr, src_addr->data, sizeof(device->addr));
+        wmem_map_insert(continuity_devices, device->addr, device);
+    } else if (device->last && device->last->frame == pinfo->num) {
+        return NULL;
+    }
+
+    link = (continuity_device_link_t *) wmem_alloc0(wmem_file_scope(),
+            sizeof(continuity_device_link_t) + cache->count * sizeof(continuity_type_link_t));
+    link->frame = pinfo->num;
+    link->msg_count = ++device->msg_count;
+    link->type_count = cache->count;
+    if (device->last) {
+        link->prev_frame = device->last->frame;
+        nstime_delta(&link->delta_time, &pinfo->abs_ts, &device->last_time);
+        device->last->next_frame = pinfo->num;
+    }
+    device->last = link;
+    device->last_time = pinfo->abs_ts;
+
+    for (i = 0; i < cache->count; i++) {
+        uint8_t type = cache->msgs[i].type;
+
+        link->types[i].type = type;
+        if (type >= CONTINUITY_DEVICE_TYPES)
+            continue;
+
+        /* Every message of a type that repeats within the frame links to
+         * the same frames as the first, rather than to this frame */
+        prev = device->type_last[type];
+        if (prev == link) {
+            for (j = 0; link->types[j].type != type; j++)
+                ;
+            link->types[i].prev = link->types[j].prev;
+        } else if (prev) {
+            link->types[i].prev = prev->frame;
+            for (j = 0; j < prev->type_count; j++) {
+                if (prev->types[j].type == type)
+                    prev->types[j].next = pinfo->num;
+            }
+        }
+        device->type_last[type] = link;
+
+        if (type == CONTINUITY_TYPE_HANDOFF && !link->handoff && cache->msgs[i].status == CONTINUITY_MSG_OK) {
+            link->handoff = continuity_handoff_track(&device->handoff, pinfo, cache->msgs[i].u.handoff.seqnum);
+            link->handoff_msg = i;
+        }
+    }
+
+    return link;
+}
+
+static const continuity_cache_t *
+continuity_cache_get(tvbuff_t *tvb, packet_info *pinfo, int length)
+{
+    continuity_cache_t         *cache;
+    continuity_frame_t          frame;
+    const continuity_ad_ctx_t  *ad_ctx;
+    const uint8_t              *apple_data;
+    uint32_t                    key = (uint32_t) tvb_raw_offset(tvb);
+
+    cache = (continuity_cache_t *) p_get_proto_data(wmem_file_scope(), pinfo, proto_continuity, key);
+    if (cache)
+        return cache;
+
+    apple_data = tvb_get_ptr(tvb, 0, length);
+    continuity_decode(apple_data, length, &frame);
+
+    ad_ctx = (const continuity_ad_ctx_t *) p_get_proto_data(pinfo->pool, pinfo, proto_btcommon, PROTO_DATA_BLUETOOTH_EIR_AD_APPLE_CONTEXT);
+    if (ad_ctx)
+        continuity_infer_os(&frame, ad_ctx);
+
+    cache = (continuity_cache_t *) wmem_alloc(wmem_file_scope(),
+            sizeof(continuity_cache_t) + frame.count * sizeof(continuity_msg_t));
+    cache->os = frame.os;
+    cache->os_msg = frame.os_msg;
+    cache->count = frame.count;
+    cache->trailing = frame.trailing;
+    memcpy(cache->msgs, frame.msgs, frame.count * sizeof(continuity_msg_t));
+    cache->device = continuity_device_link(pinfo, cache);
+
+    p_add_proto_data(wmem_file_scope(), pinfo, proto_continuity, key, cache);
+
+    return cache;
+}
+
+/* A Find My tag repeats the same address and key for its whole rotation
+ * period, so the hex X coordinate is built once per (address, key bits,
+ * key bytes) and looked up afterwards. */
+typedef struct {
+    uint8_t     addr[6];
+    uint8_t     key_bits;
+    uint8_t     key[22];
+} findmy_key_id_t;
+
+static unsigned
+findmy_key_hash(const void *k)
+{
+    return wmem_strong_hash((const uint8_t *) k, sizeof(findmy_key_id_t));
+}
+
+static gboolean
+findmy_key_equal(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(findmy_key_id_t)) == 0;
+}
+
+static const char *
+findmy_key_string(const uint8_t *addr, const continuity_findmy_t *findmy)
+{
+    findmy_key_id_t     id;
+    findmy_key_id_t    *new_id;
+    uint8_t             key[CONTINUITY_FINDMY_KEY_LEN];
+    char               *key_str;
+
+    memcpy(id.addr, addr, sizeof(id.addr));
+    id.key_bits = findmy->key_bits;
+    memcpy(id.key, findmy->key, sizeof(id.key));
+
+    key_str = (char *) wmem_map_lookup(findmy_keys, &id);
+    if (key_str)
+        return key_str;
+
+    continuity_findmy_key(addr, findmy, key);
+    key_str = (char *) wmem_alloc(wmem_file_scope(), CONTINUITY_FINDMY_KEY_HEX_LEN + 1);
+    continuity_hex_encode(key, sizeof(key), key_str);
+
+    new_id = wmem_new(wmem_file_scope(), findmy_key_id_t);
+    *new_id = id;
+    wmem_map_insert(findmy_keys, new_id, key_str);
+
+    return key_str;
+}
+
+/* The generated Device subtree: where this frame sits among the
+ * advertiser's Apple frames. */
+static void
+add_device_links(proto_tree *tree, tvbuff_t *tvb, const continuity_device_link_t *link)
+{
+    proto_item *item;
+    proto_tree *device_tree;
+
+    item = proto_tree_add_item(tree, hf_btcommon_apple_device, tvb, 0, 0, ENC_NA);
+    proto_item_set_generated(item);
+    device_tree = proto_item_add_subtree(item, ett_le_apple_device);
+
+    if (link->prev_frame) {
+        item = proto_tree_add_uint(device_tree, hf_btcommon_apple_device_prev_frame, tvb, 0, 0, link->prev_frame);
+        proto_item_set_generated(item);
+        item = proto_tree_add_time(device_tree, hf_btcommon_apple_device_delta_time, tvb, 0, 0, &link->delta_time);
+        proto_item_set_generated(item);
+    }
+    if (link->next_frame) {
+        item = proto_tree_add_uint(device_tree, hf_btcommon_apple_device_next_frame, tvb, 0, 0, link->next_frame);
+        proto_item_set_generated(item);
+    }
+    item = proto_tree_add_uint(device_tree, hf_btcommon_apple_device_msg_count, tvb, 0, 0, link->msg_count);
+    proto_item_set_generated(item);
+}
+
+/* Flag a TLV the walk could not decode.  Validation happens in the walk,
+ * against the bytes actually present, so nothing here can throw; a TLV cut
+ * off by the snapshot length rather than by its own length gets no expert
+ * info.  item is NULL on the tree-less path. */
+static void
+continuity_msg_expert(packet_info *pinfo, proto_item *item, const continuity_msg_t *msg, int reported)
+{
+    if (msg->status == CONTINUITY_MSG_SHORT)
+        expert_add_info(pinfo, item, &ei_continuity_tlv_short);
+    else if (msg->status == CONTINUITY_MSG_TRUNCATED && CONTINUITY_VALUE_OFFSET(msg) + msg->length > reported)
+        expert_add_info(pinfo, item, &ei_continuity_tlv_overlong);
+}
+
+/* Flag a Handoff counter that skipped or went back.  item is NULL on the
+ * tree-less path. */
+static void
+continuity_handoff_expert(packet_info *pinfo, proto_item *item, const continuity_handoff_link_t *handoff)
+{
+    if (handoff->event == HANDOFF_GAP)
+        expert_add_info_format(pinfo, item, &ei_continuity_handoff_gap,
+                "Handoff sequence number skipped %u", handoff->missed);
+    else if (handoff->event == HANDOFF_RESET)
+        expert_add_info(pinfo, item, &ei_continuity_handoff_reset);
+}
+
+/* The generated Handoff counter fields, under the Handoff TLV */
+static void
+add_handoff_items(proto_tree *tree, tvbuff_t *tvb, packet_info *pinfo, const continuity_handoff_link_t *handoff)
+{
+    proto_item *item;
+    proto_item *event_item;
+
+    event_item = proto_tree_add_uint(tree, hf_btcommon_apple_handoff_event, tvb, 0, 0, handoff->event);
+    proto_item_set_generated(event_item);
+    if (handoff->event != HANDOFF_FIRST) {
+        item = proto_tree_add_uint(tree, hf_btcommon_apple_handoff_seqnum_delta, tvb, 0, 0, handoff->delta);
+        proto_item_set_generated(item);
+    }
+    if (handoff->missed) {
+        item = proto_tree_add_uint(tree, hf_btcommon_apple_handoff_missed, tvb, 0, 0, handoff->missed);
+        proto_item_set_generated(item);
+    }
+    if (handoff->rollover) {
+        item = proto_tree_add_boolean(tree, hf_btcommon_apple_handoff_rollover, tvb, 0, 0, handoff->rollover);
+        proto_item_set_generated(item);
+    }
+    if (handoff->rate >= 0) {
+        item = proto_tree_add_double(tree, hf_btcommon_apple_handoff_rate, tvb, 0, 0, handoff->rate);
+        proto_item_set_generated(item);
+    }
+    continuity_handoff_expert(pinfo, event_item, handoff);
+}
+
+/* Apple Continuity: the TLV walk and field extraction live in continuity.c,
+ * this only turns the decoded messages into tree items. */
+static int
+dissect_continuity(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_)
+{
+    const continuity_cache_t   *frame;
+    address                    *src_addr;
+    proto_item                 *apple_item;
+    proto_tree                 *apple_tree;
+    proto_tree                 *tlv_tree;
+    proto_item                 *tlv_item;
+    int                         offset = 0;
+    int                         length;
+    int                         reported;
+    unsigned                    i;
+
+    length = tvb_captured_length(tvb);
+    reported = tvb_reported_length_remaining(tvb, offset);
+    if (length < 2)
+        return 0;
+
+    frame = continuity_cache_get(tvb, pinfo, length);
+
+    if (frame->device && frame->device->handoff)
+        tap_queue_packet(continuity_handoff_tap, pinfo, frame->device->handoff);
+
+    /* Tree-less fast path: the cached walk already has the TLV boundaries,
+     * nearby action type, action code and Find My key bits; skip the key
+     * rebuild and all item creation. */
+    if (!apple_fields_referenced(tree)) {
+        for (i = 0; i < frame->count; i++)
+            continuity_msg_expert(pinfo, NULL, &frame->msgs[i], reported);
+        if (frame->trailing)
+            expert_add_info(pinfo, NULL, &ei_continuity_trailing);
+        if (frame->device && frame->device->handoff)
+            continuity_handoff_expert(pinfo, NULL, frame->device->handoff);
+        return length;
+    }
+
+    apple_item = proto_tree_add_item(tree, proto_continuity, tvb, offset, length, ENC_NA);
+    apple_tree = proto_item_add_subtree(apple_item, ett_le_apple);
+
+    if (frame->device)
+        add_device_links(apple_tree, tvb, frame->device);
+
+    src_addr = (address *) p_get_proto_data(wmem_file_scope(), pinfo, proto_bluetooth, BLUETOOTH_DATA_SRC);
+
+    for (i = 0; i < frame->count; i++) {
+        const continuity_msg_t *msg = &frame->msgs[i];
+        int                     msg_offset = offset + msg->offset;
+        int                     value_offset = offset + CONTINUITY_VALUE_OFFSET(msg);
+
+        tlv_item = proto_tree_add_item(apple_tree, hf_btcommon_apple_type, tvb, msg_offset, 1, ENC_NA);
+        tlv_tree = proto_item_add_subtree(tlv_item, ett_le_apple_tlv);
+        proto_tree_add_item(tlv_tree, hf_btcommon_apple_length, tvb, msg_offset + 1, 1, ENC_NA);
+
+        if (frame->device && frame->device->types[i].prev) {
+            proto_item *link_item = proto_tree_add_uint(tlv_tree, hf_btcommon_apple_device_prev_type_frame, tvb, 0, 0,
+                    frame->device->types[i].prev);
+            proto_item_set_generated(link_item);
+        }
+        if (frame->device && frame->device->types[i].next) {
+            proto_item *link_item = proto_tree_add_uint(tlv_tree, hf_btcommon_apple_device_next_type_frame, tvb, 0, 0,
+                    frame->device->types[i].next);
+            proto_item_set_generated(link_item);
+        }
+
+        if (i == 0 && frame->os == CONTINUITY_OS_MACOS) {
+            /* changed to 0,0 so it doesn't tie to byte */
+            proto_tree_add_string(tlv_tree, hf_btcommon_apple_nearbyinfo_os, tvb, 0, 0, continuity_os_name(frame->os));
+        } else if (i == 0 && frame->os == CONTINUITY_OS_IOS13) {
+            proto_tree_add_string(tlv_tree, hf_btcommon_apple_nearbyinfo_os, tvb, value_offset, 1, continuity_os_name(frame->os));
+        }
+
+        if (msg->status != CONTINUITY_MSG_OK) {
+            continuity_msg_expert(pinfo, tlv_item, msg, reported);
+            if (msg->value_len)
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_data, tvb, value_offset, msg->value_len, ENC_NA);
+            continue;
+        }
+
+        switch (msg->type) {
+        case CONTINUITY_TYPE_NEARBY_ACTION: {
+            const continuity_nearby_action_t *na = &msg->u.nearby_action;
+            int params_offset = value_offset + na->params_off;
+
+            if (na->short_form) {
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_nearbyaction_data, tvb, value_offset, msg->value_len, ENC_NA);
+                break;
+            }
+            add_apple_fields(tlv_tree, tvb, value_offset, msg->value_len, &apple_nearbyaction_header_layout);
+            if (na->has_auth)
+                add_apple_fields(tlv_tree, tvb, value_offset + 2, 3, &apple_nearbyaction_auth_layout);
+
+            if (na->has_params && na->type == CONTINUITY_NEARBY_ACTION_WIFI_PASSWORD)
+                add_apple_fields(tlv_tree, tvb, params_offset, na->params_len, &apple_nearbyaction_wifijoin_layout);
+            else if (na->has_params && na->type == CONTINUITY_NEARBY_ACTION_IOS_SETUP)
+                add_apple_fields(tlv_tree, tvb, params_offset, na->params_len, &apple_nearbyaction_setup_layout);
+            else if (na->params_len)
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_nearbyaction_data, tvb, params_offset, na->params_len, ENC_NA);
+            break;
+        }
+        case CONTINUITY_TYPE_NEARBY_INFO: {
+            const continuity_nearby_info_t *ni = &msg->u.nearby_info;
+
+            add_apple_fields(tlv_tree, tvb, value_offset, msg->value_len, &apple_nearbyinfo_status_layout);
+            if (!ni->has_data_flags)
+                break;
+
+            if (i == frame->os_msg && frame->os >= CONTINUITY_OS_IOS10 && frame->os <= CONTINUITY_OS_IOS12)
+                proto_tree_add_string(tlv_tree, hf_btcommon_apple_nearbyinfo_os, tvb, value_offset + 1, 1, continuity_os_name(frame->os));
+
+            if (ni->auth_len)
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_nearbyinfo_auth, tvb, value_offset + 2, ni->auth_len, ENC_NA);
+            if (ni->postauth_len)
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_nearbyinfo_postauth, tvb, value_offset + ni->postauth_off, ni->postauth_len, ENC_NA);
+            break;
+        }
+        case CONTINUITY_TYPE_FINDMY:
+            if (msg->u.findmy.form == CONTINUITY_FINDMY_FULL) {
+                add_apple_fields(tlv_tree, tvb, value_offset, msg->value_len, &apple_findmy_full_layout);
+                if (src_addr && src_addr->len == 6)
+                    proto_tree_add_string(tlv_tree, hf_btcommon_apple_findmy_publickeyxcoord, tvb, 0, 0,
+                            findmy_key_string((const uint8_t *) src_addr->data, &msg->u.findmy));
+            } else if (msg->u.findmy.form == CONTINUITY_FINDMY_SHORT) {
+                add_apple_fields(tlv_tree, tvb, value_offset, msg->value_len, &apple_findmy_short_layout);
+            } else {
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_findmy_data, tvb, value_offset, msg->value_len, ENC_NA);
+            }
+            break;
+        case CONTINUITY_TYPE_HANDOFF:
+            add_apple_fields(tlv_tree, tvb, value_offset, msg->value_len, &apple_layouts[msg->type]);
+            if (frame->device && frame->device->handoff && frame->device->handoff_msg == i)
+                add_handoff_items(tlv_tree, tvb, pinfo, frame->device->handoff);
+            break;
+        default:
+            if (msg->type < array_length(apple_layouts) && apple_layouts[msg->type].fields)
+                add_apple_fields(tlv_tree, tvb, value_offset, msg->value_len, &apple_layouts[msg->type]);
+            else
+                proto_tree_add_item(tlv_tree, hf_btcommon_apple_data, tvb, value_offset, msg->value_len, ENC_NA);
+            break;
+        }
+    }
+
+    if (frame->trailing) {
+        tlv_item = proto_tree_add_item(apple_tree, hf_btcommon_apple_data, tvb, length - frame->trailing, frame->trailing, ENC_NA);
+        expert_add_info(pinfo, tlv_item, &ei_continuity_trailing);
+    }
+
+    return length;
+}
+
+static void
+proto_register_continuity(void)
+{
+    static hf_register_info hf[] = {
+    { &hf_btcommon_apple_type,
+      { "Type", "btcommon.apple.type",
+        FT_UINT8, BASE_DEC, VALS(apple_vals), 0x0,
+        NULL, HFILL }
+    }, 
+    { &hf_btcommon_apple_length,
+      { "Length", "btcommon.apple.length",
+        FT_UINT8, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 3 - AirPrint */
+    { &hf_btcommon_apple_airprint_addrtype,
+      { "AirPrint Address Type", "btcommon.apple.airprint.addrtype",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airprint_resourcepathtype,
+      { "AirPrint Resource Path Type", "btcommon.apple.airprint.resourcepathtype",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airprint_securitytype,
+      { "AirPrint Security Type", "btcommon.apple.airprint.securitytype",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airprint_qidport,
+      { "AirPrint QID or TCP Port", "btcommon.apple.airprint.qidport",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airprint_ipaddr,
+      { "IP Address", "btcommon.apple.airprint.ipaddr",
+        FT_IPv6, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airprint_power,
+      { "Measured Power", "btcommon.apple.airprint.power",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 5 - AirDrop */
+    { &hf_btcommon_apple_airdrop_prefix,
+      { "AirDrop Prefix", "btcommon.apple.airdrop.prefix",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airdrop_version,
+      { "AirDrop Version", "btcommon.apple.airdrop.version",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airdrop_appleid,
+      { "First 2 Bytes SHA256(Apple ID)", "btcommon.apple.airdrop.appleid",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airdrop_phone,
+      { "First 2 Bytes SHA256(Phone Number)", "btcommon.apple.airdrop.phone",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airdrop_email,
+      { "First 2 Bytes SHA256(Email)", "btcommon.apple.airdrop.email",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airdrop_email2,
+      { "First 2 Bytes SHA256(Email 2)", "btcommon.apple.airdrop.email2",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airdrop_suffix,
+      { "AirDrop Suffix", "btcommon.apple.airdrop.suffix",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 6 - HomeKit */
+    { &hf_btcommon_apple_homekit_status,
+      { "Status Flags", "btcommon.apple.homekit.status",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_homekit_deviceid,
+      { "Device ID", "btcommon.apple.homekit.deviceid",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_homekit_category,
+      { "Category", "btcommon.apple.homekit.category",
+        FT_UINT16, BASE_HEX, homekit_category_vals, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_homekit_globalstatenum,
+      { "Global State Number", "btcommon.apple.homekit.globalstatenum",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_homekit_confignum,
+      { "Configuration Number", "btcommon.apple.homekit.confignum",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_homekit_compver,
+      { "Compatible Version", "btcommon.apple.homekit.compver",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 7 - Proximity Pairing (AirPods) */
+    { &hf_btcommon_apple_airpods_prefix,
+      { "AirPods Prefix", "btcommon.apple.airpods.prefix",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_devicemodel,
+      { "AirPods Device Model", "btcommon.apple.airpods.devicemodel",
+        FT_UINT16, BASE_HEX, airpods_device_vals, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_status,
+      { "AirPods Status", "btcommon.apple.airpods.status",
+        FT_UINT8, BASE_HEX, airpods_status_vals, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_leftbattery,
+      { "Left AirPod Battery (x10%)", "btcommon.apple.airpods.leftbattery",
+        FT_UINT8, BASE_DEC, NULL, 0x0F,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_rightbattery,
+      { "Right AirPod Battery (x10%)", "btcommon.apple.airpods.rightbattery",
+        FT_UINT8, BASE_DEC, NULL, 0xF0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_casecharging,
+      { "AirPods Case Charging", "btcommon.apple.airpods.casecharging",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x40,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_rightcharging,
+      { "Right AirPod Charging", "btcommon.apple.airpods.rightcharging",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x20,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_leftcharging,
+      { "Left AirPod Charging", "btcommon.apple.airpods.leftcharging",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x10,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_casebattery,
+      { "AirPod Case Battery (x10%)", "btcommon.apple.airpods.casebattery",
+        FT_UINT8, BASE_DEC, NULL, 0x0F,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_opencount,
+      { "AirPods Open Count", "btcommon.apple.airpods.opencount",
+        FT_UINT8, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_devicecolor,
+      { "AirPods Device Color", "btcommon.apple.airpods.devicecolor",
+        FT_UINT8, BASE_HEX, airpods_color_vals, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_suffix,
+      { "AirPods Suffix", "btcommon.apple.airpods.suffix",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_encdata,
+      { "AirPods Encrypted Data", "btcommon.apple.airpods.encdata",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_battery_status,
+      { "AirPods L/R Battery Level", "btcommon.apple.airpods.batterystatus",
+        FT_NONE, BASE_NONE, NULL, 0x00,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_charging_status,
+      { "AirPods Charging Status", "btcommon.apple.airpods.charingstatus",
+        FT_NONE, BASE_NONE, NULL, 0x00,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_casebattery_status,
+      { "AirPods Case Battery Level", "btcommon.apple.airpods.casebatterystatus",
+        FT_NONE, BASE_NONE, NULL, 0x00,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airpods_battery_charging_status,
+      { "AirPods Battery Levels & Charging Status", "btcommon.apple.airpods.batterychargingstatus",
+        FT_NONE, BASE_NONE, NULL, 0x00,
+        NULL, HFILL }
+    },
+    /* 8 - "Hey Siri" */
+    { &hf_btcommon_apple_siri_perphash,
+      { "Perceptual Hash", "btcommon.apple.siri.perphash",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_siri_snr,
+      { "Signal-to-Noise Ratio", "btcommon.apple.siri.snr",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_siri_confidence,
+      { "Confidence Level", "btcommon.apple.siri.confidence",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_siri_deviceclass,
+      { "Device Class", "btcommon.apple.siri.deviceclass",
+        FT_UINT16, BASE_HEX, siri_device_vals, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_siri_randbyte,
+      { "Random Byte", "btcommon.apple.siri.randbyte",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 9 - AirPlay Target */
+    { &hf_btcommon_apple_airplay_flags,
+      { "AirPlay Flags", "btcommon.apple.airplay.flags",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airplay_seed,
+      { "AirPlay Seed", "btcommon.apple.airplay.seed",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_airplay_ip,
+      { "AirPlay IPv4 Address", "btcommon.apple.airplay.ip",
+        FT_IPv4, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+	/* 10 - AirPlay Source  */
+    { &hf_btcommon_apple_airplay_data,
+      { "AirPlay Source Data", "btcommon.apple.airplay.data",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 11 - Magic Switch */
+    { &hf_btcommon_apple_magicswitch_data,
+      { "Data", "btcommon.apple.magicswitch.data",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_magicswitch_confidence,
+      { "Confidence on Wrist", "btcommon.apple.magicswitch.confidence",
+        FT_UINT8, BASE_HEX, wrist_confidence_vals, 0x0,
+        NULL, HFILL }
+    },
+    /* 12 - Handoff */
+    { &hf_btcommon_apple_handoff_copy,
+      { "Copy/Cut Performed", "btcommon.apple.handoff.copy",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x0f,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_handoff_seqnum,
+      { "IV (Sequence Number)", "btcommon.apple.handoff.seqnum",
+        FT_UINT16, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_handoff_authtag,
+      { "AES-GCM Auth Tag", "btcommon.apple.handoff.authtag",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_handoff_encdata,
+      { "Encrypted Handoff Data", "btcommon.apple.handoff.encdata",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_handoff_event,
+      { "Sequence", "btcommon.apple.handoff.event",
+        FT_UINT8, BASE_DEC, VALS(handoff_event_vals), 0x0,
+        "How the sequence number follows the device's previous Handoff message", HFILL }
+    },
+    { &hf_btcommon_apple_handoff_seqnum_delta,
+      { "Sequence Number Delta", "btcommon.apple.handoff.seqnum_delta",
+        FT_UINT16, BASE_DEC, NULL, 0x0,
+        "Sequence number minus the device's previous one, modulo 65536", HFILL }
+    },
+    { &hf_btcommon_apple_handoff_missed,
+      { "Missed Sequence Numbers", "btcommon.apple.handoff.missed",
+        FT_UINT32, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_handoff_rollover,
+      { "Rollover", "btcommon.apple.handoff.rollover",
+        FT_BOOLEAN, BASE_NONE, NULL, 0x0,
+        "The sequence number wrapped past 0xffff", HFILL }
+    },
+    { &hf_btcommon_apple_handoff_rate,
+      { "Activity Rate (per minute)", "btcommon.apple.handoff.rate",
+        FT_DOUBLE, BASE_NONE, NULL, 0x0,
+        "Sequence numbers per minute since the device was first seen or its counter reset", HFILL }
+    },
+    /* 13 - Tethering Target (Wi-Fi Settings Page) */
+    { &hf_btcommon_apple_tethtgt_icloudid,
+      { "iCloud ID", "btcommon.apple.tethtgt.icloudid",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 14 - Tethering Source (Instant Hotspot) */
+    { &hf_btcommon_apple_tethsrc_version,
+      { "Version", "btcommon.apple.tethsrc.version",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_tethsrc_flags,
+      { "Flags", "btcommon.apple.tethsrc.flags",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_tethsrc_battery,
+      { "Battery Life (%)", "btcommon.apple.tethsrc.battery",
+        FT_UINT8, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_tethsrc_celltype,
+      { "Cellular Connection Type", "btcommon.apple.tethsrc.celltype",
+        FT_UINT16, BASE_DEC, VALS(cellular_type_vals), 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_tethsrc_cellbars,
+      { "Cell Service Quality (Bars)", "btcommon.apple.tethsrc.cellbars",
+        FT_UINT8, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 15 - Nearby Action */
+    { &hf_btcommon_apple_nearbyaction_flags,
+      { "Nearby Action Flags", "btcommon.apple.nearbyaction.flags",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_flags_authtag,
+      { "Auth Tag Flag", "btcommon.apple.nearybaction.flags.authtag",
+        FT_BOOLEAN, 8, TFS(&tfs_present_absent), 0x80,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_type,
+      { "Nearby Action Type", "btcommon.apple.nearbyaction.type",
+        FT_UINT8, BASE_HEX, VALS(nearbyaction_type_vals), 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_auth,
+      { "Auth Tag", "btcommon.apple.nearbyaction.auth",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_wifijoin_ssid,
+      { "First 3 Bytes SHA256(SSID)", "btcommon.apple.nearbyaction.wifijoin.ssid",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_wifijoin_appleid,
+      { "First 3 Bytes SHA256(Apple ID)", "btcommon.apple.nearbyaction.wifijoin.appleid",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_wifijoin_phonenumber,
+      { "First 3 Bytes SHA256(Phone Number)", "btcommon.apple.nearbyaction.wifijoin.phonenumber",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_wifijoin_email,
+      { "First 3 Bytes SHA256(Email)", "btcommon.apple.nearbyaction.wifijoin.email",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_setup_device_class,
+      { "Device Class", "btcommon.apple.nearbyaction.setup.device_class",
+        FT_UINT8, BASE_HEX, VALS(device_class_vals), 0xF0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_setup_device_model,
+      { "iPhone Model", "btcommon.apple.nearbyaction.setup.device_model",
+        FT_UINT8, BASE_HEX, VALS(device_model_vals), 0x0F,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_setup_device_color,
+      { "Device Color", "btcommon.apple.nearbyaction.setup.device_color",
+        FT_UINT8, BASE_HEX, VALS(device_color_vals), 0x0,
+        NULL, HFILL }
+    },
+	{ &hf_btcommon_apple_nearbyaction_setup_msg_version,
+      { "Message Version", "btcommon.apple.nearbyaction.setup.msg_ver",
+        FT_UINT8, BASE_DEC, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyaction_data,
+      { "Unknown Data", "btcommon.apple.nearbyaction_data",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+	/* 16 - Nearby Info */
+    { &hf_btcommon_apple_nearbyinfo_statusflags,
+      { "Nearby Info Status Flags", "btcommon.apple.nearbyinfo.statusflags",
+      FT_UINT8, BASE_HEX, NULL, 0x0,
+      NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_primary_device,
+      { "Primary Device", "btcommon.apple.nearbyinfo.primary_device",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x10,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_unk_flag2,
+      { "unk Flag", "btcommon.apple.nearbyinfo.unk.flag2",
+        FT_BOOLEAN, 8, TFS(&tfs_on_off), 0x20,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_airdrop_status,
+      { "AirDrop Receiving Status", "btcommon.apple.nearbyinfo.airdrop_status",
+        FT_BOOLEAN, 8, TFS(&tfs_on_off), 0x40,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_unk_flag,
+      { "unk Flag", "btcommon.apple.nearbyinfo.unk.flag",
+        FT_BOOLEAN, 8, TFS(&tfs_on_off), 0x80,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_action_code,
+      { "Action Code", "btcommon.apple.nearbyinfo.action_code",
+        FT_UINT8, BASE_DEC, VALS(action_vals), 0x0F,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_dataflags,
+      { "Nearby Info Data Flags", "btcommon.apple.nearbyinfo.dataflags",
+        FT_UINT8, BASE_HEX, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_authtag_present,
+      { "Auth Tag Present", "btcommon.apple.nearbyinfo.authtag_present",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x10,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_watch_locked,
+      { "Watch Locked", "btcommon.apple.nearbyinfo.watch_locked",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x20,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_autounlock_watch,
+      { "Auto Unlock Watch", "btcommon.apple.nearbyinfo.autounlock_watch",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x40,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_autounlock_enabled,
+      { "Auto Unlock Enabled", "btcommon.apple.nearbyinfo.autounlock_enabled",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x80,
+        NULL, HFILL }
+    },
+	/* unk_flag2 may be iPhone/Mac vs IoT device */
+	/* Have only seen 0x00 from Apple TV */
+    { &hf_btcommon_apple_nearbyinfo_unk_flag3,
+      { "unk Flag", "btcommon.apple.nearbyinfo.unk.flag3",
+        FT_BOOLEAN, 8, TFS(&tfs_on_off), 0x08,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_wifi_status,
+      { "WiFi Status", "btcommon.apple.nearbyinfo.wifi_status",
+        FT_BOOLEAN, 8, TFS(&tfs_on_off), 0x04,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_authtag_fourbyte,
+      { "Four Byte Auth Tag", "btcommon.apple.nearbyinfo.authtag.fourbyte",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x02,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_airpod_conn,
+      { "AirPod Connection Status", "btcommon.apple.nearbyinfo.airpod.connection",
+        FT_BOOLEAN, 8, TFS(&tfs_yes_no), 0x01,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_nearbyinfo_os,
+      { "iOS Version", "btcommon.apple.nearbyinfo.os",
+        FT_STRING, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+	{ &hf_btcommon_apple_nearbyinfo_auth,
+      { "Auth Tag", "btcommon.apple.nearbyinfo.auth",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+	{ &hf_btcommon_apple_nearbyinfo_postauth,
+      { "Post Auth Tag Data", "btcommon.apple.nearbyinfo.postauth",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_data,
+      { "Unknown Data", "btcommon.apple.data",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* 18 - Find My Message */
+    { &hf_btcommon_apple_findmy_status,
+      { "FindMy Status", "btcommon.apple.findmy.status",
+        FT_UINT8, BASE_HEX, findmy_status_vals, 0xe4,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_findmy_publickey,
+      { "Bytes 6-27 of Public Key", "btcommon.apple.findmy.publickey",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_findmy_publickeybits,
+      { "Public Key Bits", "btcommon.apple.findmy.publickey.bits",
+        FT_UINT8, BASE_HEX, findmy_publickeybits_vals, 0x03,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_findmy_hint,
+      { "Byte 5 of BT_ADDR of Primary Key", "btcommon.apple.findmy.hint",
+        FT_UINT8, BASE_HEX, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_findmy_publickeyxcoord,
+      { "Public Key X Coordinate", "btcommon.apple.findmy.publickey.xcord",
+        FT_STRING, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_findmy_data,
+      { "Data", "btcommon.apple.findmy.data",
+        FT_BYTES, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    /* Generated per-device links */
+    { &hf_btcommon_apple_device,
+      { "Device", "btcommon.apple.device",
+        FT_NONE, BASE_NONE, NULL, 0x0,
+        "Apple frames from the same advertiser address", HFILL }
+    },
+    { &hf_btcommon_apple_device_prev_frame,
+      { "Previous Frame", "btcommon.apple.device.prev_frame",
+        FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+        "Previous Apple frame from this address", HFILL }
+    },
+    { &hf_btcommon_apple_device_next_frame,
+      { "Next Frame", "btcommon.apple.device.next_frame",
+        FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+        "Next Apple frame from this address", HFILL }
+    },
+    { &hf_btcommon_apple_device_delta_time,
+      { "Time Since Previous Frame", "btcommon.apple.device.delta_time",
+        FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+        NULL, HFILL }
+    },
+    { &hf_btcommon_apple_device_msg_count,
+      { "Frame Count", "btcommon.apple.device.msg_count",
+        FT_UINT32, BASE_DEC, NULL, 0x0,
+        "Apple frames from this address up to and including this one", HFILL }
+    },
+    { &hf_btcommon_apple_device_prev_type_frame,
+      { "Previous Frame With This Type", "btcommon.apple.device.prev_type_frame",
+        FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+        "Previous frame from this address with a message of this type", HFILL }
+    },
+    { &hf_btcommon_apple_device_next_type_frame,
+      { "Next Frame With This Type", "btcommon.apple.device.next_type_frame",
+        FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+        "Next frame from this address with a message of this type", HFILL }
+    }
+    };
+
+    static int *ett[] = {
+        &ett_le_apple,
+        &ett_le_apple_tlv,
+        &ett_le_apple_device,
+        &ett_le_airpods,
+        &ett_le_airpods_battery,
+        &ett_le_airpods_charging,
+        &ett_le_airpods_case
+    };
+
+    static ei_register_info ei[] = {
+        { &ei_continuity_tlv_short,     { "btcommon.apple.expert.short",     PI_MALFORMED, PI_WARN,  "TLV is shorter than its message layout", EXPFILL }},
+        { &ei_continuity_tlv_overlong,  { "btcommon.apple.expert.overlong",  PI_MALFORMED, PI_ERROR, "TLV length runs past the manufacturer data", EXPFILL }},
+        { &ei_continuity_trailing,      { "btcommon.apple.expert.trailing",  PI_UNDECODED, PI_NOTE,  "Undecoded data after the last TLV", EXPFILL }},
+        { &ei_continuity_handoff_gap,   { "btcommon.apple.expert.handoff_gap",   PI_SEQUENCE, PI_NOTE, "Handoff sequence numbers skipped", EXPFILL }},
+        { &ei_continuity_handoff_reset, { "btcommon.apple.expert.handoff_reset", PI_SEQUENCE, PI_WARN, "Handoff sequence number went back", EXPFILL }},
+    };
+
+    expert_module_t *expert_continuity;
+
+    proto_continuity = proto_register_protocol("Apple Continuity", "Continuity", "btcommon.apple");
+    proto_register_field_array(proto_continuity, hf, array_length(hf));
+    proto_register_subtree_array(ett, array_length(ett));
+    expert_continuity = expert_register_protocol(proto_continuity);
+    expert_register_field_array(expert_continuity, ei, array_length(ei));
+
+    findmy_keys = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), findmy_key_hash, findmy_key_equal);
+    continuity_devices = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), continuity_device_hash, continuity_device_equal);
+
+    continuity_handle = register_dissector("btcommon.apple", dissect_continuity, proto_continuity);
+
+    continuity_handoff_tap = register_tap("continuity.handoff");
+}
+
+/* Statistics > Bluetooth > Apple Handoff, or tshark -z continuity_handoff,tree:
+ * Handoff frames by how their sequence number moved, and the sequence
+ * numbers missed in gaps. */
+static const char *st_str_handoff = "Handoff Frames";
+static const char *st_str_rollover = "Rollovers";
+static const char *st_str_missed = "Missed Sequence Numbers";
+static int st_node_handoff = -1;
+
+static void
+handoff_stats_tree_init(stats_tree *st)
+{
+    int i;
+
+    st_node_handoff = stats_tree_create_node(st, st_str_handoff, 0, STAT_DT_INT, true);
+    for (i = 0; i < HANDOFF_EVENTS; i++)
+        stats_tree_create_node(st, val_to_str_const(i, handoff_event_vals, "Unknown"), st_node_handoff, STAT_DT_INT, false);
+    stats_tree_create_node(st, st_str_rollover, st_node_handoff, STAT_DT_INT, false);
+    stats_tree_create_node(st, st_str_missed, 0, STAT_DT_INT, false);
+}
+
+static tap_packet_status
+handoff_stats_tree_packet(stats_tree *st, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *p, tap_flags_t flags _U_)
+{
+    const continuity_handoff_link_t *handoff = (const continuity_handoff_link_t *) p;
+
+    tick_stat_node(st, st_str_handoff, 0, true);
+    tick_stat_node(st, val_to_str_const(handoff->event, handoff_event_vals, "Unknown"), st_node_handoff, false);
+    if (handoff->rollover)
+        tick_stat_node(st, st_str_rollover, st_node_handoff, false);
+    if (handoff->missed)
+        increase_stat_node(st, st_str_missed, 0, false, (int) handoff->missed);
+
+    return TAP_PACKET_REDRAW;
+}
+
+static void
+register_continuity_stats(void)
+{
+    stats_tree_register_plugin("continuity.handoff", "continuity_handoff", "Bluetooth/Apple Handoff", 0,
+            handoff_stats_tree_packet, handoff_stats_tree_init, NULL);
+}
+
+static void
+proto_reg_handoff_continuity(void)
+{
+    proto_bluetooth = proto_get_id_by_filter_name("bluetooth");
+    proto_btcommon = proto_get_id_by_filter_name("btcommon");
+
+    dissector_add_uint("btcommon.eir_ad.manufacturer_company_id", CONTINUITY_COMPANY_ID, continuity_handle);
+}
+
+void
+plugin_register(void)
+{
+    static proto_plugin plug;
+    static tap_plugin tap_plug;
+
+    plug.register_protoinfo = proto_register_continuity;
+    plug.register_handoff = proto_reg_handoff_continuity;
+    proto_register_plugin(&plug);
+
+    tap_plug.register_tap_listener = register_continuity_stats;
+    tap_register_plugin(&tap_plug);
+}
+
+uint32_t
+plugin_describe(void)
+{
+    return WS_PLUGIN_DESC_DISSECTOR | WS_PLUGIN_DESC_TAP_LISTENER;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
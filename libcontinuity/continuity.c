@@ -0,0 +1,556 @@
+/* continuity.c
+ * Standalone decoder for Apple Continuity manufacturer-specific data
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <string.h>
+
+#include "continuity.h"
+#include "continuity_values.h"
+
+/* AD types read by continuity_ad_payload() */
+#define AD_TYPE_FLAGS               0x01
+#define AD_TYPE_TX_POWER            0x0a
+#define AD_TYPE_MANUFACTURER        0xff
+
+static bool
+decode_airprint(continuity_airprint_t *m, const uint8_t *v, size_t len)
+{
+    if (len < AIRPRINT_MIN_LEN)
+        return false;
+
+    m->addr_type          = v[0];
+    m->resource_path_type = v[1];
+    m->security_type      = v[2];
+    m->qid_port           = GET_BE16(v + 3);
+    memcpy(m->ip_addr, v + 5, sizeof(m->ip_addr));
+    m->has_power = (len >= AIRPRINT_LEN);
+    m->power     = m->has_power ? v[21] : 0;
+
+    return true;
+}
+
+static bool
+decode_airdrop(continuity_airdrop_t *m, const uint8_t *v, size_t len)
+{
+    if (len < AIRDROP_LEN)
+        return false;
+
+    memcpy(m->prefix, v, sizeof(m->prefix));
+    m->version = v[8];
+    memcpy(m->appleid, v + 9, 2);
+    memcpy(m->phone, v + 11, 2);
+    memcpy(m->email, v + 13, 2);
+    memcpy(m->email2, v + 15, 2);
+    m->suffix = v[17];
+
+    return true;
+}
+
+static bool
+decode_homekit(continuity_homekit_t *m, const uint8_t *v, size_t len)
+{
+    if (len < HOMEKIT_LEN)
+        return false;
+
+    m->status = v[0];
+    memcpy(m->device_id, v + 1, sizeof(m->device_id));
+    m->category     = GET_BE16(v + 7);
+    m->global_state = GET_LE16(v + 9);
+    m->config_num   = v[11];
+    m->comp_ver     = v[12];
+
+    return true;
+}
+
+static bool
+decode_airpods(continuity_airpods_t *m, const uint8_t *v, size_t len)
+{
+    if (!continuity_airpods_ok(len))
+        return false;
+
+    m->prefix         = v[0];
+    m->model          = GET_BE16(v + 1);
+    m->status         = v[3];
+    m->right_battery  = v[4] >> 4;
+    m->left_battery   = v[4] & 0x0f;
+    m->case_charging  = (v[5] & 0x40) != 0;
+    m->right_charging = (v[5] & 0x20) != 0;
+    m->left_charging  = (v[5] & 0x10) != 0;
+    m->case_battery   = v[5] & 0x0f;
+    m->open_count     = v[6];
+    m->color          = v[7];
+    m->suffix         = v[8];
+    memcpy(m->encdata, v + 9, sizeof(m->encdata));
+
+    return true;
+}
+
+static bool
+decode_siri(continuity_siri_t *m, const uint8_t *v, size_t len)
+{
+    if (len < SIRI_LEN)
+        return false;
+
+    m->perphash     = GET_BE16(v);
+    m->snr          = v[2];
+    m->confidence   = v[3];
+    m->device_class = GET_BE16(v + 4);
+    m->randbyte     = v[6];
+
+    return true;
+}
+
+static bool
+decode_airplay_target(continuity_airplay_target_t *m, const uint8_t *v, size_t len)
+{
+    if (len < AIRPLAY_TARGET_LEN)
+        return false;
+
+    m->flags = v[0];
+    m->seed  = v[1];
+    memcpy(m->ip, v + 2, sizeof(m->ip));
+
+    return true;
+}
+
+static bool
+decode_airplay_source(continuity_airplay_source_t *m, const uint8_t *v, size_t len)
+{
+    if (len < AIRPLAY_SOURCE_LEN)
+        return false;
+
+    m->data = v[0];
+
+    return true;
+}
+
+static bool
+decode_magic_switch(continuity_magic_switch_t *m, const uint8_t *v, size_t len)
+{
+    if (len < MAGIC_SWITCH_LEN)
+        return false;
+
+    m->data       = GET_BE16(v);
+    m->confidence = v[2];
+
+    return true;
+}
+
+static bool
+decode_handoff(continuity_handoff_t *m, const uint8_t *v, size_t len)
+{
+    if (!continuity_handoff_ok(len))
+        return false;
+
+    m->copy        = v[0];
+    m->seqnum      = GET_LE16(v + 1);
+    m->authtag     = v[3];
+    m->encdata_len = (uint8_t)(len - HANDOFF_MIN_LEN);
+
+    return true;
+}
+
+static bool
+decode_tethering_target(continuity_tethering_target_t *m, const uint8_t *v, size_t len)
+{
+    (void)v;
+    m->icloudid_len = (uint8_t)len;
+
+    return true;
+}
+
+static bool
+decode_tethering_source(continuity_tethering_source_t *m, const uint8_t *v, size_t len)
+{
+    if (len < TETHERING_SOURCE_LEN)
+        return false;
+
+    m->version   = v[0];
+    m->flags     = v[1];
+    m->battery   = v[2];
+    m->cell_type = GET_BE16(v + 3);
+    m->cell_bars = v[5];
+
+    return true;
+}
+
+static bool
+decode_nearby_action(continuity_nearby_action_t *m, const uint8_t *v, size_t len)
+{
+    size_t  off;
+
+    memset(m, 0, sizeof(*m));
+
+    if (len == NEARBY_ACTION_SHORT_LEN) {
+        m->short_form = true;
+        return true;
+    }
+    if (len < NEARBY_ACTION_SHORT_LEN)
+        return false;
+
+    m->flags = v[0];
+    m->type  = v[1];
+    off = 2;
+    if (!continuity_nearby_action_ok(v, len))
+        return false;
+
+    if (m->flags & NEARBY_ACTION_FLAG_AUTH) {
+        m->has_auth = true;
+        memcpy(m->auth, v + off, NEARBY_ACTION_AUTH_LEN);
+        off += NEARBY_ACTION_AUTH_LEN;
+    }
+
+    m->params_off = (uint8_t)off;
+    m->params_len = (uint8_t)(len - off);
+
+    switch (m->type) {
+    case CONTINUITY_NEARBY_ACTION_WIFI_PASSWORD:
+        if (m->params_len >= NEARBY_ACTION_WIFI_LEN) {
+            memcpy(m->params.wifi_password.appleid, v + off, 3);
+            memcpy(m->params.wifi_password.phone, v + off + 3, 3);
+            memcpy(m->params.wifi_password.email, v + off + 6, 3);
+            memcpy(m->params.wifi_password.ssid, v + off + 9, 3);
+            m->has_params = true;
+        }
+        break;
+    case CONTINUITY_NEARBY_ACTION_IOS_SETUP:
+        if (m->params_len >= NEARBY_ACTION_SETUP_LEN) {
+            m->params.ios_setup.device_class = v[off] >> 4;
+            m->params.ios_setup.device_model = v[off] & 0x0f;
+            m->params.ios_setup.device_color = v[off + 1];
+            m->params.ios_setup.msg_version  = v[off + 2];
+            m->has_params = true;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+static bool
+decode_nearby_info(continuity_nearby_info_t *m, const uint8_t *v, size_t len)
+{
+    size_t  remaining;
+
+    memset(m, 0, sizeof(*m));
+
+    if (!continuity_nearby_info_ok(len))
+        return false;
+
+    m->status_flags = v[0] >> 4;
+    m->action_code  = v[0] & 0x0f;
+    if (len < 2)
+        return true;
+
+    m->has_data_flags = true;
+    m->data_flags     = v[1];
+
+    /* The auth tag is only there when flagged, and its length is flagged too */
+    remaining = len - 2;
+    if ((m->data_flags & NEARBY_INFO_FLAG_AUTH) && remaining > 0) {
+        m->auth_len = (m->data_flags & NEARBY_INFO_FLAG_AUTH4) ? 4 : 3;
+        if (m->auth_len > remaining)
+            m->auth_len = (uint8_t)remaining;
+        memcpy(m->auth, v + 2, m->auth_len);
+        m->postauth_off = (uint8_t)(2 + m->auth_len);
+        m->postauth_len = (uint8_t)(remaining - m->auth_len);
+    }
+
+    return true;
+}
+
+static bool
+decode_findmy(continuity_findmy_t *m, const uint8_t *v, size_t len)
+{
+    memset(m, 0, sizeof(*m));
+
+    m->form = continuity_findmy_form(len);
+    if (m->form == CONTINUITY_FINDMY_FULL) {
+        m->status   = v[0];
+        memcpy(m->key, v + 1, sizeof(m->key));
+        m->key_bits = v[23] & 0x03;
+        m->hint     = v[24];
+    } else if (m->form == CONTINUITY_FINDMY_SHORT) {
+        m->status   = v[0];
+        m->key_bits = v[1] & 0x03;
+    }
+
+    return true;
+}
+
+static bool
+decode_value(continuity_msg_t *msg, const uint8_t *v, size_t len)
+{
+    switch (msg->type) {
+    case CONTINUITY_TYPE_AIRPRINT:
+        return decode_airprint(&msg->u.airprint, v, len);
+    case CONTINUITY_TYPE_AIRDROP:
+        return decode_airdrop(&msg->u.airdrop, v, len);
+    case CONTINUITY_TYPE_HOMEKIT:
+        return decode_homekit(&msg->u.homekit, v, len);
+    case CONTINUITY_TYPE_AIRPODS:
+        return decode_airpods(&msg->u.airpods, v, len);
+    case CONTINUITY_TYPE_HEY_SIRI:
+        return decode_siri(&msg->u.siri, v, len);
+    case CONTINUITY_TYPE_AIRPLAY_TARGET:
+        return decode_airplay_target(&msg->u.airplay_target, v, len);
+    case CONTINUITY_TYPE_AIRPLAY_SOURCE:
+        return decode_airplay_source(&msg->u.airplay_source, v, len);
+    case CONTINUITY_TYPE_MAGIC_SWITCH:
+        return decode_magic_switch(&msg->u.magic_switch, v, len);
+    case CONTINUITY_TYPE_HANDOFF:
+        return decode_handoff(&msg->u.handoff, v, len);
+    case CONTINUITY_TYPE_TETHERING_TARGET:
+        return decode_tethering_target(&msg->u.tethering_target, v, len);
+    case CONTINUITY_TYPE_TETHERING_SOURCE:
+        return decode_tethering_source(&msg->u.tethering_source, v, len);
+    case CONTINUITY_TYPE_NEARBY_ACTION:
+        return decode_nearby_action(&msg->u.nearby_action, v, len);
+    case CONTINUITY_TYPE_NEARBY_INFO:
+        return decode_nearby_info(&msg->u.nearby_info, v, len);
+    case CONTINUITY_TYPE_FINDMY:
+        return decode_findmy(&msg->u.findmy, v, len);
+    default:
+        /* Types 1, 2 and anything unknown are carried as raw data */
+        return true;
+    }
+}
+
+unsigned
+continuity_decode(const uint8_t *buf, size_t len, continuity_frame_t *frame)
+{
+    size_t  offset = 0;
+
+    frame->count    = 0;
+    frame->trailing = 0;
+    frame->os       = CONTINUITY_OS_UNKNOWN;
+    frame->os_msg   = 0;
+
+    while (offset + 2 <= len && frame->count < CONTINUITY_MAX_MSGS) {
+        continuity_msg_t   *msg = &frame->msgs[frame->count++];
+        size_t              available = len - offset - 2;
+
+        msg->type   = buf[offset];
+        msg->length = buf[offset + 1];
+        msg->offset = (uint16_t)offset;
+        msg->status = CONTINUITY_MSG_OK;
+
+        if (msg->length > available) {
+            msg->status    = CONTINUITY_MSG_TRUNCATED;
+            msg->value_len = (uint16_t)available;
+        } else {
+            msg->value_len = msg->length;
+        }
+
+        if (!decode_value(msg, buf + offset + 2, msg->value_len) &&
+                msg->status == CONTINUITY_MSG_OK)
+            msg->status = CONTINUITY_MSG_SHORT;
+
+        offset += 2 + msg->value_len;
+    }
+
+    frame->trailing = (uint16_t)(len - offset);
+
+    return frame->count;
+}
+
+uint32_t
+continuity_type_mask(const uint8_t *buf, size_t len)
+{
+    uint32_t    mask = 0;
+    size_t      offset = 0;
+    unsigned    count = 0;
+
+    /* The same walk as continuity_decode(), without decoding any value */
+    while (offset + 2 <= len && count++ < CONTINUITY_MAX_MSGS) {
+        if (buf[offset] < 32)
+            mask |= CONTINUITY_TYPE_BIT(buf[offset]);
+        offset += 2 + (size_t)buf[offset + 1];
+    }
+
+    return mask;
+}
+
+bool
+continuity_manufacturer_payload(const uint8_t *data, size_t len,
+        const uint8_t **payload, size_t *payload_len)
+{
+    if (len < 2 || GET_LE16(data) != CONTINUITY_COMPANY_ID)
+        return false;
+
+    *payload     = data + 2;
+    *payload_len = len - 2;
+
+    return true;
+}
+
+bool
+continuity_ad_payload(const uint8_t *ad, size_t len, const uint8_t **payload,
+        size_t *payload_len, continuity_ad_ctx_t *ctx)
+{
+    size_t  offset = 0;
+
+    ctx->flags_reserved = -1;
+    ctx->has_tx_power   = false;
+
+    while (offset < len) {
+        size_t          entry_len = ad[offset];
+        const uint8_t  *value = ad + offset + 2;
+
+        /* A zero length ends the significant part */
+        if (entry_len == 0 || entry_len > len - offset - 1)
+            break;
+
+        switch (ad[offset + 1]) {
+        case AD_TYPE_FLAGS:
+            if (entry_len >= 2)
+                ctx->flags_reserved = value[0] >> 5;
+            break;
+        case AD_TYPE_TX_POWER:
+            ctx->has_tx_power = true;
+            break;
+        case AD_TYPE_MANUFACTURER:
+            if (continuity_manufacturer_payload(value, entry_len - 1, payload, payload_len))
+                return true;
+            break;
+        default:
+            break;
+        }
+        offset += 1 + entry_len;
+    }
+
+    return false;
+}
+
+void
+continuity_infer_os(continuity_frame_t *frame, const continuity_ad_ctx_t *ctx)
+{
+    bool        handoff_seen = false;
+    unsigned    i;
+
+    frame->os     = CONTINUITY_OS_UNKNOWN;
+    frame->os_msg = 0;
+
+    if (frame->count == 0)
+        return;
+
+    /* macOS sets reserved bits in the Flags entry; iOS 13 adds Tx Power */
+    if (ctx && ctx->flags_reserved == 0x06) {
+        frame->os = CONTINUITY_OS_MACOS;
+        return;
+    }
+    if (ctx && ctx->has_tx_power) {
+        frame->os = CONTINUITY_OS_IOS13;
+        return;
+    }
+
+    for (i = 0; i < frame->count; i++) {
+        const continuity_msg_t *msg = &frame->msgs[i];
+        uint8_t                 data_flags;
+
+        if (msg->type == CONTINUITY_TYPE_HANDOFF) {
+            handoff_seen = true;
+            continue;
+        }
+        if (msg->type != CONTINUITY_TYPE_NEARBY_INFO || !msg->u.nearby_info.has_data_flags)
+            continue;
+
+        data_flags = msg->u.nearby_info.data_flags;
+        if (!(data_flags & NEARBY_INFO_FLAG_AUTH)) {
+            frame->os = CONTINUITY_OS_IOS10;
+        } else if ((data_flags & 0x0f) == 0) {
+            /* iOS 11 has an auth tag but the low nibble is always 0 */
+            frame->os = CONTINUITY_OS_IOS11;
+        } else if (!handoff_seen) {
+            /* Handoff + Nearby Info in one frame is also seen on iOS 13 */
+            frame->os = CONTINUITY_OS_IOS12;
+        }
+        frame->os_msg = i;
+        return;
+    }
+}
+
+void
+continuity_findmy_key(const uint8_t addr[6], const continuity_findmy_t *findmy,
+        uint8_t key[CONTINUITY_FINDMY_KEY_LEN])
+{
+    memcpy(key, addr, 6);
+    key[0] = (uint8_t)((findmy->key_bits & 0x03) << 6) | (addr[0] & 0x3f);
+    memcpy(key + 6, findmy->key, sizeof(findmy->key));
+}
+
+/* Two hex digits per byte value, indexed by 2 * byte */
+#define HEX_ROW(h)  h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+                    h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+
+static const char hex_pairs[] =
+    HEX_ROW("0") HEX_ROW("1") HEX_ROW("2") HEX_ROW("3")
+    HEX_ROW("4") HEX_ROW("5") HEX_ROW("6") HEX_ROW("7")
+    HEX_ROW("8") HEX_ROW("9") HEX_ROW("a") HEX_ROW("b")
+    HEX_ROW("c") HEX_ROW("d") HEX_ROW("e") HEX_ROW("f");
+
+void
+continuity_hex_encode(const uint8_t *data, size_t len, char *out)
+{
+    size_t  i;
+
+    for (i = 0; i < len; i++) {
+        out[2 * i]     = hex_pairs[2 * data[i]];
+        out[2 * i + 1] = hex_pairs[2 * data[i] + 1];
+    }
+    out[2 * len] = '\0';
+}
+
+const char *
+continuity_type_name(uint8_t type)
+{
+    switch (type) {
+    case CONTINUITY_TYPE_IOS:               return "Observed on iOS";
+    case CONTINUITY_TYPE_IBEACON:           return "iBeacon";
+    case CONTINUITY_TYPE_AIRPRINT:          return "AirPrint";
+    case CONTINUITY_TYPE_AIRDROP:           return "AirDrop";
+    case CONTINUITY_TYPE_HOMEKIT:           return "Homekit";
+    case CONTINUITY_TYPE_AIRPODS:           return "AirPods (Proximity Pairing)";
+    case CONTINUITY_TYPE_HEY_SIRI:          return "Hey Siri";
+    case CONTINUITY_TYPE_AIRPLAY_TARGET:    return "AirPlay Destination";
+    case CONTINUITY_TYPE_AIRPLAY_SOURCE:    return "AirPlay Source";
+    case CONTINUITY_TYPE_MAGIC_SWITCH:      return "Magic Switch";
+    case CONTINUITY_TYPE_HANDOFF:           return "Handoff";
+    case CONTINUITY_TYPE_TETHERING_TARGET:  return "Tethering Target (Wi-Fi Settings)";
+    case CONTINUITY_TYPE_TETHERING_SOURCE:  return "Tethering Source (Instant Hotspot)";
+    case CONTINUITY_TYPE_NEARBY_ACTION:     return "Nearby Action";
+    case CONTINUITY_TYPE_NEARBY_INFO:       return "Nearby Info";
+    case CONTINUITY_TYPE_FINDMY:            return "Find My Message";
+    default:                                return "Unknown";
+    }
+}
+
+const char *
+continuity_os_name(continuity_os_t os)
+{
+    switch (os) {
+    case CONTINUITY_OS_MACOS:   return "macOS";
+    case CONTINUITY_OS_IOS10:   return "iOS 10.x";
+    case CONTINUITY_OS_IOS11:   return "iOS 11.x";
+    case CONTINUITY_OS_IOS12:   return "iOS 12.x";
+    case CONTINUITY_OS_IOS13:   return "iOS 13.x";
+    default:                    return "Unknown";
+    }
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
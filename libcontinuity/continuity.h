@@ -0,0 +1,331 @@
+/* continuity.h
+ * Standalone decoder for Apple Continuity manufacturer-specific data
+ *
+ * Decodes the payload that follows the 0x004C company identifier in a
+ * Manufacturer Specific AD structure into plain structs.  The decoder
+ * performs no heap allocation and has no dependency on epan, so it can be
+ * shared by the Wireshark dissector and by offline tools.
+ *
+ * Field layouts follow the message descriptions under messages/ and
+ * dissector/FIELDS.md.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_H__
+#define __CONTINUITY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONTINUITY_COMPANY_ID   0x004C
+
+/* Maximum number of TLVs decoded from a single manufacturer data entry.
+ * Anything past this is left undecoded and counted in frame->trailing. */
+#define CONTINUITY_MAX_MSGS     16
+
+/* Message types (btcommon.apple.type) */
+enum {
+    CONTINUITY_TYPE_IOS               = 1,
+    CONTINUITY_TYPE_IBEACON           = 2,
+    CONTINUITY_TYPE_AIRPRINT          = 3,
+    CONTINUITY_TYPE_AIRDROP           = 5,
+    CONTINUITY_TYPE_HOMEKIT           = 6,
+    CONTINUITY_TYPE_AIRPODS           = 7,
+    CONTINUITY_TYPE_HEY_SIRI          = 8,
+    CONTINUITY_TYPE_AIRPLAY_TARGET    = 9,
+    CONTINUITY_TYPE_AIRPLAY_SOURCE    = 10,
+    CONTINUITY_TYPE_MAGIC_SWITCH      = 11,
+    CONTINUITY_TYPE_HANDOFF           = 12,
+    CONTINUITY_TYPE_TETHERING_TARGET  = 13,
+    CONTINUITY_TYPE_TETHERING_SOURCE  = 14,
+    CONTINUITY_TYPE_NEARBY_ACTION     = 15,
+    CONTINUITY_TYPE_NEARBY_INFO       = 16,
+    CONTINUITY_TYPE_FINDMY            = 18
+};
+
+/* Nearby Action types with a known parameter layout */
+enum {
+    CONTINUITY_NEARBY_ACTION_WIFI_PASSWORD  = 0x08,
+    CONTINUITY_NEARBY_ACTION_IOS_SETUP      = 0x09
+};
+
+/* Per-message decode status */
+enum {
+    CONTINUITY_MSG_OK = 0,
+    CONTINUITY_MSG_SHORT,       /* length is below the type's fixed layout */
+    CONTINUITY_MSG_TRUNCATED    /* length runs past the end of the buffer */
+};
+
+/* Find My message forms */
+enum {
+    CONTINUITY_FINDMY_DATA = 0, /* unrecognised length, raw data only */
+    CONTINUITY_FINDMY_SHORT,    /* 2 bytes: status and key bits */
+    CONTINUITY_FINDMY_FULL      /* 25 bytes: status, key, key bits, hint */
+};
+
+#define CONTINUITY_FINDMY_FULL_LEN      25
+#define CONTINUITY_FINDMY_SHORT_LEN     2
+#define CONTINUITY_FINDMY_KEY_LEN       28
+#define CONTINUITY_FINDMY_KEY_HEX_LEN   (2 * CONTINUITY_FINDMY_KEY_LEN)
+
+/* OS guess, derived from the Apple TLVs and the AD entries around them */
+typedef enum {
+    CONTINUITY_OS_UNKNOWN = 0,
+    CONTINUITY_OS_MACOS,
+    CONTINUITY_OS_IOS10,
+    CONTINUITY_OS_IOS11,
+    CONTINUITY_OS_IOS12,
+    CONTINUITY_OS_IOS13
+} continuity_os_t;
+
+/* 3 - AirPrint */
+typedef struct {
+    uint8_t     addr_type;
+    uint8_t     resource_path_type;
+    uint8_t     security_type;
+    uint16_t    qid_port;
+    uint8_t     ip_addr[16];
+    bool        has_power;
+    uint8_t     power;
+} continuity_airprint_t;
+
+/* 5 - AirDrop */
+typedef struct {
+    uint8_t     prefix[8];
+    uint8_t     version;
+    uint8_t     appleid[2];
+    uint8_t     phone[2];
+    uint8_t     email[2];
+    uint8_t     email2[2];
+    uint8_t     suffix;
+} continuity_airdrop_t;
+
+/* 6 - HomeKit */
+typedef struct {
+    uint8_t     status;
+    uint8_t     device_id[6];
+    uint16_t    category;
+    uint16_t    global_state;
+    uint8_t     config_num;
+    uint8_t     comp_ver;
+} continuity_homekit_t;
+
+/* 7 - Proximity Pairing (AirPods) */
+typedef struct {
+    uint8_t     prefix;
+    uint16_t    model;
+    uint8_t     status;
+    uint8_t     right_battery;      /* x10% */
+    uint8_t     left_battery;       /* x10% */
+    bool        case_charging;
+    bool        right_charging;
+    bool        left_charging;
+    uint8_t     case_battery;       /* x10% */
+    uint8_t     open_count;
+    uint8_t     color;
+    uint8_t     suffix;
+    uint8_t     encdata[16];
+} continuity_airpods_t;
+
+/* 8 - "Hey Siri" */
+typedef struct {
+    uint16_t    perphash;
+    uint8_t     snr;
+    uint8_t     confidence;
+    uint16_t    device_class;
+    uint8_t     randbyte;
+} continuity_siri_t;
+
+/* 9 - AirPlay Target */
+typedef struct {
+    uint8_t     flags;
+    uint8_t     seed;
+    uint8_t     ip[4];
+} continuity_airplay_target_t;
+
+/* 10 - AirPlay Source */
+typedef struct {
+    uint8_t     data;
+} continuity_airplay_source_t;
+
+/* 11 - Magic Switch */
+typedef struct {
+    uint16_t    data;
+    uint8_t     confidence;
+} continuity_magic_switch_t;
+
+/* 12 - Handoff */
+typedef struct {
+    uint8_t     copy;
+    uint16_t    seqnum;
+    uint8_t     authtag;
+    uint8_t     encdata_len;        /* starts 4 bytes into the value */
+} continuity_handoff_t;
+
+/* 13 - Tethering Target (Wi-Fi Settings Page) */
+typedef struct {
+    uint8_t     icloudid_len;       /* the whole value */
+} continuity_tethering_target_t;
+
+/* 14 - Tethering Source (Instant Hotspot) */
+typedef struct {
+    uint8_t     version;
+    uint8_t     flags;
+    uint8_t     battery;
+    uint16_t    cell_type;
+    uint8_t     cell_bars;
+} continuity_tethering_source_t;
+
+/* 15 - Nearby Action */
+typedef struct {
+    bool        short_form;         /* 2-byte message, raw data only */
+    uint8_t     flags;
+    uint8_t     type;
+    bool        has_auth;
+    uint8_t     auth[3];
+    uint8_t     params_off;         /* Action Parameters, relative to the value */
+    uint8_t     params_len;
+    union {
+        struct {
+            uint8_t appleid[3];
+            uint8_t phone[3];
+            uint8_t email[3];
+            uint8_t ssid[3];
+        } wifi_password;
+        struct {
+            uint8_t device_class;
+            uint8_t device_model;
+            uint8_t device_color;
+            uint8_t msg_version;
+        } ios_setup;
+    } params;
+    bool        has_params;         /* params union is valid for this type */
+} continuity_nearby_action_t;
+
+/* 16 - Nearby Info */
+typedef struct {
+    uint8_t     status_flags;       /* upper nibble of the first byte */
+    uint8_t     action_code;        /* lower nibble of the first byte */
+    bool        has_data_flags;
+    uint8_t     data_flags;
+    uint8_t     auth_len;           /* 0, 3 or 4 */
+    uint8_t     auth[4];
+    uint8_t     postauth_off;       /* relative to the value */
+    uint8_t     postauth_len;
+} continuity_nearby_info_t;
+
+/* 18 - Find My */
+typedef struct {
+    uint8_t     form;
+    uint8_t     status;
+    uint8_t     key[22];            /* bytes 6-27 of the public key */
+    uint8_t     key_bits;           /* bits 6-7 of byte 0 of the public key */
+    uint8_t     hint;
+} continuity_findmy_t;
+
+typedef struct {
+    uint8_t     type;
+    uint8_t     length;             /* declared length of the value */
+    uint8_t     status;             /* CONTINUITY_MSG_* */
+    uint16_t    offset;             /* offset of the type byte in the buffer */
+    uint16_t    value_len;          /* bytes of value actually present */
+    union {
+        continuity_airprint_t           airprint;
+        continuity_airdrop_t            airdrop;
+        continuity_homekit_t            homekit;
+        continuity_airpods_t            airpods;
+        continuity_siri_t               siri;
+        continuity_airplay_target_t     airplay_target;
+        continuity_airplay_source_t     airplay_source;
+        continuity_magic_switch_t       magic_switch;
+        continuity_handoff_t            handoff;
+        continuity_tethering_target_t   tethering_target;
+        continuity_tethering_source_t   tethering_source;
+        continuity_nearby_action_t      nearby_action;
+        continuity_nearby_info_t        nearby_info;
+        continuity_findmy_t             findmy;
+    } u;
+} continuity_msg_t;
+
+typedef struct {
+    unsigned            count;
+    uint16_t            trailing;   /* undecoded bytes after the last TLV */
+    continuity_os_t     os;
+    unsigned            os_msg;     /* index of the message the OS guess belongs to */
+    continuity_msg_t    msgs[CONTINUITY_MAX_MSGS];
+} continuity_frame_t;
+
+/* Other AD entries of the same advertisement that feed the OS guess */
+typedef struct {
+    int         flags_reserved;     /* bits 7-5 of the Flags entry, -1 if absent */
+    bool        has_tx_power;       /* a Tx Power Level entry was seen */
+} continuity_ad_ctx_t;
+
+/* Offset of a message's value within the decoded buffer */
+#define CONTINUITY_VALUE_OFFSET(msg)    ((msg)->offset + 2)
+
+/* Decode the Apple payload that follows the company identifier.  Returns
+ * the number of messages written to frame. */
+unsigned continuity_decode(const uint8_t *buf, size_t len, continuity_frame_t *frame);
+
+/* Bit for message type t in a continuity_type_mask() result, t < 32 */
+#define CONTINUITY_TYPE_BIT(t)          (1u << (t))
+
+/* The message types present in an Apple payload, found from the TLV
+ * headers alone.  Much cheaper than continuity_decode(), for deciding
+ * whether a frame is worth decoding at all. */
+uint32_t continuity_type_mask(const uint8_t *buf, size_t len);
+
+/* Returns true and sets payload and payload_len if data is a manufacturer
+ * specific AD value (company identifier first) belonging to Apple. */
+bool continuity_manufacturer_payload(const uint8_t *data, size_t len,
+        const uint8_t **payload, size_t *payload_len);
+
+/* Walk the AD structures of one advertisement and set payload and
+ * payload_len to the first Apple manufacturer data entry.  ctx is filled
+ * from the Flags and Tx Power Level entries that precede it, which is what
+ * the dissector sees when it reaches the Apple entry.  Returns false if
+ * there is no Apple entry. */
+bool continuity_ad_payload(const uint8_t *ad, size_t len, const uint8_t **payload,
+        size_t *payload_len, continuity_ad_ctx_t *ctx);
+
+/* Fill in frame->os and frame->os_msg from the decoded messages and the
+ * surrounding AD entries. */
+void continuity_infer_os(continuity_frame_t *frame, const continuity_ad_ctx_t *ctx);
+
+/* Rebuild the 28-byte Find My public key X coordinate from the advertiser
+ * address (most significant byte first) and a full Find My message. */
+void continuity_findmy_key(const uint8_t addr[6], const continuity_findmy_t *findmy,
+        uint8_t key[CONTINUITY_FINDMY_KEY_LEN]);
+
+/* Write len bytes as lowercase hex to out, which must hold 2 * len + 1
+ * characters, and terminate it. */
+void continuity_hex_encode(const uint8_t *data, size_t len, char *out);
+
+const char *continuity_type_name(uint8_t type);
+const char *continuity_os_name(continuity_os_t os);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTINUITY_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
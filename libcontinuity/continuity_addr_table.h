@@ -0,0 +1,85 @@
+/* continuity_addr_table.h
+ * Open-addressing index over records keyed by a 6-byte address
+ *
+ * Internal to libcontinuity, shared by the timeline and the HomeKit
+ * tracker.  The records live in the caller's array, each starting with its
+ * 6-byte key.  The table is a power-of-two array of slots, each holding a
+ * record's index + 1, or 0 if free.  Slots are probed linearly from the
+ * key's hash; callers keep the table at most half full so probe runs stay
+ * short.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_ADDR_TABLE_H__
+#define __CONTINUITY_ADDR_TABLE_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Fibonacci hashing: the key times 2^64 / phi, keeping the top
+ * log2(slot_count) bits of the product, which depend on every key bit */
+static inline size_t
+continuity_addr_hash(const uint8_t addr[6], size_t slot_count)
+{
+    uint64_t    v = 0;
+    unsigned    bits = 0;
+    int         i;
+
+    for (i = 0; i < 6; i++)
+        v = v << 8 | addr[i];
+    while (((size_t)1 << bits) < slot_count)
+        bits++;
+
+    return bits ? (size_t)((v * 0x9e3779b97f4a7c15u) >> (64 - bits)) : 0;
+}
+
+/* The slot holding addr, or the free slot where it would go.  records is
+ * the caller's array, stride bytes per record. */
+static inline size_t
+continuity_addr_find(const uint32_t *slots, size_t slot_count, const void *records,
+        size_t stride, const uint8_t addr[6])
+{
+    const uint8_t  *base = (const uint8_t *)records;
+    size_t          s = continuity_addr_hash(addr, slot_count);
+
+    while (slots[s] && memcmp(base + (slots[s] - 1) * stride, addr, 6) != 0)
+        s = (s + 1) & (slot_count - 1);
+
+    return s;
+}
+
+/* A new table of slot_count slots indexing the first count records, or
+ * NULL if out of memory */
+static inline uint32_t *
+continuity_addr_index(const void *records, size_t stride, size_t count, size_t slot_count)
+{
+    const uint8_t  *base = (const uint8_t *)records;
+    uint32_t       *slots = (uint32_t *)calloc(slot_count, sizeof(*slots));
+    size_t          r;
+
+    if (!slots)
+        return NULL;
+
+    for (r = 0; r < count; r++)
+        slots[continuity_addr_find(slots, slot_count, records, stride, base + r * stride)] =
+            (uint32_t)(r + 1);
+
+    return slots;
+}
+
+#endif /* __CONTINUITY_ADDR_TABLE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,360 @@
+/* continuity_batch.c
+ * Batch decoding of Apple Continuity payloads into per-type columns
+ *
+ * Two passes.  The first walks the TLV boundaries of every payload, the
+ * way continuity_decode() does, and files each well-formed message of a
+ * column-set type in a bucket for its type as (advert, value).  The
+ * second runs one loop per column over a bucket, reading each value at
+ * the column's fixed offset.  Whether a value is well-formed is decided
+ * by the checks in continuity_values.h that continuity_decode() uses, so
+ * the two agree on which messages become rows.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <string.h>
+
+#include "continuity_batch.h"
+#include "continuity_values.h"
+
+/* Messages held per type before they are written out as rows */
+#define BUCKET_ROWS     128
+
+enum {
+    BUCKET_AIRPODS,
+    BUCKET_HANDOFF,
+    BUCKET_NEARBY_ACTION,
+    BUCKET_NEARBY_INFO,
+    BUCKET_FINDMY,
+    BUCKET_COUNT,
+    BUCKET_NONE = BUCKET_COUNT
+};
+
+typedef struct {
+    const uint8_t  *value;
+    uint32_t        advert;
+    uint8_t         len;
+} pending_t;
+
+typedef struct {
+    size_t      count;
+    pending_t   rows[BUCKET_ROWS];
+} bucket_t;
+
+/* Fill column col of rows base to base + n - 1 with expr, evaluated with
+ * p pointing at each of the first n pending messages of bucket b.  A NULL
+ * column is skipped as a whole. */
+#define FILL_COLUMN(c, col, b, n, base, expr) \
+    do { \
+        if ((c)->col) { \
+            const pending_t *p = (b)->rows; \
+            size_t           i_; \
+            for (i_ = 0; i_ < (n); i_++, p++) \
+                (c)->col[(base) + i_] = (expr); \
+        } \
+    } while (0)
+
+static uint8_t
+bucket_of(uint8_t type)
+{
+    switch (type) {
+    case CONTINUITY_TYPE_AIRPODS:       return BUCKET_AIRPODS;
+    case CONTINUITY_TYPE_HANDOFF:       return BUCKET_HANDOFF;
+    case CONTINUITY_TYPE_NEARBY_ACTION: return BUCKET_NEARBY_ACTION;
+    case CONTINUITY_TYPE_NEARBY_INFO:   return BUCKET_NEARBY_INFO;
+    case CONTINUITY_TYPE_FINDMY:        return BUCKET_FINDMY;
+    default:                            return BUCKET_NONE;
+    }
+}
+
+static bool
+value_ok(unsigned bucket, const uint8_t *v, size_t len)
+{
+    switch (bucket) {
+    case BUCKET_AIRPODS:
+        return continuity_airpods_ok(len);
+    case BUCKET_HANDOFF:
+        return continuity_handoff_ok(len);
+    case BUCKET_NEARBY_ACTION:
+        return continuity_nearby_action_ok(v, len);
+    case BUCKET_NEARBY_INFO:
+        return continuity_nearby_info_ok(len);
+    default:
+        return true;
+    }
+}
+
+/* How many of n rows fit in a column set; the rest are dropped */
+static size_t
+rows_that_fit(size_t capacity, size_t count, size_t n, size_t *dropped)
+{
+    size_t  room = count < capacity ? capacity - count : 0;
+
+    if (n > room) {
+        *dropped += n - room;
+        n = room;
+    }
+
+    return n;
+}
+
+static size_t
+flush_airpods(continuity_airpods_cols_t *c, const bucket_t *b, size_t *dropped)
+{
+    size_t  base = c->count;
+    size_t  n = rows_that_fit(c->capacity, base, b->count, dropped);
+
+    FILL_COLUMN(c, advert, b, n, base, p->advert);
+    FILL_COLUMN(c, model, b, n, base, GET_BE16(p->value + 1));
+    FILL_COLUMN(c, status, b, n, base, p->value[3]);
+    FILL_COLUMN(c, right_battery, b, n, base, (uint8_t)(p->value[4] >> 4));
+    FILL_COLUMN(c, left_battery, b, n, base, (uint8_t)(p->value[4] & 0x0f));
+    FILL_COLUMN(c, case_battery, b, n, base, (uint8_t)(p->value[5] & 0x0f));
+    FILL_COLUMN(c, charging, b, n, base, (uint8_t)(p->value[5] >> 4 & 0x07));
+    FILL_COLUMN(c, open_count, b, n, base, p->value[6]);
+    FILL_COLUMN(c, color, b, n, base, p->value[7]);
+    c->count += n;
+
+    return n;
+}
+
+static size_t
+flush_handoff(continuity_handoff_cols_t *c, const bucket_t *b, size_t *dropped)
+{
+    size_t  base = c->count;
+    size_t  n = rows_that_fit(c->capacity, base, b->count, dropped);
+
+    FILL_COLUMN(c, advert, b, n, base, p->advert);
+    FILL_COLUMN(c, copy, b, n, base, p->value[0]);
+    FILL_COLUMN(c, seqnum, b, n, base, GET_LE16(p->value + 1));
+    FILL_COLUMN(c, authtag, b, n, base, p->value[3]);
+    c->count += n;
+
+    return n;
+}
+
+static size_t
+flush_nearby_action(continuity_nearby_action_cols_t *c, const bucket_t *b, size_t *dropped)
+{
+    size_t  base = c->count;
+    size_t  n = rows_that_fit(c->capacity, base, b->count, dropped);
+
+    FILL_COLUMN(c, advert, b, n, base, p->advert);
+    FILL_COLUMN(c, short_form, b, n, base, p->len == NEARBY_ACTION_SHORT_LEN);
+    FILL_COLUMN(c, flags, b, n, base, p->len == NEARBY_ACTION_SHORT_LEN ? 0 : p->value[0]);
+    FILL_COLUMN(c, type, b, n, base, p->len == NEARBY_ACTION_SHORT_LEN ? 0 : p->value[1]);
+    c->count += n;
+
+    return n;
+}
+
+static size_t
+flush_nearby_info(continuity_nearby_info_cols_t *c, const bucket_t *b, size_t *dropped)
+{
+    size_t  base = c->count;
+    size_t  n = rows_that_fit(c->capacity, base, b->count, dropped);
+
+    FILL_COLUMN(c, advert, b, n, base, p->advert);
+    FILL_COLUMN(c, status_flags, b, n, base, (uint8_t)(p->value[0] >> 4));
+    FILL_COLUMN(c, action_code, b, n, base, (uint8_t)(p->value[0] & 0x0f));
+    FILL_COLUMN(c, data_flags, b, n, base, p->len >= 2 ? p->value[1] : 0);
+    c->count += n;
+
+    return n;
+}
+
+/* The status byte opens both recognised forms */
+static uint8_t
+findmy_status(const pending_t *p)
+{
+    return continuity_findmy_form(p->len) != CONTINUITY_FINDMY_DATA ? p->value[0] : 0;
+}
+
+static uint8_t
+findmy_key_bits(const pending_t *p)
+{
+    switch (continuity_findmy_form(p->len)) {
+    case CONTINUITY_FINDMY_FULL:
+        return p->value[23] & 0x03;
+    case CONTINUITY_FINDMY_SHORT:
+        return p->value[1] & 0x03;
+    default:
+        return 0;
+    }
+}
+
+static size_t
+flush_findmy(continuity_findmy_cols_t *c, const bucket_t *b, size_t *dropped)
+{
+    size_t  base = c->count;
+    size_t  n = rows_that_fit(c->capacity, base, b->count, dropped);
+
+    FILL_COLUMN(c, advert, b, n, base, p->advert);
+    FILL_COLUMN(c, form, b, n, base, continuity_findmy_form(p->len));
+    FILL_COLUMN(c, status, b, n, base, findmy_status(p));
+    FILL_COLUMN(c, key_bits, b, n, base, findmy_key_bits(p));
+    FILL_COLUMN(c, hint, b, n, base, p->len == CONTINUITY_FINDMY_FULL_LEN ? p->value[24] : 0);
+    c->count += n;
+
+    return n;
+}
+
+/* Write out a bucket's messages as rows and empty it */
+static size_t
+flush(continuity_batch_t *batch, unsigned bucket, bucket_t *b)
+{
+    size_t  rows;
+
+    switch (bucket) {
+    case BUCKET_AIRPODS:
+        rows = flush_airpods(&batch->airpods, b, &batch->dropped);
+        break;
+    case BUCKET_HANDOFF:
+        rows = flush_handoff(&batch->handoff, b, &batch->dropped);
+        break;
+    case BUCKET_NEARBY_ACTION:
+        rows = flush_nearby_action(&batch->nearby_action, b, &batch->dropped);
+        break;
+    case BUCKET_NEARBY_INFO:
+        rows = flush_nearby_info(&batch->nearby_info, b, &batch->dropped);
+        break;
+    default:
+        rows = flush_findmy(&batch->findmy, b, &batch->dropped);
+        break;
+    }
+    b->count = 0;
+
+    return rows;
+}
+
+size_t
+continuity_decode_batch(const continuity_advert_t *adverts, size_t n,
+        continuity_batch_t *batch)
+{
+    bucket_t    buckets[BUCKET_COUNT];
+    size_t      rows = 0;
+    size_t      a;
+    unsigned    k;
+
+    for (k = 0; k < BUCKET_COUNT; k++)
+        buckets[k].count = 0;
+
+    for (a = 0; a < n; a++) {
+        const uint8_t  *buf = adverts[a].data;
+        size_t          len = adverts[a].len;
+        size_t          offset = 0;
+        unsigned        count = 0;
+
+        /* The walk of continuity_decode() */
+        while (offset + 2 <= len && count++ < CONTINUITY_MAX_MSGS) {
+            const uint8_t  *v = buf + offset + 2;
+            uint8_t         value_len = buf[offset + 1];
+            unsigned        bucket = bucket_of(buf[offset]);
+            bucket_t       *b;
+
+            if (value_len > len - offset - 2) {
+                batch->truncated++;
+                break;
+            }
+            offset += 2 + (size_t)value_len;
+            batch->messages++;
+            if (bucket == BUCKET_NONE)
+                continue;
+            if (!value_ok(bucket, v, value_len)) {
+                batch->skipped++;
+                continue;
+            }
+
+            b = &buckets[bucket];
+            b->rows[b->count].value  = v;
+            b->rows[b->count].advert = batch->adverts + (uint32_t)a;
+            b->rows[b->count].len    = value_len;
+            if (++b->count == BUCKET_ROWS)
+                rows += flush(batch, bucket, b);
+        }
+    }
+
+    for (k = 0; k < BUCKET_COUNT; k++) {
+        if (buckets[k].count)
+            rows += flush(batch, k, &buckets[k]);
+    }
+    batch->adverts += (uint32_t)n;
+
+    return rows;
+}
+
+void
+continuity_batch_init(continuity_batch_t *batch, void *storage, size_t capacity)
+{
+    uint32_t   *u32 = storage;
+    uint16_t   *u16;
+    uint8_t    *u8;
+
+    memset(batch, 0, sizeof(*batch));
+
+    batch->airpods.advert       = u32;
+    batch->handoff.advert       = u32 + capacity;
+    batch->nearby_action.advert = u32 + 2 * capacity;
+    batch->nearby_info.advert   = u32 + 3 * capacity;
+    batch->findmy.advert        = u32 + 4 * capacity;
+
+    u16 = (uint16_t *)(u32 + 5 * capacity);
+    batch->airpods.model  = u16;
+    batch->handoff.seqnum = u16 + capacity;
+
+    u8 = (uint8_t *)(u16 + 2 * capacity);
+    batch->airpods.status             = u8;
+    batch->airpods.right_battery      = u8 + capacity;
+    batch->airpods.left_battery       = u8 + 2 * capacity;
+    batch->airpods.case_battery       = u8 + 3 * capacity;
+    batch->airpods.charging           = u8 + 4 * capacity;
+    batch->airpods.open_count         = u8 + 5 * capacity;
+    batch->airpods.color              = u8 + 6 * capacity;
+    batch->handoff.copy               = u8 + 7 * capacity;
+    batch->handoff.authtag            = u8 + 8 * capacity;
+    batch->nearby_action.short_form   = u8 + 9 * capacity;
+    batch->nearby_action.flags        = u8 + 10 * capacity;
+    batch->nearby_action.type         = u8 + 11 * capacity;
+    batch->nearby_info.status_flags   = u8 + 12 * capacity;
+    batch->nearby_info.action_code    = u8 + 13 * capacity;
+    batch->nearby_info.data_flags     = u8 + 14 * capacity;
+    batch->findmy.form                = u8 + 15 * capacity;
+    batch->findmy.status              = u8 + 16 * capacity;
+    batch->findmy.key_bits            = u8 + 17 * capacity;
+    batch->findmy.hint                = u8 + 18 * capacity;
+
+    batch->airpods.capacity       = capacity;
+    batch->handoff.capacity       = capacity;
+    batch->nearby_action.capacity = capacity;
+    batch->nearby_info.capacity   = capacity;
+    batch->findmy.capacity        = capacity;
+}
+
+void
+continuity_batch_reset(continuity_batch_t *batch)
+{
+    batch->airpods.count       = 0;
+    batch->handoff.count       = 0;
+    batch->nearby_action.count = 0;
+    batch->nearby_info.count   = 0;
+    batch->findmy.count        = 0;
+
+    batch->adverts   = 0;
+    batch->messages  = 0;
+    batch->truncated = 0;
+    batch->skipped   = 0;
+    batch->dropped   = 0;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,147 @@
+/* continuity_batch.h
+ * Batch decoding of Apple Continuity payloads into per-type columns
+ *
+ * continuity_decode() turns one payload into one struct per TLV.  For bulk
+ * ingest, continuity_decode_batch() takes many payloads at once and appends
+ * the scalar fields of the most common message types to caller-provided
+ * column arrays (structure of arrays), one row per message.  Messages are
+ * grouped by type and each column is filled in a loop of its own, reading
+ * the value at a fixed offset, without building a continuity_frame_t.  A
+ * row holds the same values as the message's struct from
+ * continuity_decode().  Like the rest of the library it performs no heap
+ * allocation.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_BATCH_H__
+#define __CONTINUITY_BATCH_H__
+
+#include "continuity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One Apple payload, as passed to continuity_decode() */
+typedef struct {
+    const uint8_t  *data;
+    size_t          len;
+} continuity_advert_t;
+
+/* Column sets.  The caller points every wanted column at an array of at
+ * least capacity elements and leaves the others NULL; rows are appended at
+ * count.  advert holds the index of the payload the row came from, counted
+ * across calls (see continuity_batch_t.adverts). */
+
+/* 7 - Proximity Pairing (AirPods) */
+typedef struct {
+    size_t      capacity;
+    size_t      count;
+    uint32_t   *advert;
+    uint16_t   *model;
+    uint8_t    *status;
+    uint8_t    *right_battery;      /* x10% */
+    uint8_t    *left_battery;       /* x10% */
+    uint8_t    *case_battery;       /* x10% */
+    uint8_t    *charging;           /* bit 2 case, bit 1 right, bit 0 left */
+    uint8_t    *open_count;
+    uint8_t    *color;
+} continuity_airpods_cols_t;
+
+/* 12 - Handoff */
+typedef struct {
+    size_t      capacity;
+    size_t      count;
+    uint32_t   *advert;
+    uint8_t    *copy;
+    uint16_t   *seqnum;
+    uint8_t    *authtag;
+} continuity_handoff_cols_t;
+
+/* 15 - Nearby Action; 2-byte messages carry no flags or type, which are 0 */
+typedef struct {
+    size_t      capacity;
+    size_t      count;
+    uint32_t   *advert;
+    uint8_t    *short_form;         /* 1 for the 2-byte form */
+    uint8_t    *flags;
+    uint8_t    *type;
+} continuity_nearby_action_cols_t;
+
+/* 16 - Nearby Info; data_flags is 0 for messages without that byte */
+typedef struct {
+    size_t      capacity;
+    size_t      count;
+    uint32_t   *advert;
+    uint8_t    *status_flags;
+    uint8_t    *action_code;
+    uint8_t    *data_flags;
+} continuity_nearby_info_cols_t;
+
+/* 18 - Find My; hint is 0 for the 2-byte form, and status, key_bits and
+ * hint are 0 for other lengths */
+typedef struct {
+    size_t      capacity;
+    size_t      count;
+    uint32_t   *advert;
+    uint8_t    *form;               /* CONTINUITY_FINDMY_* */
+    uint8_t    *status;
+    uint8_t    *key_bits;
+    uint8_t    *hint;
+} continuity_findmy_cols_t;
+
+typedef struct {
+    continuity_airpods_cols_t       airpods;
+    continuity_handoff_cols_t       handoff;
+    continuity_nearby_action_cols_t nearby_action;
+    continuity_nearby_info_cols_t   nearby_info;
+    continuity_findmy_cols_t        findmy;
+
+    /* Running totals, updated by every call */
+    uint32_t    adverts;            /* payloads seen */
+    size_t      messages;           /* TLVs within their payload, any type */
+    size_t      truncated;          /* TLVs running past the end of their payload */
+    size_t      skipped;            /* column-set TLVs continuity_decode() finds short */
+    size_t      dropped;            /* rows that did not fit in a column set */
+} continuity_batch_t;
+
+/* Bytes of storage continuity_batch_init() needs for each row of capacity */
+#define CONTINUITY_BATCH_ROW_BYTES \
+    (5 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + 19 * sizeof(uint8_t))
+
+/* Point every column of every set at storage, capacity rows each, and zero
+ * the counts and totals.  storage holds capacity *
+ * CONTINUITY_BATCH_ROW_BYTES bytes, aligned for uint32_t. */
+void continuity_batch_init(continuity_batch_t *batch, void *storage, size_t capacity);
+
+/* Decode n payloads and append one row per AirPods, Handoff, Nearby Action,
+ * Nearby Info and Find My message that continuity_decode() marks
+ * CONTINUITY_MSG_OK to the matching column set.  As there, at most
+ * CONTINUITY_MAX_MSGS TLVs are read from each payload.  Returns the number
+ * of rows written by this call. */
+size_t continuity_decode_batch(const continuity_advert_t *adverts, size_t n,
+        continuity_batch_t *batch);
+
+/* Empty every column set and zero the totals; column pointers and
+ * capacities are kept. */
+void continuity_batch_reset(continuity_batch_t *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTINUITY_BATCH_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,253 @@
+/* continuity_fields.c
+ * Field-by-field walk over decoded Apple Continuity messages
+ *
+ * The layouts come from continuity_layouts.h, which the plugin builds its
+ * tree from too.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "continuity_fields.h"
+
+#define FIELD_REST      0       /* length runs to the end of the value */
+#define FIELD_BE        0x00
+#define FIELD_LE        0x01    /* little-endian multi-byte integer */
+
+typedef struct {
+    const char *name;
+    uint8_t     kind;
+    uint8_t     offset;
+    uint8_t     length;
+    uint8_t     mask;           /* bitmask of a 1-byte field, 0 for none */
+    uint8_t     flags;
+    uint8_t     depth;          /* below the message's type item, minus 1 */
+} field_desc_t;
+
+typedef struct {
+    const field_desc_t *fields;
+    unsigned            count;
+    uint8_t             min_length;
+} layout_t;
+
+#define LAYOUT(fields, min_length) { fields, sizeof(fields) / sizeof((fields)[0]), min_length }
+
+#define CONTINUITY_FIELD(hf, name, kind, offset, length, mask, endian, depth, ett) \
+    { name, CONTINUITY_FIELD_##kind, offset, length, mask, FIELD_##endian, depth }
+#define CONTINUITY_LAYOUT(id, type, min_length, ...) \
+    static const field_desc_t id##_fields[] = { __VA_ARGS__ };
+#define CONTINUITY_PART_LAYOUT(id, min_length, ...) \
+    static const field_desc_t id##_fields[] = { __VA_ARGS__ }; \
+    static const layout_t id##_layout = LAYOUT(id##_fields, min_length);
+#include "continuity_layouts.h"
+
+/* Message types whose whole value is described by one table */
+#define CONTINUITY_FIELD(hf, name, kind, offset, length, mask, endian, depth, ett)
+#define CONTINUITY_LAYOUT(id, type, min_length, ...) \
+    [type] = LAYOUT(id##_fields, min_length),
+#define CONTINUITY_PART_LAYOUT(id, min_length, ...)
+static const layout_t layouts[] = {
+#include "continuity_layouts.h"
+};
+
+typedef struct {
+    const uint8_t          *buf;
+    continuity_field_cb     cb;
+    void                   *user;
+    unsigned                msg;
+    unsigned                count;
+} walk_t;
+
+static void
+emit(walk_t *w, const char *name, continuity_field_kind_t kind, unsigned depth,
+        size_t offset, size_t length, uint32_t value, const char *str)
+{
+    continuity_field_t  f;
+
+    w->count++;
+    if (!w->cb)
+        return;
+
+    f.name   = name;
+    f.kind   = kind;
+    f.depth  = depth;
+    f.msg    = w->msg;
+    f.offset = (uint16_t)offset;
+    f.length = (uint16_t)length;
+    f.value  = value;
+    f.bytes  = w->buf + offset;
+    f.str    = str;
+    w->cb(&f, w->user);
+}
+
+static uint32_t
+field_value(const field_desc_t *d, const uint8_t *p)
+{
+    uint32_t    v;
+    uint8_t     mask = d->mask;
+
+    if (d->length == 2)
+        v = (d->flags & FIELD_LE) ? (uint32_t)(p[0] | p[1] << 8) : (uint32_t)(p[0] << 8 | p[1]);
+    else
+        v = p[0];
+
+    if (mask) {
+        v &= mask;
+        if (d->kind == CONTINUITY_FIELD_BOOL)
+            return v != 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            v >>= 1;
+        }
+    } else if (d->kind == CONTINUITY_FIELD_BOOL) {
+        return v != 0;
+    }
+
+    return v;
+}
+
+/* Same rule as the plugin's add_apple_fields(): one length check when the
+ * value covers the whole layout, otherwise stop at the first field that
+ * does not fit. */
+static void
+emit_layout(walk_t *w, size_t offset, size_t length, const layout_t *layout)
+{
+    const field_desc_t *d = layout->fields;
+    const field_desc_t *end = layout->fields + layout->count;
+    bool                whole = length >= layout->min_length;
+
+    for (; d < end; d++) {
+        size_t  field_length;
+
+        if (!whole && (size_t)d->offset + d->length > length)
+            break;
+        field_length = d->length != FIELD_REST ? d->length : length - d->offset;
+
+        emit(w, d->name, (continuity_field_kind_t)d->kind, 1 + d->depth, offset + d->offset, field_length,
+                (d->kind == CONTINUITY_FIELD_UINT || d->kind == CONTINUITY_FIELD_BOOL) ?
+                    field_value(d, w->buf + offset + d->offset) : 0,
+                NULL);
+    }
+}
+
+unsigned
+continuity_foreach_field(const uint8_t *buf, const continuity_frame_t *frame,
+        const uint8_t *addr, continuity_field_cb cb, void *user)
+{
+    walk_t      w;
+    unsigned    i;
+
+    w.buf   = buf;
+    w.cb    = cb;
+    w.user  = user;
+    w.count = 0;
+
+    for (i = 0; i < frame->count; i++) {
+        const continuity_msg_t *msg = &frame->msgs[i];
+        size_t                  value_offset = CONTINUITY_VALUE_OFFSET(msg);
+
+        w.msg = i;
+
+        emit(&w, "btcommon.apple.type", CONTINUITY_FIELD_UINT, 0, msg->offset, 1, msg->type, NULL);
+        emit(&w, "btcommon.apple.length", CONTINUITY_FIELD_UINT, 1, msg->offset + 1u, 1, msg->length, NULL);
+
+        if (i == 0 && frame->os == CONTINUITY_OS_MACOS)
+            emit(&w, "btcommon.apple.nearbyinfo.os", CONTINUITY_FIELD_STRING, 1, 0, 0, 0, continuity_os_name(frame->os));
+        else if (i == 0 && frame->os == CONTINUITY_OS_IOS13)
+            emit(&w, "btcommon.apple.nearbyinfo.os", CONTINUITY_FIELD_STRING, 1, value_offset, 1, 0, continuity_os_name(frame->os));
+
+        if (msg->status != CONTINUITY_MSG_OK) {
+            if (msg->value_len)
+                emit(&w, "btcommon.apple.data", CONTINUITY_FIELD_BYTES, 1, value_offset, msg->value_len, 0, NULL);
+            continue;
+        }
+
+        switch (msg->type) {
+        case CONTINUITY_TYPE_NEARBY_ACTION: {
+            const continuity_nearby_action_t *na = &msg->u.nearby_action;
+            size_t params_offset = value_offset + na->params_off;
+
+            if (na->short_form) {
+                emit(&w, "btcommon.apple.nearbyaction_data", CONTINUITY_FIELD_BYTES, 1, value_offset, msg->value_len, 0, NULL);
+                break;
+            }
+            emit_layout(&w, value_offset, msg->value_len, &nearbyaction_header_layout);
+            if (na->has_auth)
+                emit_layout(&w, value_offset + 2, 3, &nearbyaction_auth_layout);
+
+            if (na->has_params && na->type == CONTINUITY_NEARBY_ACTION_WIFI_PASSWORD)
+                emit_layout(&w, params_offset, na->params_len, &nearbyaction_wifijoin_layout);
+            else if (na->has_params && na->type == CONTINUITY_NEARBY_ACTION_IOS_SETUP)
+                emit_layout(&w, params_offset, na->params_len, &nearbyaction_setup_layout);
+            else if (na->params_len)
+                emit(&w, "btcommon.apple.nearbyaction_data", CONTINUITY_FIELD_BYTES, 1, params_offset, na->params_len, 0, NULL);
+            break;
+        }
+        case CONTINUITY_TYPE_NEARBY_INFO: {
+            const continuity_nearby_info_t *ni = &msg->u.nearby_info;
+
+            emit_layout(&w, value_offset, msg->value_len, &nearbyinfo_status_layout);
+            if (!ni->has_data_flags)
+                break;
+
+            if (i == frame->os_msg && frame->os >= CONTINUITY_OS_IOS10 && frame->os <= CONTINUITY_OS_IOS12)
+                emit(&w, "btcommon.apple.nearbyinfo.os", CONTINUITY_FIELD_STRING, 1, value_offset + 1, 1, 0, continuity_os_name(frame->os));
+
+            if (ni->auth_len)
+                emit(&w, "btcommon.apple.nearbyinfo.auth", CONTINUITY_FIELD_BYTES, 1, value_offset + 2, ni->auth_len, 0, NULL);
+            if (ni->postauth_len)
+                emit(&w, "btcommon.apple.nearbyinfo.postauth", CONTINUITY_FIELD_BYTES, 1, value_offset + ni->postauth_off, ni->postauth_len, 0, NULL);
+            break;
+        }
+        case CONTINUITY_TYPE_FINDMY:
+            if (msg->u.findmy.form == CONTINUITY_FINDMY_FULL) {
+                emit_layout(&w, value_offset, msg->value_len, &findmy_full_layout);
+                if (addr) {
+                    uint8_t key[CONTINUITY_FINDMY_KEY_LEN];
+                    char    key_str[CONTINUITY_FINDMY_KEY_HEX_LEN + 1];
+
+                    continuity_findmy_key(addr, &msg->u.findmy, key);
+                    continuity_hex_encode(key, sizeof(key), key_str);
+                    emit(&w, "btcommon.apple.findmy.publickey.xcord", CONTINUITY_FIELD_STRING, 1, 0, 0, 0, key_str);
+                }
+            } else if (msg->u.findmy.form == CONTINUITY_FINDMY_SHORT) {
+                emit_layout(&w, value_offset, msg->value_len, &findmy_short_layout);
+            } else {
+                emit(&w, "btcommon.apple.findmy.data", CONTINUITY_FIELD_BYTES, 1, value_offset, msg->value_len, 0, NULL);
+            }
+            break;
+        default:
+            if (msg->type < sizeof(layouts) / sizeof(layouts[0]) && layouts[msg->type].fields)
+                emit_layout(&w, value_offset, msg->value_len, &layouts[msg->type]);
+            else
+                emit(&w, "btcommon.apple.data", CONTINUITY_FIELD_BYTES, 1, value_offset, msg->value_len, 0, NULL);
+            break;
+        }
+    }
+
+    if (frame->trailing) {
+        size_t  end = 0;
+
+        if (frame->count) {
+            const continuity_msg_t *last = &frame->msgs[frame->count - 1];
+
+            end = (size_t)CONTINUITY_VALUE_OFFSET(last) + last->value_len;
+        }
+        w.msg = frame->count;
+        emit(&w, "btcommon.apple.data", CONTINUITY_FIELD_BYTES, 0, end, frame->trailing, 0, NULL);
+    }
+
+    return w.count;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,69 @@
+/* continuity_fields.h
+ * Field-by-field walk over decoded Apple Continuity messages
+ *
+ * continuity_foreach_field() reports the same items, in the same order and
+ * under the same btcommon.apple.* names, that the Wireshark plugin adds to
+ * the protocol tree.  Offline tools use it to print dissector-compatible
+ * output and to count the items a tree would hold.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_FIELDS_H__
+#define __CONTINUITY_FIELDS_H__
+
+#include "continuity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CONTINUITY_FIELD_NONE = 0,      /* subtree label, no value */
+    CONTINUITY_FIELD_UINT,          /* value */
+    CONTINUITY_FIELD_BOOL,          /* value is 0 or 1 */
+    CONTINUITY_FIELD_BYTES,         /* bytes, length */
+    CONTINUITY_FIELD_IPV4,          /* bytes, 4 */
+    CONTINUITY_FIELD_IPV6,          /* bytes, 16 */
+    CONTINUITY_FIELD_STRING         /* str */
+} continuity_field_kind_t;
+
+typedef struct {
+    const char             *name;   /* display filter field name */
+    continuity_field_kind_t kind;
+    unsigned                depth;  /* 0 for a message's type item */
+    unsigned                msg;    /* index into frame->msgs, frame->count for trailing data */
+    uint16_t                offset; /* in the decoded buffer */
+    uint16_t                length;
+    uint32_t                value;  /* masked and shifted, UINT and BOOL */
+    const uint8_t          *bytes;  /* points into the decoded buffer */
+    const char             *str;    /* only valid during the callback */
+} continuity_field_t;
+
+typedef void (*continuity_field_cb)(const continuity_field_t *field, void *user);
+
+/* Report every field of frame, which continuity_decode() filled from buf.
+ * addr is the advertiser address (most significant byte first) for the Find
+ * My public key, or NULL.  cb may be NULL to only count.  Returns the number
+ * of fields reported. */
+unsigned continuity_foreach_field(const uint8_t *buf, const continuity_frame_t *frame,
+        const uint8_t *addr, continuity_field_cb cb, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTINUITY_FIELDS_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,175 @@
+/* continuity_homekit.c
+ * Per-accessory HomeKit state-change tracking
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "continuity_addr_table.h"
+#include "continuity_homekit.h"
+
+#define HOMEKIT_MIN_SLOTS       64
+
+static int
+grow_slots(continuity_homekit_tracker_t *t, size_t slot_count)
+{
+    uint32_t   *slots = continuity_addr_index(t->accessories, sizeof(*t->accessories), t->count,
+            slot_count);
+
+    if (!slots)
+        return -1;
+
+    free(t->slots);
+    t->slots = slots;
+    t->slot_count = slot_count;
+
+    return 0;
+}
+
+static int
+grow_accessories(continuity_homekit_tracker_t *t, size_t capacity)
+{
+    void   *p = realloc(t->accessories, capacity * sizeof(*t->accessories));
+
+    if (!p)
+        return -1;
+    t->accessories = p;
+    t->capacity = capacity;
+
+    return 0;
+}
+
+int
+continuity_homekit_init(continuity_homekit_tracker_t *t, size_t expected)
+{
+    size_t  slot_count = HOMEKIT_MIN_SLOTS;
+
+    memset(t, 0, sizeof(*t));
+    while (slot_count < 2 * expected && slot_count < SIZE_MAX / 4)
+        slot_count *= 2;
+
+    if (grow_slots(t, slot_count) < 0 || grow_accessories(t, slot_count / 2) < 0) {
+        continuity_homekit_free(t);
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+continuity_homekit_add(continuity_homekit_tracker_t *t, uint64_t ts_ns,
+        const continuity_homekit_t *homekit)
+{
+    continuity_homekit_accessory_t *a;
+    uint16_t                        delta;
+    size_t                          s;
+
+    if ((t->count + 1) * 2 > t->slot_count && grow_slots(t, 2 * t->slot_count) < 0)
+        return -1;
+
+    s = continuity_addr_find(t->slots, t->slot_count, t->accessories, sizeof(*t->accessories),
+            homekit->device_id);
+    if (t->slots[s]) {
+        a = &t->accessories[t->slots[s] - 1];
+    } else {
+        if (t->count == UINT32_MAX)
+            return -1;
+        if (t->count == t->capacity && grow_accessories(t, 2 * t->capacity) < 0)
+            return -1;
+        a = &t->accessories[t->count++];
+        memset(a, 0, sizeof(*a));
+        memcpy(a->device_id, homekit->device_id, 6);
+        a->global_state = homekit->global_state;
+        a->config_num = homekit->config_num;
+        a->first_ns = ts_ns;
+        a->last_ns = ts_ns;
+        t->slots[s] = (uint32_t)t->count;
+    }
+
+    if (ts_ns < a->last_ns)
+        ts_ns = a->last_ns;
+    a->last_ns = ts_ns;
+    a->adverts++;
+    a->category = homekit->category;
+
+    delta = (uint16_t)(homekit->global_state - a->global_state);
+    if (delta && delta < 0x8000) {
+        if (a->state_events) {
+            uint64_t    gap = ts_ns - a->state_ns;
+
+            if (a->state_events == 1 || gap < a->gap_min_ns)
+                a->gap_min_ns = gap;
+            if (gap > a->gap_max_ns)
+                a->gap_max_ns = gap;
+            a->gap_sum_ns += gap;
+        }
+        a->state_changes += delta;
+        a->state_events++;
+        a->state_ns = ts_ns;
+    } else if (delta) {
+        a->state_resets++;
+    }
+    a->global_state = homekit->global_state;
+
+    if (homekit->config_num != a->config_num) {
+        a->config_changes++;
+        a->config_ns = ts_ns;
+        a->config_num = homekit->config_num;
+    }
+
+    return 0;
+}
+
+int
+continuity_homekit_add_frame(continuity_homekit_tracker_t *t, uint64_t ts_ns,
+        const continuity_frame_t *frame)
+{
+    unsigned    i;
+
+    for (i = 0; i < frame->count; i++) {
+        const continuity_msg_t *msg = &frame->msgs[i];
+
+        if (msg->type == CONTINUITY_TYPE_HOMEKIT && msg->status == CONTINUITY_MSG_OK &&
+                continuity_homekit_add(t, ts_ns, &msg->u.homekit) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+const continuity_homekit_accessory_t *
+continuity_homekit_find(const continuity_homekit_tracker_t *t, const uint8_t device_id[6])
+{
+    size_t  s;
+
+    if (!t->slot_count)
+        return NULL;
+
+    s = continuity_addr_find(t->slots, t->slot_count, t->accessories, sizeof(*t->accessories),
+            device_id);
+
+    return t->slots[s] ? &t->accessories[t->slots[s] - 1] : NULL;
+}
+
+void
+continuity_homekit_free(continuity_homekit_tracker_t *t)
+{
+    free(t->accessories);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
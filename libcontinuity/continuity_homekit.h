@@ -0,0 +1,96 @@
+/* continuity_homekit.h
+ * Per-accessory HomeKit state-change tracking
+ *
+ * A HomeKit accessory advertises its Global State Number, which it bumps
+ * each time one of its characteristics changes, and its configuration
+ * number, which changes when its accessory database does.  The tracker
+ * follows both per accessory, keyed by the 6-byte HomeKit device ID rather
+ * than the advertiser address, which rotates.  Each accessory is one
+ * fixed-size record in an array, found through an open-addressing table
+ * of indexes that is grown when half full.  Both are sized up front for
+ * the expected accessory count, so a site with thousands of accessories
+ * is tracked without reallocating.
+ *
+ * State numbers are compared in serial number arithmetic (RFC 1982): a
+ * number up to 0x7fff ahead counts as that many changes, even if some of
+ * the adverts in between were missed, and anything else as a reset.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_HOMEKIT_H__
+#define __CONTINUITY_HOMEKIT_H__
+
+#include "continuity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t     device_id[6];       /* first: the accessory table key */
+    uint16_t    category;
+    uint16_t    global_state;       /* last seen */
+    uint8_t     config_num;         /* last seen */
+    uint64_t    adverts;
+    uint64_t    first_ns;           /* first advert */
+    uint64_t    last_ns;            /* last advert */
+    uint64_t    state_ns;           /* last state number increment; 0 if none */
+    uint64_t    config_ns;          /* last configuration change; 0 if none */
+    uint32_t    state_changes;      /* state number increments */
+    uint32_t    state_events;       /* adverts that brought one */
+    uint32_t    state_resets;       /* state number went back */
+    uint32_t    config_changes;
+    /* Time between consecutive state_events */
+    uint64_t    gap_min_ns;
+    uint64_t    gap_max_ns;
+    uint64_t    gap_sum_ns;
+} continuity_homekit_accessory_t;
+
+typedef struct {
+    continuity_homekit_accessory_t *accessories;    /* in the order first seen */
+    size_t                          count;
+    size_t                          capacity;
+    uint32_t                       *slots;          /* accessory index + 1, 0 if free */
+    size_t                          slot_count;     /* a power of two */
+} continuity_homekit_tracker_t;
+
+/* Size the tables for expected accessories.  Returns 0, or -1 if out of
+ * memory. */
+int continuity_homekit_init(continuity_homekit_tracker_t *t, size_t expected);
+
+/* Record a HomeKit message seen at ts_ns.  Times before the accessory's
+ * last advert are taken as that advert's time.  Returns 0, or -1 if out
+ * of memory. */
+int continuity_homekit_add(continuity_homekit_tracker_t *t, uint64_t ts_ns,
+        const continuity_homekit_t *homekit);
+
+/* Record every well-formed HomeKit message of a decoded frame.  Returns
+ * 0, or -1 if out of memory. */
+int continuity_homekit_add_frame(continuity_homekit_tracker_t *t, uint64_t ts_ns,
+        const continuity_frame_t *frame);
+
+/* The accessory with this device ID, or NULL */
+const continuity_homekit_accessory_t *continuity_homekit_find(const continuity_homekit_tracker_t *t,
+        const uint8_t device_id[6]);
+
+void continuity_homekit_free(continuity_homekit_tracker_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTINUITY_HOMEKIT_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,190 @@
+/* continuity_layouts.h
+ * Field layouts of the fixed Apple message formats
+ *
+ * The one description of the items each message layout holds, shared by
+ * the plugin (dissector/plugin/packet-continuity.c), which adds them to the
+ * protocol tree, and by continuity_fields.c, which reports them to offline
+ * tools.  It is an X-macro table rather than a normal header: the includer
+ * defines
+ *
+ *   CONTINUITY_LAYOUT(id, type, min_length, fields...)
+ *       a layout that describes the whole value of message type
+ *   CONTINUITY_PART_LAYOUT(id, min_length, fields...)
+ *       a layout the caller places at an offset of its own
+ *   CONTINUITY_FIELD(hf, name, kind, offset, length, mask, endian, depth, ett)
+ *
+ * and may include the table more than once; the macros are undefined at
+ * the end.  min_length is the value length needed for every field.  In a
+ * field, hf and ett are the plugin's header field and subtree (NULL for
+ * none), name is the display filter field name, kind a CONTINUITY_FIELD_*
+ * suffix, offset is relative to the start of the layout and a length of 0
+ * runs to the end of the value.  mask selects bits of a 1-byte field (0 for
+ * none); it must match the bitmask the plugin registers for hf.  endian is
+ * BE or LE for multi-byte integers.  A field with an ett opens a subtree
+ * that holds the following fields of the next depth.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* 3 - AirPrint */
+CONTINUITY_LAYOUT(airprint, CONTINUITY_TYPE_AIRPRINT, 22,
+    CONTINUITY_FIELD(hf_btcommon_apple_airprint_addrtype, "btcommon.apple.airprint.addrtype", BYTES, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airprint_resourcepathtype, "btcommon.apple.airprint.resourcepathtype", BYTES, 1, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airprint_securitytype, "btcommon.apple.airprint.securitytype", BYTES, 2, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airprint_qidport, "btcommon.apple.airprint.qidport", BYTES, 3, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airprint_ipaddr, "btcommon.apple.airprint.ipaddr", IPV6, 5, 16, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airprint_power, "btcommon.apple.airprint.power", BYTES, 21, 1, 0x00, BE, 0, NULL))
+
+/* 5 - AirDrop */
+CONTINUITY_LAYOUT(airdrop, CONTINUITY_TYPE_AIRDROP, 18,
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_prefix, "btcommon.apple.airdrop.prefix", BYTES, 0, 8, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_version, "btcommon.apple.airdrop.version", BYTES, 8, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_appleid, "btcommon.apple.airdrop.appleid", BYTES, 9, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_phone, "btcommon.apple.airdrop.phone", BYTES, 11, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_email, "btcommon.apple.airdrop.email", BYTES, 13, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_email2, "btcommon.apple.airdrop.email2", BYTES, 15, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airdrop_suffix, "btcommon.apple.airdrop.suffix", BYTES, 17, 1, 0x00, BE, 0, NULL))
+
+/* 6 - HomeKit */
+CONTINUITY_LAYOUT(homekit, CONTINUITY_TYPE_HOMEKIT, 13,
+    CONTINUITY_FIELD(hf_btcommon_apple_homekit_status, "btcommon.apple.homekit.status", BYTES, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_homekit_deviceid, "btcommon.apple.homekit.deviceid", BYTES, 1, 6, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_homekit_category, "btcommon.apple.homekit.category", UINT, 7, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_homekit_globalstatenum, "btcommon.apple.homekit.globalstatenum", BYTES, 9, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_homekit_confignum, "btcommon.apple.homekit.confignum", BYTES, 11, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_homekit_compver, "btcommon.apple.homekit.compver", BYTES, 12, 1, 0x00, BE, 0, NULL))
+
+/* 7 - Proximity Pairing (AirPods) */
+CONTINUITY_LAYOUT(airpods, CONTINUITY_TYPE_AIRPODS, 25,
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_prefix, "btcommon.apple.airpods.prefix", BYTES, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_devicemodel, "btcommon.apple.airpods.devicemodel", UINT, 1, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_status, "btcommon.apple.airpods.status", UINT, 3, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_battery_charging_status, "btcommon.apple.airpods.batterychargingstatus", NONE, 4, 2, 0x00, BE, 0, &ett_le_airpods),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_battery_status, "btcommon.apple.airpods.batterystatus", NONE, 4, 1, 0x00, BE, 1, &ett_le_airpods_battery),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_rightbattery, "btcommon.apple.airpods.rightbattery", UINT, 4, 1, 0xf0, BE, 2, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_leftbattery, "btcommon.apple.airpods.leftbattery", UINT, 4, 1, 0x0f, BE, 2, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_charging_status, "btcommon.apple.airpods.charingstatus", NONE, 5, 1, 0x00, BE, 1, &ett_le_airpods_charging),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_casecharging, "btcommon.apple.airpods.casecharging", BOOL, 5, 1, 0x40, BE, 2, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_rightcharging, "btcommon.apple.airpods.rightcharging", BOOL, 5, 1, 0x20, BE, 2, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_leftcharging, "btcommon.apple.airpods.leftcharging", BOOL, 5, 1, 0x10, BE, 2, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_casebattery_status, "btcommon.apple.airpods.casebatterystatus", NONE, 5, 1, 0x00, BE, 1, &ett_le_airpods_case),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_casebattery, "btcommon.apple.airpods.casebattery", UINT, 5, 1, 0x0f, BE, 2, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_opencount, "btcommon.apple.airpods.opencount", UINT, 6, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_devicecolor, "btcommon.apple.airpods.devicecolor", UINT, 7, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_suffix, "btcommon.apple.airpods.suffix", BYTES, 8, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airpods_encdata, "btcommon.apple.airpods.encdata", BYTES, 9, 16, 0x00, BE, 0, NULL))
+
+/* 8 - "Hey Siri" */
+CONTINUITY_LAYOUT(siri, CONTINUITY_TYPE_HEY_SIRI, 7,
+    CONTINUITY_FIELD(hf_btcommon_apple_siri_perphash, "btcommon.apple.siri.perphash", BYTES, 0, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_siri_snr, "btcommon.apple.siri.snr", BYTES, 2, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_siri_confidence, "btcommon.apple.siri.confidence", BYTES, 3, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_siri_deviceclass, "btcommon.apple.siri.deviceclass", UINT, 4, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_siri_randbyte, "btcommon.apple.siri.randbyte", BYTES, 6, 1, 0x00, BE, 0, NULL))
+
+/* 9 - AirPlay Target */
+CONTINUITY_LAYOUT(airplay_target, CONTINUITY_TYPE_AIRPLAY_TARGET, 6,
+    CONTINUITY_FIELD(hf_btcommon_apple_airplay_flags, "btcommon.apple.airplay.flags", BYTES, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airplay_seed, "btcommon.apple.airplay.seed", BYTES, 1, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_airplay_ip, "btcommon.apple.airplay.ip", IPV4, 2, 4, 0x00, BE, 0, NULL))
+
+/* 10 - AirPlay Source */
+CONTINUITY_LAYOUT(airplay_source, CONTINUITY_TYPE_AIRPLAY_SOURCE, 1,
+    CONTINUITY_FIELD(hf_btcommon_apple_airplay_data, "btcommon.apple.airplay.data", BYTES, 0, 1, 0x00, BE, 0, NULL))
+
+/* 11 - Magic Switch */
+CONTINUITY_LAYOUT(magicswitch, CONTINUITY_TYPE_MAGIC_SWITCH, 3,
+    CONTINUITY_FIELD(hf_btcommon_apple_magicswitch_data, "btcommon.apple.magicswitch.data", BYTES, 0, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_magicswitch_confidence, "btcommon.apple.magicswitch.confidence", UINT, 2, 1, 0x00, BE, 0, NULL))
+
+/* 12 - Handoff */
+CONTINUITY_LAYOUT(handoff, CONTINUITY_TYPE_HANDOFF, 4,
+    CONTINUITY_FIELD(hf_btcommon_apple_handoff_copy, "btcommon.apple.handoff.copy", BOOL, 0, 1, 0x0f, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_handoff_seqnum, "btcommon.apple.handoff.seqnum", UINT, 1, 2, 0x00, LE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_handoff_authtag, "btcommon.apple.handoff.authtag", BYTES, 3, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_handoff_encdata, "btcommon.apple.handoff.encdata", BYTES, 4, 0, 0x00, BE, 0, NULL))
+
+/* 13 - Tethering Target (Wi-Fi Settings Page) */
+CONTINUITY_LAYOUT(tethtgt, CONTINUITY_TYPE_TETHERING_TARGET, 0,
+    CONTINUITY_FIELD(hf_btcommon_apple_tethtgt_icloudid, "btcommon.apple.tethtgt.icloudid", BYTES, 0, 0, 0x00, BE, 0, NULL))
+
+/* 14 - Tethering Source (Instant Hotspot) */
+CONTINUITY_LAYOUT(tethsrc, CONTINUITY_TYPE_TETHERING_SOURCE, 6,
+    CONTINUITY_FIELD(hf_btcommon_apple_tethsrc_version, "btcommon.apple.tethsrc.version", BYTES, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_tethsrc_flags, "btcommon.apple.tethsrc.flags", BYTES, 1, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_tethsrc_battery, "btcommon.apple.tethsrc.battery", UINT, 2, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_tethsrc_celltype, "btcommon.apple.tethsrc.celltype", UINT, 3, 2, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_tethsrc_cellbars, "btcommon.apple.tethsrc.cellbars", UINT, 5, 1, 0x00, BE, 0, NULL))
+
+/* 15 - Nearby Action; the auth tag and parameters follow at a variable offset */
+CONTINUITY_PART_LAYOUT(nearbyaction_header, 2,
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_flags, "btcommon.apple.nearbyaction.flags", BYTES, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_flags_authtag, "btcommon.apple.nearybaction.flags.authtag", BOOL, 0, 1, 0x80, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_type, "btcommon.apple.nearbyaction.type", UINT, 1, 1, 0x00, BE, 0, NULL))
+
+CONTINUITY_PART_LAYOUT(nearbyaction_auth, 3,
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_auth, "btcommon.apple.nearbyaction.auth", BYTES, 0, 3, 0x00, BE, 0, NULL))
+
+CONTINUITY_PART_LAYOUT(nearbyaction_wifijoin, 12,
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_wifijoin_appleid, "btcommon.apple.nearbyaction.wifijoin.appleid", BYTES, 0, 3, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_wifijoin_phonenumber, "btcommon.apple.nearbyaction.wifijoin.phonenumber", BYTES, 3, 3, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_wifijoin_email, "btcommon.apple.nearbyaction.wifijoin.email", BYTES, 6, 3, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_wifijoin_ssid, "btcommon.apple.nearbyaction.wifijoin.ssid", BYTES, 9, 3, 0x00, BE, 0, NULL))
+
+CONTINUITY_PART_LAYOUT(nearbyaction_setup, 3,
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_setup_device_class, "btcommon.apple.nearbyaction.setup.device_class", UINT, 0, 1, 0xf0, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_setup_device_model, "btcommon.apple.nearbyaction.setup.device_model", UINT, 0, 1, 0x0f, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_setup_device_color, "btcommon.apple.nearbyaction.setup.device_color", UINT, 1, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyaction_setup_msg_version, "btcommon.apple.nearbyaction.setup.msg_ver", UINT, 2, 1, 0x00, BE, 0, NULL))
+
+/* 16 - Nearby Info; the auth tag length depends on the data flags.
+ *
+ * unk.flag and unk.flag2 are only seen on newer phones (iPhone 11).
+ * primary_device could also be face recognition capability (turning face
+ * recognition on/off does not toggle the bit), or having no home button
+ * (not tested on iPhone X/XR/XS, only iPhone 11).  airpod.connection is 1
+ * only with the screen on and AirPods connected. */
+CONTINUITY_PART_LAYOUT(nearbyinfo_status, 2,
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_statusflags, "btcommon.apple.nearbyinfo.statusflags", UINT, 0, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_unk_flag, "btcommon.apple.nearbyinfo.unk.flag", BOOL, 0, 1, 0x80, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_airdrop_status, "btcommon.apple.nearbyinfo.airdrop_status", BOOL, 0, 1, 0x40, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_unk_flag2, "btcommon.apple.nearbyinfo.unk.flag2", BOOL, 0, 1, 0x20, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_primary_device, "btcommon.apple.nearbyinfo.primary_device", BOOL, 0, 1, 0x10, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_action_code, "btcommon.apple.nearbyinfo.action_code", UINT, 0, 1, 0x0f, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_dataflags, "btcommon.apple.nearbyinfo.dataflags", UINT, 1, 1, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_autounlock_enabled, "btcommon.apple.nearbyinfo.autounlock_enabled", BOOL, 1, 1, 0x80, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_autounlock_watch, "btcommon.apple.nearbyinfo.autounlock_watch", BOOL, 1, 1, 0x40, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_watch_locked, "btcommon.apple.nearbyinfo.watch_locked", BOOL, 1, 1, 0x20, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_authtag_present, "btcommon.apple.nearbyinfo.authtag_present", BOOL, 1, 1, 0x10, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_unk_flag3, "btcommon.apple.nearbyinfo.unk.flag3", BOOL, 1, 1, 0x08, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_wifi_status, "btcommon.apple.nearbyinfo.wifi_status", BOOL, 1, 1, 0x04, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_authtag_fourbyte, "btcommon.apple.nearbyinfo.authtag.fourbyte", BOOL, 1, 1, 0x02, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_nearbyinfo_airpod_conn, "btcommon.apple.nearbyinfo.airpod.connection", BOOL, 1, 1, 0x01, BE, 0, NULL))
+
+/* 18 - Find My */
+CONTINUITY_PART_LAYOUT(findmy_full, 25,
+    CONTINUITY_FIELD(hf_btcommon_apple_findmy_status, "btcommon.apple.findmy.status", UINT, 0, 1, 0xe4, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_findmy_publickey, "btcommon.apple.findmy.publickey", BYTES, 1, 22, 0x00, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_findmy_publickeybits, "btcommon.apple.findmy.publickey.bits", UINT, 23, 1, 0x03, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_findmy_hint, "btcommon.apple.findmy.hint", UINT, 24, 1, 0x00, BE, 0, NULL))
+
+CONTINUITY_PART_LAYOUT(findmy_short, 2,
+    CONTINUITY_FIELD(hf_btcommon_apple_findmy_status, "btcommon.apple.findmy.status", UINT, 0, 1, 0xe4, BE, 0, NULL),
+    CONTINUITY_FIELD(hf_btcommon_apple_findmy_publickeybits, "btcommon.apple.findmy.publickey.bits", UINT, 1, 1, 0x03, BE, 0, NULL))
+
+#undef CONTINUITY_LAYOUT
+#undef CONTINUITY_PART_LAYOUT
+#undef CONTINUITY_FIELD
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
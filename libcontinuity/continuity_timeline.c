@@ -0,0 +1,348 @@
+/* continuity_timeline.c
+ * Per-device Nearby Info state and AirPods battery levels over time
+ *
+ * Devices are found through an open-addressing table of indexes into the
+ * device array (continuity_addr_table.h), kept at most half full.
+ *
+ * An AirPods sample is encoded as the nanoseconds since the previous
+ * sample (since 0 for the first) as a LEB128 varint, a byte with one
+ * AIRPODS_* bit per value that changed, then one byte per changed value in
+ * bit order.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "continuity_addr_table.h"
+#include "continuity_timeline.h"
+
+#define TIMELINE_MIN_SLOTS      64
+#define TIMELINE_MIN_INTERVALS  4
+#define TIMELINE_MIN_SAMPLES    64
+
+#define AIRPODS_LEFT            0x01
+#define AIRPODS_RIGHT           0x02
+#define AIRPODS_CASE            0x04
+#define AIRPODS_CHARGING        0x08
+#define AIRPODS_OPEN_COUNT      0x10
+#define AIRPODS_ALL             0x1f
+
+/* Longest encoded sample: a 64-bit varint, the mask and every value */
+#define AIRPODS_SAMPLE_MAX      (10 + 1 + 5)
+
+/* The slot holding addr, or the free slot where it would go */
+static size_t
+find_slot(const continuity_timeline_t *tl, const uint8_t addr[6])
+{
+    return continuity_addr_find(tl->slots, tl->slot_count, tl->devices, sizeof(*tl->devices), addr);
+}
+
+static int
+grow_slots(continuity_timeline_t *tl)
+{
+    size_t      slot_count = tl->slot_count ? 2 * tl->slot_count : TIMELINE_MIN_SLOTS;
+    uint32_t   *slots = continuity_addr_index(tl->devices, sizeof(*tl->devices), tl->count,
+            slot_count);
+
+    if (!slots)
+        return -1;
+
+    free(tl->slots);
+    tl->slots = slots;
+    tl->slot_count = slot_count;
+
+    return 0;
+}
+
+static continuity_timeline_device_t *
+get_device(continuity_timeline_t *tl, const uint8_t addr[6])
+{
+    continuity_timeline_device_t   *device;
+    size_t                          s;
+
+    if ((tl->count + 1) * 2 > tl->slot_count && grow_slots(tl) < 0)
+        return NULL;
+
+    s = find_slot(tl, addr);
+    if (tl->slots[s])
+        return &tl->devices[tl->slots[s] - 1];
+
+    if (tl->count == UINT32_MAX)
+        return NULL;
+    if (tl->count == tl->capacity) {
+        size_t  capacity = tl->capacity ? 2 * tl->capacity : TIMELINE_MIN_SLOTS / 2;
+        void   *p = realloc(tl->devices, capacity * sizeof(*tl->devices));
+
+        if (!p)
+            return NULL;
+        tl->devices = p;
+        tl->capacity = capacity;
+    }
+
+    device = &tl->devices[tl->count++];
+    memset(device, 0, sizeof(*device));
+    memcpy(device->addr, addr, 6);
+    tl->slots[s] = (uint32_t)tl->count;
+
+    return device;
+}
+
+void
+continuity_timeline_init(continuity_timeline_t *tl)
+{
+    memset(tl, 0, sizeof(*tl));
+}
+
+int
+continuity_timeline_add(continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns,
+        uint8_t action_code, uint8_t status_flags)
+{
+    continuity_timeline_device_t   *device = get_device(tl, addr);
+    continuity_interval_t          *last;
+
+    if (!device)
+        return -1;
+
+    last = device->count ? &device->intervals[device->count - 1] : NULL;
+    if (last && ts_ns < last->end_ns)
+        ts_ns = last->end_ns;
+
+    if (last && last->action_code == action_code && last->status_flags == status_flags) {
+        last->end_ns = ts_ns;
+        if (last->adverts < UINT32_MAX)
+            last->adverts++;
+        return 0;
+    }
+
+    if (device->count == device->capacity) {
+        size_t  capacity = device->capacity ? 2 * device->capacity : TIMELINE_MIN_INTERVALS;
+        void   *p = realloc(device->intervals, capacity * sizeof(*device->intervals));
+
+        if (!p)
+            return -1;
+        device->intervals = p;
+        device->capacity = capacity;
+    }
+
+    last = &device->intervals[device->count++];
+    last->start_ns = ts_ns;
+    last->end_ns = ts_ns;
+    last->adverts = 1;
+    last->action_code = action_code;
+    last->status_flags = status_flags;
+
+    return 0;
+}
+
+static uint8_t *
+put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+
+    return p;
+}
+
+int
+continuity_timeline_add_airpods(continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns,
+        const continuity_airpods_t *airpods)
+{
+    continuity_timeline_device_t   *device = get_device(tl, addr);
+    continuity_airpods_sample_t    *last;
+    continuity_airpods_sample_t     sample;
+    uint8_t                         mask = AIRPODS_ALL;
+    uint8_t                        *p;
+
+    if (!device)
+        return -1;
+
+    last = &device->airpods_last;
+    if (device->airpods_adverts && ts_ns < device->airpods_end_ns)
+        ts_ns = device->airpods_end_ns;
+
+    sample.ts_ns = ts_ns;
+    sample.left_battery = airpods->left_battery;
+    sample.right_battery = airpods->right_battery;
+    sample.case_battery = airpods->case_battery;
+    sample.charging = (uint8_t)(airpods->case_charging << 2 | airpods->right_charging << 1 |
+            airpods->left_charging);
+    sample.open_count = airpods->open_count;
+
+    if (device->airpods_count) {
+        mask = 0;
+        if (sample.left_battery != last->left_battery)
+            mask |= AIRPODS_LEFT;
+        if (sample.right_battery != last->right_battery)
+            mask |= AIRPODS_RIGHT;
+        if (sample.case_battery != last->case_battery)
+            mask |= AIRPODS_CASE;
+        if (sample.charging != last->charging)
+            mask |= AIRPODS_CHARGING;
+        if (sample.open_count != last->open_count)
+            mask |= AIRPODS_OPEN_COUNT;
+    }
+
+    device->airpods_adverts++;
+    device->airpods_end_ns = ts_ns;
+    if (!mask)
+        return 0;
+
+    if (device->airpods_cap - device->airpods_len < AIRPODS_SAMPLE_MAX) {
+        size_t  capacity = device->airpods_cap ? 2 * device->airpods_cap : TIMELINE_MIN_SAMPLES;
+        void   *q = realloc(device->airpods, capacity);
+
+        if (!q)
+            return -1;
+        device->airpods = q;
+        device->airpods_cap = capacity;
+    }
+
+    p = put_varint(device->airpods + device->airpods_len, ts_ns - last->ts_ns);
+    *p++ = mask;
+    if (mask & AIRPODS_LEFT)
+        *p++ = sample.left_battery;
+    if (mask & AIRPODS_RIGHT)
+        *p++ = sample.right_battery;
+    if (mask & AIRPODS_CASE)
+        *p++ = sample.case_battery;
+    if (mask & AIRPODS_CHARGING)
+        *p++ = sample.charging;
+    if (mask & AIRPODS_OPEN_COUNT)
+        *p++ = sample.open_count;
+    device->airpods_len = (size_t)(p - device->airpods);
+    device->airpods_count++;
+    *last = sample;
+
+    return 0;
+}
+
+int
+continuity_timeline_add_frame(continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns,
+        const continuity_frame_t *frame)
+{
+    unsigned    i;
+
+    for (i = 0; i < frame->count; i++) {
+        const continuity_msg_t *msg = &frame->msgs[i];
+
+        if (msg->status != CONTINUITY_MSG_OK)
+            continue;
+        if (msg->type == CONTINUITY_TYPE_NEARBY_INFO &&
+                continuity_timeline_add(tl, addr, ts_ns, msg->u.nearby_info.action_code,
+                    msg->u.nearby_info.status_flags) < 0)
+            return -1;
+        if (msg->type == CONTINUITY_TYPE_AIRPODS &&
+                continuity_timeline_add_airpods(tl, addr, ts_ns, &msg->u.airpods) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+const continuity_timeline_device_t *
+continuity_timeline_find(const continuity_timeline_t *tl, const uint8_t addr[6])
+{
+    size_t  s;
+
+    if (!tl->slot_count)
+        return NULL;
+
+    s = find_slot(tl, addr);
+    if (!tl->slots[s])
+        return NULL;
+    if (!tl->devices[tl->slots[s] - 1].count && !tl->devices[tl->slots[s] - 1].airpods_count)
+        return NULL;
+
+    return &tl->devices[tl->slots[s] - 1];
+}
+
+const continuity_interval_t *
+continuity_timeline_at(const continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns)
+{
+    const continuity_timeline_device_t *device = continuity_timeline_find(tl, addr);
+    size_t                              lo = 0;
+    size_t                              hi;
+
+    if (!device)
+        return NULL;
+
+    /* The first interval starting after ts_ns; the one before it holds ts_ns */
+    hi = device->count;
+    while (lo < hi) {
+        size_t  mid = lo + (hi - lo) / 2;
+
+        if (device->intervals[mid].start_ns <= ts_ns)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo ? &device->intervals[lo - 1] : NULL;
+}
+
+bool
+continuity_airpods_next(const continuity_timeline_device_t *device,
+        continuity_airpods_cursor_t *cursor)
+{
+    const uint8_t  *p = device->airpods + cursor->pos;
+    const uint8_t  *end = device->airpods + device->airpods_len;
+    uint64_t        delta = 0;
+    unsigned        shift = 0;
+    uint8_t         mask;
+
+    if (p >= end)
+        return false;
+
+    do {
+        delta |= (uint64_t)(*p & 0x7f) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    mask = *p++;
+
+    cursor->sample.ts_ns += delta;
+    if (mask & AIRPODS_LEFT)
+        cursor->sample.left_battery = *p++;
+    if (mask & AIRPODS_RIGHT)
+        cursor->sample.right_battery = *p++;
+    if (mask & AIRPODS_CASE)
+        cursor->sample.case_battery = *p++;
+    if (mask & AIRPODS_CHARGING)
+        cursor->sample.charging = *p++;
+    if (mask & AIRPODS_OPEN_COUNT)
+        cursor->sample.open_count = *p++;
+    cursor->pos = (size_t)(p - device->airpods);
+
+    return true;
+}
+
+void
+continuity_timeline_free(continuity_timeline_t *tl)
+{
+    size_t  d;
+
+    for (d = 0; d < tl->count; d++) {
+        free(tl->devices[d].intervals);
+        free(tl->devices[d].airpods);
+    }
+    free(tl->devices);
+    free(tl->slots);
+    memset(tl, 0, sizeof(*tl));
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,137 @@
+/* continuity_timeline.h
+ * Per-device Nearby Info state and AirPods battery levels over time
+ *
+ * A device repeats the same Nearby Info action code and status flags in
+ * advert after advert, for minutes at a time.  The timeline keeps one
+ * interval per run of identical states: a new interval starts only when
+ * the state changes, so its size follows the device's transitions rather
+ * than its advert count.  Intervals are appended in time order, which lets
+ * continuity_timeline_at() answer "what state was the device in at time T"
+ * by binary search.
+ *
+ * AirPods battery levels, charging bits and lid open count are kept the
+ * same way, as samples taken only when a value changes.  The samples are
+ * delta-encoded into a byte stream: the time since the previous sample,
+ * a mask of the values that changed and the new values, a few bytes per
+ * sample.  continuity_airpods_next() decodes them in order.
+ *
+ * Unlike the decoder, the timeline allocates: a table of devices, and a
+ * growing array of intervals and sample stream per device.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_TIMELINE_H__
+#define __CONTINUITY_TIMELINE_H__
+
+#include "continuity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One run of adverts with the same state */
+typedef struct {
+    uint64_t    start_ns;       /* first advert of the run */
+    uint64_t    end_ns;         /* last advert of the run */
+    uint32_t    adverts;
+    uint8_t     action_code;    /* btcommon.apple.nearbyinfo.action_code */
+    uint8_t     status_flags;   /* upper nibble of the first byte */
+} continuity_interval_t;
+
+/* AirPods values at ts_ns.  Battery levels are x10%, 15 when unknown. */
+typedef struct {
+    uint64_t    ts_ns;
+    uint8_t     left_battery;
+    uint8_t     right_battery;
+    uint8_t     case_battery;
+    uint8_t     charging;       /* bit 2 case, bit 1 right, bit 0 left */
+    uint8_t     open_count;
+} continuity_airpods_sample_t;
+
+typedef struct {
+    uint8_t                 addr[6];    /* first: the device table key */
+    continuity_interval_t  *intervals;  /* by start_ns */
+    size_t                  count;
+    size_t                  capacity;
+    /* AirPods samples, delta-encoded */
+    uint8_t                *airpods;
+    size_t                  airpods_len;
+    size_t                  airpods_cap;
+    size_t                  airpods_count;      /* samples stored */
+    uint64_t                airpods_adverts;    /* AirPods messages seen */
+    uint64_t                airpods_end_ns;     /* last AirPods message */
+    continuity_airpods_sample_t airpods_last;   /* the last sample stored */
+} continuity_timeline_device_t;
+
+/* Position in a device's AirPods samples; zero it to start */
+typedef struct {
+    size_t                      pos;
+    continuity_airpods_sample_t sample;
+} continuity_airpods_cursor_t;
+
+typedef struct {
+    continuity_timeline_device_t   *devices;    /* in the order first seen */
+    size_t                          count;
+    size_t                          capacity;
+    uint32_t                       *slots;      /* device index + 1, 0 if free */
+    size_t                          slot_count; /* a power of two */
+} continuity_timeline_t;
+
+void continuity_timeline_init(continuity_timeline_t *tl);
+
+/* Record the device at addr in this state at ts_ns.  A time before the
+ * device's last advert is taken as that advert's time, so the intervals
+ * stay in order.  Returns 0, or -1 if out of memory. */
+int continuity_timeline_add(continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns,
+        uint8_t action_code, uint8_t status_flags);
+
+/* Record the AirPods values of the device at addr at ts_ns; a sample is
+ * stored only if one of them changed.  Times go back no further than the
+ * last AirPods message, as for continuity_timeline_add().  Returns 0, or
+ * -1 if out of memory. */
+int continuity_timeline_add_airpods(continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns,
+        const continuity_airpods_t *airpods);
+
+/* Record every well-formed Nearby Info and AirPods message of a decoded
+ * frame.  Returns 0, or -1 if out of memory. */
+int continuity_timeline_add_frame(continuity_timeline_t *tl, const uint8_t addr[6], uint64_t ts_ns,
+        const continuity_frame_t *frame);
+
+/* The device at addr, or NULL if nothing was recorded for it */
+const continuity_timeline_device_t *continuity_timeline_find(const continuity_timeline_t *tl,
+        const uint8_t addr[6]);
+
+/* The interval the device at addr was in at ts_ns: the last one starting
+ * at or before it.  The device is taken to stay in a state until its next
+ * interval starts, so past end_ns the state was last seen rather than
+ * seen.  NULL if the device is unknown or ts_ns is before its first
+ * advert. */
+const continuity_interval_t *continuity_timeline_at(const continuity_timeline_t *tl,
+        const uint8_t addr[6], uint64_t ts_ns);
+
+/* Decode the device's next AirPods sample into cursor->sample.  Returns
+ * false after the last one. */
+bool continuity_airpods_next(const continuity_timeline_device_t *device,
+        continuity_airpods_cursor_t *cursor);
+
+void continuity_timeline_free(continuity_timeline_t *tl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTINUITY_TIMELINE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,97 @@
+/* continuity_values.h
+ * Value lengths and validity checks of the Apple message layouts
+ *
+ * Internal to libcontinuity, shared by continuity_decode() and
+ * continuity_decode_batch() so the two accept exactly the same values.
+ * Lengths are of the value, after the type and length bytes; see
+ * messages/.  A check says whether continuity_decode() marks a message
+ * of that type and length CONTINUITY_MSG_OK rather than _SHORT.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CONTINUITY_VALUES_H__
+#define __CONTINUITY_VALUES_H__
+
+#include "continuity.h"
+
+/* Fixed layout lengths */
+#define AIRPRINT_MIN_LEN            21  /* Measured Power is sometimes left off */
+#define AIRPRINT_LEN                22
+#define AIRDROP_LEN                 18
+#define HOMEKIT_LEN                 13
+#define AIRPODS_LEN                 25
+#define SIRI_LEN                    7
+#define AIRPLAY_TARGET_LEN          6
+#define AIRPLAY_SOURCE_LEN          1
+#define MAGIC_SWITCH_LEN            3
+#define HANDOFF_MIN_LEN             4
+#define TETHERING_SOURCE_LEN        6
+#define NEARBY_ACTION_SHORT_LEN     2
+#define NEARBY_ACTION_AUTH_LEN      3
+#define NEARBY_ACTION_WIFI_LEN      12
+#define NEARBY_ACTION_SETUP_LEN     3
+#define NEARBY_INFO_MIN_LEN         1
+
+#define NEARBY_ACTION_FLAG_AUTH     0x80
+#define NEARBY_INFO_FLAG_AUTH       0x10
+#define NEARBY_INFO_FLAG_AUTH4      0x02
+
+#define GET_BE16(p)     ((uint16_t)(((uint16_t)(p)[0] << 8) | (p)[1]))
+#define GET_LE16(p)     ((uint16_t)(((uint16_t)(p)[1] << 8) | (p)[0]))
+
+static inline bool
+continuity_airpods_ok(size_t len)
+{
+    return len >= AIRPODS_LEN;
+}
+
+static inline bool
+continuity_handoff_ok(size_t len)
+{
+    return len >= HANDOFF_MIN_LEN;
+}
+
+/* The 2-byte form, or flags and type followed by the auth tag if flagged */
+static inline bool
+continuity_nearby_action_ok(const uint8_t *v, size_t len)
+{
+    if (len <= NEARBY_ACTION_SHORT_LEN)
+        return len == NEARBY_ACTION_SHORT_LEN;
+
+    return !(v[0] & NEARBY_ACTION_FLAG_AUTH) ||
+        len >= NEARBY_ACTION_SHORT_LEN + NEARBY_ACTION_AUTH_LEN;
+}
+
+static inline bool
+continuity_nearby_info_ok(size_t len)
+{
+    return len >= NEARBY_INFO_MIN_LEN;
+}
+
+/* Find My values of any length are well-formed; the length picks the form */
+static inline uint8_t
+continuity_findmy_form(size_t len)
+{
+    if (len == CONTINUITY_FINDMY_FULL_LEN)
+        return CONTINUITY_FINDMY_FULL;
+    if (len == CONTINUITY_FINDMY_SHORT_LEN)
+        return CONTINUITY_FINDMY_SHORT;
+
+    return CONTINUITY_FINDMY_DATA;
+}
+
+#endif /* __CONTINUITY_VALUES_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
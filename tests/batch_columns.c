@@ -0,0 +1,275 @@
+/* batch_columns.c
+ * Checks continuity_decode_batch() columns against continuity_decode()
+ *
+ * Runs synthetic adverts of every message type, random bytes shaped as
+ * column-set TLVs of every value length, and hand-made payloads at the
+ * layout edges through both, and compares each row with the decoded
+ * struct of the message it came from.  Prints the first mismatches and
+ * exits non-zero if there were any.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "continuity.h"
+#include "continuity_batch.h"
+#include "synth.h"
+
+#define VECTORS         8192
+#define MAX_PAYLOAD_LEN 255
+#define ROWS            (VECTORS * CONTINUITY_MAX_MSGS)
+
+/* Every column of every column set, for continuity_batch_init() */
+static uint32_t column_storage[(ROWS * CONTINUITY_BATCH_ROW_BYTES + 3) / 4];
+
+static uint8_t  payloads[VECTORS][MAX_PAYLOAD_LEN];
+static continuity_advert_t adverts[VECTORS];
+static size_t   advert_count;
+static unsigned failures;
+
+/* Payloads at the edges of the column-set layouts */
+static const uint8_t edge_nearby_action_short[] = { 0x0f, 0x02, 0x40, 0x08 };
+static const uint8_t edge_nearby_action_noauth[] = { 0x0f, 0x03, 0x80, 0x09, 0x11 };
+static const uint8_t edge_nearby_action_auth[] = { 0x0f, 0x05, 0x80, 0x09, 0x11, 0x22, 0x33 };
+static const uint8_t edge_nearby_info_1[] = { 0x10, 0x01, 0x5b };
+static const uint8_t edge_nearby_info_auth3[] = { 0x10, 0x05, 0x1b, 0x10, 0xaa, 0xbb, 0xcc };
+static const uint8_t edge_findmy_odd[] = { 0x12, 0x05, 0x10, 0x01, 0x02, 0x03, 0x04 };
+static const uint8_t edge_findmy_short[] = { 0x12, 0x02, 0x10, 0x02 };
+static const uint8_t edge_handoff_short[] = { 0x0c, 0x03, 0x00, 0x12, 0x34 };
+static const uint8_t edge_airpods_short[] = { 0x07, 0x09, 0x01, 0x20, 0x0e, 0x55, 0xa8, 0x31, 0x10, 0x01, 0x00 };
+static const uint8_t edge_truncated[] = { 0x10, 0x02, 0x1b, 0x10, 0x0c, 0x0e, 0x00 };
+
+static void
+check(bool ok, const char *what, size_t advert, unsigned msg)
+{
+    if (ok)
+        return;
+    if (failures++ < 20)
+        printf("advert %zu message %u: %s differs\n", advert, msg, what);
+}
+
+static void
+add(const uint8_t *data, size_t len)
+{
+    if (advert_count == VECTORS)
+        return;
+    memcpy(payloads[advert_count], data, len);
+    adverts[advert_count].data = payloads[advert_count];
+    adverts[advert_count].len  = len;
+    advert_count++;
+}
+
+/* Compare one decoded message with its row; r counts rows per set */
+static void
+compare_msg(const continuity_batch_t *b, const continuity_msg_t *msg, size_t a, unsigned i,
+        size_t r[5])
+{
+    size_t  k;
+
+    switch (msg->type) {
+    case CONTINUITY_TYPE_AIRPODS: {
+        const continuity_airpods_t *m = &msg->u.airpods;
+
+        k = r[0]++;
+        if (k >= b->airpods.count || b->airpods.advert[k] != a) {
+            check(false, "airpods row", a, i);
+            break;
+        }
+        check(b->airpods.model[k] == m->model, "airpods model", a, i);
+        check(b->airpods.status[k] == m->status, "airpods status", a, i);
+        check(b->airpods.right_battery[k] == m->right_battery, "airpods right_battery", a, i);
+        check(b->airpods.left_battery[k] == m->left_battery, "airpods left_battery", a, i);
+        check(b->airpods.case_battery[k] == m->case_battery, "airpods case_battery", a, i);
+        check(b->airpods.charging[k] == (m->case_charging << 2 | m->right_charging << 1 |
+                    m->left_charging), "airpods charging", a, i);
+        check(b->airpods.open_count[k] == m->open_count, "airpods open_count", a, i);
+        check(b->airpods.color[k] == m->color, "airpods color", a, i);
+        break;
+    }
+    case CONTINUITY_TYPE_HANDOFF: {
+        const continuity_handoff_t *m = &msg->u.handoff;
+
+        k = r[1]++;
+        if (k >= b->handoff.count || b->handoff.advert[k] != a) {
+            check(false, "handoff row", a, i);
+            break;
+        }
+        check(b->handoff.copy[k] == m->copy, "handoff copy", a, i);
+        check(b->handoff.seqnum[k] == m->seqnum, "handoff seqnum", a, i);
+        check(b->handoff.authtag[k] == m->authtag, "handoff authtag", a, i);
+        break;
+    }
+    case CONTINUITY_TYPE_NEARBY_ACTION: {
+        const continuity_nearby_action_t *m = &msg->u.nearby_action;
+
+        k = r[2]++;
+        if (k >= b->nearby_action.count || b->nearby_action.advert[k] != a) {
+            check(false, "nearby_action row", a, i);
+            break;
+        }
+        check(b->nearby_action.short_form[k] == m->short_form, "nearby_action short_form", a, i);
+        check(b->nearby_action.flags[k] == m->flags, "nearby_action flags", a, i);
+        check(b->nearby_action.type[k] == m->type, "nearby_action type", a, i);
+        break;
+    }
+    case CONTINUITY_TYPE_NEARBY_INFO: {
+        const continuity_nearby_info_t *m = &msg->u.nearby_info;
+
+        k = r[3]++;
+        if (k >= b->nearby_info.count || b->nearby_info.advert[k] != a) {
+            check(false, "nearby_info row", a, i);
+            break;
+        }
+        check(b->nearby_info.status_flags[k] == m->status_flags, "nearby_info status_flags", a, i);
+        check(b->nearby_info.action_code[k] == m->action_code, "nearby_info action_code", a, i);
+        check(b->nearby_info.data_flags[k] == m->data_flags, "nearby_info data_flags", a, i);
+        break;
+    }
+    case CONTINUITY_TYPE_FINDMY: {
+        const continuity_findmy_t *m = &msg->u.findmy;
+
+        k = r[4]++;
+        if (k >= b->findmy.count || b->findmy.advert[k] != a) {
+            check(false, "findmy row", a, i);
+            break;
+        }
+        check(b->findmy.form[k] == m->form, "findmy form", a, i);
+        check(b->findmy.status[k] == m->status, "findmy status", a, i);
+        check(b->findmy.key_bits[k] == m->key_bits, "findmy key_bits", a, i);
+        check(b->findmy.hint[k] == m->hint, "findmy hint", a, i);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+int
+main(void)
+{
+    static const uint8_t columned[] = {
+        CONTINUITY_TYPE_AIRPODS, CONTINUITY_TYPE_HANDOFF, CONTINUITY_TYPE_NEARBY_ACTION,
+        CONTINUITY_TYPE_NEARBY_INFO, CONTINUITY_TYPE_FINDMY
+    };
+    static continuity_batch_t batch;
+    continuity_frame_t  frame;
+    synth_rng_t         rng;
+    uint8_t             buf[MAX_PAYLOAD_LEN];
+    size_t              rows;
+    size_t              r[5] = { 0 };
+    size_t              messages = 0;
+    size_t              truncated = 0;
+    size_t              skipped = 0;
+    size_t              a;
+    unsigned            i;
+    unsigned            t;
+
+    synth_seed(&rng, 1);
+    for (t = 0; t < SYNTH_TYPE_COUNT; t++) {
+        for (i = 0; i < 200; i++)
+            add(buf, synth_payload(&synth_types[t], 1, &rng, buf, sizeof(buf)));
+    }
+    for (i = 0; i < 400; i++) {
+        uint8_t types[CONTINUITY_MAX_MSGS + 4];
+        size_t  n = 1 + synth_next(&rng) % 4;
+        size_t  k;
+
+        for (k = 0; k < n; k++)
+            types[k] = columned[synth_next(&rng) % sizeof(columned)];
+        add(buf, synth_payload(types, n, &rng, buf, sizeof(buf)));
+    }
+
+    /* Any value length, and lengths running past the end of the payload */
+    for (i = 0; i < 1000; i++) {
+        size_t  len = 0;
+        size_t  n = 1 + synth_next(&rng) % 3;
+        size_t  k;
+
+        for (k = 0; k < n && len + 2 <= 64; k++) {
+            size_t  value_len = synth_next(&rng) % 30;
+            size_t  j;
+
+            buf[len++] = columned[synth_next(&rng) % sizeof(columned)];
+            buf[len++] = (uint8_t)value_len;
+            for (j = 0; j < value_len && len < 64; j++)
+                buf[len++] = (uint8_t)synth_next(&rng);
+        }
+        add(buf, len);
+    }
+
+    add(edge_nearby_action_short, sizeof(edge_nearby_action_short));
+    add(edge_nearby_action_noauth, sizeof(edge_nearby_action_noauth));
+    add(edge_nearby_action_auth, sizeof(edge_nearby_action_auth));
+    add(edge_nearby_info_1, sizeof(edge_nearby_info_1));
+    add(edge_nearby_info_auth3, sizeof(edge_nearby_info_auth3));
+    add(edge_findmy_odd, sizeof(edge_findmy_odd));
+    add(edge_findmy_short, sizeof(edge_findmy_short));
+    add(edge_handoff_short, sizeof(edge_handoff_short));
+    add(edge_airpods_short, sizeof(edge_airpods_short));
+    add(edge_truncated, sizeof(edge_truncated));
+
+    /* More TLVs than continuity_decode() reads from one payload */
+    for (i = 0; i < CONTINUITY_MAX_MSGS + 4; i++)
+        memcpy(buf + 3 * i, edge_nearby_info_1, sizeof(edge_nearby_info_1));
+    add(buf, 3 * (CONTINUITY_MAX_MSGS + 4));
+
+    continuity_batch_init(&batch, column_storage, ROWS);
+    rows = continuity_decode_batch(adverts, advert_count, &batch);
+
+    for (a = 0; a < advert_count; a++) {
+        continuity_decode(adverts[a].data, adverts[a].len, &frame);
+        for (i = 0; i < frame.count; i++) {
+            const continuity_msg_t *msg = &frame.msgs[i];
+            bool                    has_columns = memchr(columned, msg->type,
+                    sizeof(columned)) != NULL;
+
+            if (msg->status == CONTINUITY_MSG_TRUNCATED) {
+                truncated++;
+                continue;
+            }
+            messages++;
+            if (msg->status == CONTINUITY_MSG_SHORT)
+                skipped += has_columns;
+            else
+                compare_msg(&batch, msg, a, i, r);
+        }
+    }
+
+    check(r[0] == batch.airpods.count, "airpods row count", a, 0);
+    check(r[1] == batch.handoff.count, "handoff row count", a, 0);
+    check(r[2] == batch.nearby_action.count, "nearby_action row count", a, 0);
+    check(r[3] == batch.nearby_info.count, "nearby_info row count", a, 0);
+    check(r[4] == batch.findmy.count, "findmy row count", a, 0);
+    check(rows == r[0] + r[1] + r[2] + r[3] + r[4], "returned row count", a, 0);
+    check(batch.adverts == advert_count, "advert count", a, 0);
+    check(batch.messages == messages, "message count", a, 0);
+    check(batch.truncated == truncated, "truncated count", a, 0);
+    check(batch.skipped == skipped, "skipped count", a, 0);
+    check(batch.dropped == 0, "dropped count", a, 0);
+
+    /* A full column set drops rows instead of writing past capacity */
+    continuity_batch_reset(&batch);
+    batch.nearby_info.capacity = 4;
+    continuity_decode_batch(&adverts[advert_count - 1], 1, &batch);
+    check(batch.nearby_info.count == 4 && batch.dropped == CONTINUITY_MAX_MSGS - 4,
+            "capacity", advert_count - 1, 0);
+
+    printf("%zu adverts, %zu rows, %u mismatches\n", advert_count, rows, failures);
+
+    return failures ? 1 : 0;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
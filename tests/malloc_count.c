@@ -0,0 +1,103 @@
+/* malloc_count.c
+ * LD_PRELOAD shim that counts heap allocations, for plugin-bench.sh
+ *
+ * Counts the calls to malloc(), calloc(), realloc() and the aligned
+ * allocators and writes the total to the file named by MALLOC_COUNT_OUT
+ * when the process exits.  Each call is passed on to glibc's own
+ * allocator, so this only works with glibc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static atomic_ulong allocations;
+
+static void
+count(void)
+{
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+}
+
+void *
+malloc(size_t size)
+{
+    count();
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t n, size_t size)
+{
+    count();
+    return __libc_calloc(n, size);
+}
+
+void *
+realloc(void *p, size_t size)
+{
+    count();
+    return __libc_realloc(p, size);
+}
+
+void *
+memalign(size_t alignment, size_t size)
+{
+    count();
+    return __libc_memalign(alignment, size);
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+    count();
+    return __libc_memalign(alignment, size);
+}
+
+int
+posix_memalign(void **p, size_t alignment, size_t size)
+{
+    void   *q;
+
+    count();
+    if (!(q = __libc_memalign(alignment, size)))
+        return ENOMEM;
+    *p = q;
+
+    return 0;
+}
+
+__attribute__((destructor)) static void
+report(void)
+{
+    const char *path = getenv("MALLOC_COUNT_OUT");
+    FILE       *f;
+
+    if (!path || !(f = fopen(path, "w")))
+        return;
+    fprintf(f, "%lu\n", (unsigned long)atomic_load(&allocations));
+    fclose(f);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,110 @@
+#!/bin/bash
+# plugin-bench.sh [-c adverts] [-r runs] [capture]
+#
+# Times the Continuity plugin inside tshark, the costs continuity-bench
+# cannot see: epan adding tree items, and the plugin's file-scope wmem
+# allocations for the frame cache, device and Handoff links and interned
+# Find My keys.  The capture (by default a continuity-gen one of -c
+# adverts) is read three ways:
+#
+#   no tree     tshark -q, which dissects without a protocol tree
+#   filter      tshark -q -Y btcommon.apple.type, a tree holding only
+#               what the filter refers to
+#   tree        tshark -V, the full tree
+#
+# each with the plugin and with --disable-protocol btcommon.apple.  The
+# difference is the plugin's share: ns per advert (best of -r runs),
+# allocations per advert, counted by malloc_count.c with wmem made to
+# allocate every object from the heap, and tree items per advert.
+#
+# Needs tshark with the plugin installed and glibc; CC and CFLAGS are
+# honoured.  Exits 77 if tshark cannot load the plugin.
+TOP=$(cd "$(dirname "$0")/.." && pwd)
+LIB=$TOP/libcontinuity
+TOOLS=$TOP/tools
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2 -Wall}
+COUNT=200000
+RUNS=3
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+while getopts c:r: opt ; do
+    case $opt in
+    c) COUNT=$OPTARG ;;
+    r) RUNS=$OPTARG ;;
+    *) echo "usage: $0 [-c adverts] [-r runs] [capture]" >&2 ; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if ! command -v tshark > /dev/null ||
+        ! tshark -G protocols 2> /dev/null | grep -q 'btcommon\.apple' ; then
+    echo "plugin-bench: tshark with the Continuity plugin is needed" >&2
+    exit 77
+fi
+
+$CC $CFLAGS -shared -fPIC -o "$WORK/malloc_count.so" "$TOP/tests/malloc_count.c" || exit 1
+if [ $# -gt 0 ] ; then
+    CAPTURE=$1
+else
+    CAPTURE=$WORK/bench.pcapng
+    $CC $CFLAGS -I"$LIB" -o "$WORK/continuity-gen" "$TOOLS/continuity-gen.c" \
+        "$TOOLS/synth.c" "$TOOLS/btle.c" "$TOOLS/pcapng.c" "$LIB/continuity.c" || exit 1
+    "$WORK/continuity-gen" -d 300 -i 20 -c "$COUNT" -o "$CAPTURE" || exit 1
+fi
+ADVERTS=$(tshark -n -r "$CAPTURE" -T fields -e frame.number | tail -n 1)
+[ "${ADVERTS:-0}" -gt 0 ] || { echo "plugin-bench: $CAPTURE: no packets" >&2 ; exit 1 ; }
+
+# run MODE [tshark options...]: dissect the capture one way, output dropped
+run() {
+    local mode=$1
+
+    shift
+    case $mode in
+    none)   tshark -n -r "$CAPTURE" -q "$@" ;;
+    filter) tshark -n -r "$CAPTURE" -q -Y btcommon.apple.type "$@" ;;
+    tree)   tshark -n -r "$CAPTURE" -V "$@" ;;
+    esac > /dev/null
+}
+
+# best_ns MODE [tshark options...]: the fastest of RUNS runs, in ns
+best_ns() {
+    local best= start end i
+
+    for ((i = 0; i < RUNS; i++)) ; do
+        start=$(date +%s%N)
+        run "$@" || return 1
+        end=$(date +%s%N)
+        if [ -z "$best" ] || [ $((end - start)) -lt "$best" ] ; then
+            best=$((end - start))
+        fi
+    done
+    echo "$best"
+}
+
+# allocations MODE [tshark options...]
+allocations() {
+    WIRESHARK_DEBUG_WMEM_OVERRIDE=simple LD_PRELOAD="$WORK/malloc_count.so" \
+        MALLOC_COUNT_OUT="$WORK/allocations" run "$@" || return 1
+    cat "$WORK/allocations"
+}
+
+# per_advert A B: (A - B) / ADVERTS to one decimal place
+per_advert() {
+    awk -v a="$1" -v b="$2" -v n="$ADVERTS" 'BEGIN { printf "%.1f", (a - b) / n }'
+}
+
+ITEMS=$(tshark -n -r "$CAPTURE" -T pdml | grep -c '<field name="btcommon\.apple')
+
+printf "%-8s %10s %10s %13s %12s\n" mode adverts ns/advert allocs/advert items/advert
+for mode in none filter tree ; do
+    ns=$(best_ns $mode) &&
+    ns_off=$(best_ns $mode --disable-protocol btcommon.apple) &&
+    allocs=$(allocations $mode) &&
+    allocs_off=$(allocations $mode --disable-protocol btcommon.apple) || exit 1
+    items=-
+    [ $mode = tree ] && items=$(per_advert "$ITEMS" 0)
+    printf "%-8s %10s %10s %13s %12s\n" $mode "$ADVERTS" "$(per_advert "$ns" "$ns_off")" \
+        "$(per_advert "$allocs" "$allocs_off")" "$items"
+done
@@ -0,0 +1,137 @@
+#!/bin/bash
+# run.sh                build the tools into a scratch directory and run
+#                       every check below; prints one line per check
+# run.sh CHECK...       run only the named checks
+#
+# CC and CFLAGS are honoured.  Captures are generated with continuity-gen,
+# so nothing beyond a C compiler is needed, except by the dissector checks,
+# which are skipped unless tshark can load the plugin.
+TOP=$(cd "$(dirname "$0")/.." && pwd)
+LIB=$TOP/libcontinuity
+TOOLS=$TOP/tools
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2 -Wall}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+build() {
+    $CC $CFLAGS -pthread -I"$LIB" -o "$WORK/$1" "${@:2}" || exit 1
+}
+
+build continuity-gen "$TOOLS/continuity-gen.c" "$TOOLS/synth.c" "$TOOLS/btle.c" \
+    "$TOOLS/pcapng.c" "$LIB/continuity.c"
+build continuity-scan "$TOOLS/continuity-scan.c" "$TOOLS/capfile.c" "$TOOLS/capindex.c" \
+    "$TOOLS/btle.c" "$TOOLS/hci.c" "$TOOLS/deque.c" "$LIB/continuity.c" \
+    "$LIB/continuity_fields.c" "$LIB/continuity_timeline.c" "$LIB/continuity_homekit.c"
+build batch_columns "$TOP/tests/batch_columns.c" "$TOOLS/synth.c" "$LIB/continuity.c" \
+    "$LIB/continuity_batch.c" -I"$TOOLS"
+
+# continuity_decode_batch() rows hold the same values as the messages
+# continuity_decode() returns, on synthetic and edge-case payloads
+check_batch_columns() {
+    "$WORK/batch_columns" > "$WORK/batch_columns.out" || {
+        cat "$WORK/batch_columns.out"
+        return 1
+    }
+}
+
+# A pcapng of about 14 MB: over two 4 MB chunks, so -j decodes it in
+# chunks.  Generated once and shared by the checks below.
+mixed_capture() {
+    [ -f "$WORK/mixed.pcapng" ] ||
+        "$WORK/continuity-gen" -d 300 -i 20 -c 200000 -o "$WORK/mixed.pcapng"
+}
+
+# -j: the chunks decoded on 4 threads are printed in order, and give the
+# same output and totals as one thread
+check_scan_threads() {
+    mixed_capture &&
+    "$WORK/continuity-scan" -j 1 "$WORK/mixed.pcapng" > "$WORK/threads-1.out" &&
+    "$WORK/continuity-scan" -j 4 "$WORK/mixed.pcapng" > "$WORK/threads-4.out" &&
+    cmp -s "$WORK/threads-1.out" "$WORK/threads-4.out"
+}
+
+# -o with -j: the per-file outputs and summary are the same whether files
+# and chunks are scanned on one thread or spread over 4
+check_scan_batch_threads() {
+    mixed_capture &&
+    "$WORK/continuity-gen" -d 20 -c 5000 -o "$WORK/small.pcapng" &&
+    mkdir "$WORK/batch-1" "$WORK/batch-4" &&
+    "$WORK/continuity-scan" -q -j 1 -o "$WORK/batch-1" "$WORK/mixed.pcapng" \
+        "$WORK/small.pcapng" > /dev/null &&
+    "$WORK/continuity-scan" -q -j 4 -o "$WORK/batch-4" "$WORK/mixed.pcapng" \
+        "$WORK/small.pcapng" > /dev/null &&
+    diff -r "$WORK/batch-1" "$WORK/batch-4" > /dev/null
+}
+
+# -f after -X: filters answered from the sidecar index give the same
+# frames as reading the whole file
+check_scan_index() {
+    local addr
+
+    mixed_capture &&
+    cp "$WORK/mixed.pcapng" "$WORK/indexed.pcapng" &&
+    addr=$("$WORK/continuity-scan" "$WORK/mixed.pcapng" | sed -n '100s/^[^\t]*\t[^\t]*\t\([^\t]*\).*/\1/p') &&
+    for f in btcommon.apple.type=12 btcommon.apple.nearbyinfo.action_code=7 \
+            btcommon.apple.nearbyaction.type=9 btle.advertising_address=$addr ; do
+        "$WORK/continuity-scan" -f $f "$WORK/mixed.pcapng" || return 1
+    done > "$WORK/unindexed.out" &&
+    "$WORK/continuity-scan" -q -X "$WORK/indexed.pcapng" > /dev/null &&
+    [ -f "$WORK/indexed.pcapng.cidx" ] &&
+    for f in btcommon.apple.type=12 btcommon.apple.nearbyinfo.action_code=7 \
+            btcommon.apple.nearbyaction.type=9 btle.advertising_address=$addr ; do
+        "$WORK/continuity-scan" -f $f "$WORK/indexed.pcapng" || return 1
+    done > "$WORK/indexed.out" &&
+    cmp -s "$WORK/unindexed.out" "$WORK/indexed.out"
+}
+
+# -k with -j: a pcapng over two 4 MB chunks still goes through the
+# HomeKit tracker in order on one thread, and gives the same report
+check_scan_homekit_threads() {
+    "$WORK/continuity-gen" -d 300 -i 20 -T 6 -c 150000 -o "$WORK/homekit.pcapng" &&
+    "$WORK/continuity-scan" -q -j 1 -k "$WORK/homekit-1.txt" "$WORK/homekit.pcapng" \
+        > "$WORK/homekit-1.out" &&
+    "$WORK/continuity-scan" -q -j 4 -k "$WORK/homekit-4.txt" "$WORK/homekit.pcapng" \
+        > "$WORK/homekit-4.out" &&
+    cmp -s "$WORK/homekit-1.txt" "$WORK/homekit-4.txt" &&
+    cmp -s "$WORK/homekit-1.out" "$WORK/homekit-4.out"
+}
+
+# Same-type frame links when a type repeats within a frame: every message
+# of the type links to the same earlier and later frames, never to its own
+check_dissector_repeated_type() {
+    command -v tshark > /dev/null &&
+        tshark -G protocols 2> /dev/null | grep -q 'btcommon\.apple' || return 77
+    "$WORK/continuity-gen" -d 1 -T 16 -m 3 -c 200 -o "$WORK/repeated.pcapng" &&
+    tshark -r "$WORK/repeated.pcapng" -T fields -E occurrence=a -E aggregator=/ \
+        -e frame.number -e btcommon.apple.type \
+        -e btcommon.apple.device.prev_type_frame -e btcommon.apple.device.next_type_frame \
+        > "$WORK/repeated.txt" &&
+    awk -F '\t' '
+        { n = split($2, types, "/"); p = split($3, prev, "/"); q = split($4, next_, "/") }
+        n > 1 { repeated++ }
+        {
+            for (i = 1; i <= p; i++) if (prev[i] >= $1 || prev[i] != prev[1]) bad++
+            for (i = 1; i <= q; i++) if (next_[i] <= $1 || next_[i] != next_[1]) bad++
+        }
+        END { exit !(repeated && !bad) }' "$WORK/repeated.txt"
+}
+
+CHECKS=${*:-$(declare -F | sed -n 's/^declare -f check_//p')}
+FAILED=0
+for c in $CHECKS ; do
+    check_$c
+    case $? in
+    0)
+        echo "ok      $c"
+        ;;
+    77)
+        echo "skip    $c"
+        ;;
+    *)
+        echo "FAILED  $c"
+        FAILED=1
+        ;;
+    esac
+done
+exit $FAILED
@@ -0,0 +1,177 @@
+/* btle.c
+ * Bluetooth LE link-layer advertising PDUs and AD structures
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <string.h>
+
+#include "btle.h"
+
+static uint32_t
+reverse24(uint32_t v)
+{
+    uint32_t    r = 0;
+    int         i;
+
+    for (i = 0; i < 24; i++) {
+        r = (r << 1) | (v & 1);
+        v >>= 1;
+    }
+
+    return r;
+}
+
+/* Core spec Vol 6 Part B 3.1.1.  The register is kept bit-reversed so that
+ * position 23, which is sent first, is bit 0; the result then reads as the
+ * 3 CRC bytes in capture order, little-endian. */
+uint32_t
+btle_crc(const uint8_t *pdu, size_t len, uint32_t crc_init)
+{
+    uint32_t    state = reverse24(crc_init);
+    size_t      i;
+    int         bit;
+
+    for (i = 0; i < len; i++) {
+        uint8_t cur = pdu[i];
+
+        for (bit = 0; bit < 8; bit++) {
+            uint32_t next = (state ^ cur) & 1;
+
+            cur >>= 1;
+            state >>= 1;
+            if (next)
+                state ^= 0xda6000;  /* feedback into positions 0, 1, 3, 4, 6, 9, 10 */
+        }
+    }
+
+    return state;
+}
+
+/* LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR pseudo-header */
+#define PHDR_LEN                    10
+#define PHDR_FLAG_SIGNAL_VALID      0x0002
+
+/* Channel index of RF channel rf (2402 + 2 * rf MHz) */
+static int
+rf_to_channel(uint8_t rf)
+{
+    if (rf == 0)
+        return 37;
+    if (rf == 12)
+        return 38;
+    if (rf == 39)
+        return 39;
+    if (rf < 12)
+        return rf - 1;
+    if (rf < 39)
+        return rf - 2;
+
+    return -1;
+}
+
+bool
+btle_parse_adv(uint32_t linktype, const uint8_t *data, size_t len, btle_adv_t *adv)
+{
+    uint32_t    access_address;
+    uint8_t     pdu_len;
+    int         i;
+
+    adv->channel  = -1;
+    adv->has_rssi = false;
+    adv->rssi     = 0;
+
+    if (linktype == LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR) {
+        uint16_t    flags;
+
+        if (len < PHDR_LEN)
+            return false;
+        flags = (uint16_t)(data[8] | data[9] << 8);
+        adv->channel = rf_to_channel(data[0]);
+        if (flags & PHDR_FLAG_SIGNAL_VALID) {
+            adv->has_rssi = true;
+            adv->rssi     = (int8_t)data[1];
+        }
+        data += PHDR_LEN;
+        len  -= PHDR_LEN;
+    } else if (linktype != LINKTYPE_BLUETOOTH_LE_LL) {
+        return false;
+    }
+
+    /* Access address, header and AdvA */
+    if (len < 4 + 2 + 6)
+        return false;
+    access_address = (uint32_t)data[0] | (uint32_t)data[1] << 8 |
+        (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+    if (access_address != BTLE_ADV_ACCESS_ADDRESS)
+        return false;
+
+    adv->pdu_type = data[4] & 0x0f;
+    adv->random   = (data[4] & 0x40) != 0;
+    pdu_len       = data[5];
+
+    switch (adv->pdu_type) {
+    case BTLE_ADV_IND:
+    case BTLE_ADV_NONCONN_IND:
+    case BTLE_ADV_SCAN_IND:
+    case BTLE_SCAN_RSP:
+        break;
+    default:
+        return false;
+    }
+    if (pdu_len < 6 || (size_t)pdu_len > len - 6)
+        return false;
+
+    for (i = 0; i < 6; i++)
+        adv->addr[i] = data[6 + 5 - i];
+    adv->ad     = data + 12;
+    adv->ad_len = (size_t)pdu_len - 6;
+
+    return true;
+}
+
+size_t
+btle_build_adv(uint8_t *out, uint8_t pdu_type, bool random,
+        const uint8_t addr[6], const uint8_t *ad, size_t ad_len)
+{
+    uint32_t    crc;
+    size_t      pdu_len;
+    int         i;
+
+    if (ad_len > BTLE_LEGACY_AD_MAX)
+        return 0;
+
+    out[0] = (uint8_t)BTLE_ADV_ACCESS_ADDRESS;
+    out[1] = (uint8_t)(BTLE_ADV_ACCESS_ADDRESS >> 8);
+    out[2] = (uint8_t)(BTLE_ADV_ACCESS_ADDRESS >> 16);
+    out[3] = (uint8_t)(BTLE_ADV_ACCESS_ADDRESS >> 24);
+
+    out[4] = (uint8_t)((pdu_type & 0x0f) | (random ? 0x40 : 0x00));
+    out[5] = (uint8_t)(6 + ad_len);
+
+    /* AdvA goes out least significant byte first */
+    for (i = 0; i < 6; i++)
+        out[6 + i] = addr[5 - i];
+    memcpy(out + 12, ad, ad_len);
+
+    pdu_len = 2 + 6 + ad_len;
+    crc = btle_crc(out + 4, pdu_len, BTLE_ADV_CRC_INIT);
+    out[4 + pdu_len]     = (uint8_t)crc;
+    out[4 + pdu_len + 1] = (uint8_t)(crc >> 8);
+    out[4 + pdu_len + 2] = (uint8_t)(crc >> 16);
+
+    return 4 + pdu_len + 3;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
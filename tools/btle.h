@@ -0,0 +1,91 @@
+/* btle.h
+ * Bluetooth LE link-layer advertising PDUs and AD structures
+ *
+ * Packets are laid out as in LINKTYPE_BLUETOOTH_LE_LL (251): access
+ * address, PDU header, payload and CRC, all as received over the air.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __BTLE_H__
+#define __BTLE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINKTYPE_BLUETOOTH_LE_LL            251
+#define LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR  256
+
+#define BTLE_ADV_ACCESS_ADDRESS     0x8e89bed6
+#define BTLE_ADV_CRC_INIT           0x555555
+
+/* Advertising channel PDU types */
+enum {
+    BTLE_ADV_IND            = 0x0,
+    BTLE_ADV_DIRECT_IND     = 0x1,
+    BTLE_ADV_NONCONN_IND    = 0x2,
+    BTLE_SCAN_REQ           = 0x3,
+    BTLE_SCAN_RSP           = 0x4,
+    BTLE_CONNECT_IND        = 0x5,
+    BTLE_ADV_SCAN_IND       = 0x6
+};
+
+/* AD types */
+#define BTLE_AD_FLAGS               0x01
+#define BTLE_AD_TX_POWER            0x0a
+#define BTLE_AD_MANUFACTURER        0xff
+
+#define BTLE_LEGACY_AD_MAX          31
+/* Access address, header, AdvA, 31 bytes of AD and CRC */
+#define BTLE_LEGACY_PACKET_MAX      (4 + 2 + 6 + BTLE_LEGACY_AD_MAX + 3)
+
+/* An advertising PDU that carries AdvA and AD structures */
+typedef struct {
+    uint8_t         pdu_type;
+    bool            random;         /* TxAdd */
+    uint8_t         addr[6];        /* AdvA, most significant byte first */
+    const uint8_t  *ad;             /* points into the packet */
+    size_t          ad_len;
+    int             channel;        /* channel index 0-39, -1 if unknown */
+    bool            has_rssi;
+    int8_t          rssi;           /* dBm */
+} btle_adv_t;
+
+/* Parse a capture record of linktype 251 or 256.  Returns true for
+ * ADV_IND, ADV_NONCONN_IND, ADV_SCAN_IND and SCAN_RSP on the advertising
+ * access address; every other packet returns false. */
+bool btle_parse_adv(uint32_t linktype, const uint8_t *data, size_t len, btle_adv_t *adv);
+
+/* CRC over a PDU (header and payload), as the 3 bytes that follow it on air */
+uint32_t btle_crc(const uint8_t *pdu, size_t len, uint32_t crc_init);
+
+/* Build an advertising channel packet carrying the AD structures in ad.
+ * addr is the advertiser address, most significant byte first; random
+ * sets TxAdd.  out must hold BTLE_LEGACY_PACKET_MAX bytes.  Returns the
+ * packet length, or 0 if ad is longer than a legacy advert allows. */
+size_t btle_build_adv(uint8_t *out, uint8_t pdu_type, bool random,
+        const uint8_t addr[6], const uint8_t *ad, size_t ad_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BTLE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,634 @@
+/* capfile.c
+ * Memory-mapped pcap and pcapng reader
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "capfile.h"
+
+#define PCAP_MAGIC_US           0xa1b2c3d4
+#define PCAP_MAGIC_NS           0xa1b23c4d
+#define PCAP_HEADER_LEN         24
+#define PCAP_RECORD_LEN         16
+
+#define PCAPNG_BLOCK_SHB        0x0a0d0d0a
+#define PCAPNG_BLOCK_IDB        0x00000001
+#define PCAPNG_BLOCK_PB         0x00000002  /* obsolete Packet Block */
+#define PCAPNG_BLOCK_SPB        0x00000003
+#define PCAPNG_BLOCK_ISB        0x00000005
+#define PCAPNG_BLOCK_EPB        0x00000006
+#define PCAPNG_BLOCK_NRB        0x00000004
+#define PCAPNG_BLOCK_DSB        0x0000000a
+#define PCAPNG_BLOCK_CB         0x00000bad
+#define PCAPNG_BLOCK_CB_NOCOPY  0x40000bad
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+
+#define PCAPNG_OPT_END          0
+#define PCAPNG_OPT_IF_TSRESOL   9
+#define PCAPNG_OPT_IF_TSOFFSET  14
+
+#define BTSNOOP_MAGIC           "btsnoop"   /* and a NUL */
+#define BTSNOOP_HEADER_LEN      16
+#define BTSNOOP_RECORD_LEN      24
+#define BTSNOOP_DATALINK_H1     1001
+#define BTSNOOP_DATALINK_H4     1002
+/* btsnoop timestamps count microseconds from 0000-01-01 */
+#define BTSNOOP_EPOCH_US        0x00dcddb30f2f8000LL
+
+#define PKLG_RECORD_LEN         13          /* length, timestamp and type */
+
+/* Blocks in a row that capfile_sync() wants to see before it trusts an offset */
+#define SYNC_BLOCKS             4
+
+#define NS_PER_SEC              1000000000ULL
+
+static uint32_t
+bswap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+static uint32_t
+rd32(const capfile_t *cf, const uint8_t *p)
+{
+    uint32_t    v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return cf->swapped ? bswap32(v) : v;
+}
+
+static uint16_t
+rd16(const capfile_t *cf, const uint8_t *p)
+{
+    uint16_t    v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return cf->swapped ? (uint16_t)(v >> 8 | v << 8) : v;
+}
+
+static bool
+host_big_endian(void)
+{
+    const uint16_t  one = 1;
+    uint8_t         first;
+
+    memcpy(&first, &one, 1);
+
+    return first == 0;
+}
+
+/* A 64-bit value in the file's byte order */
+static uint64_t
+rd64(const capfile_t *cf, const uint8_t *p)
+{
+    if (host_big_endian() != cf->swapped)
+        return (uint64_t)rd32(cf, p) << 32 | rd32(cf, p + 4);
+
+    return (uint64_t)rd32(cf, p + 4) << 32 | rd32(cf, p);
+}
+
+static uint64_t
+to_ns(uint64_t ts, uint64_t units_per_sec)
+{
+    if (units_per_sec == 1000000)
+        return ts * 1000;
+    if (units_per_sec == NS_PER_SEC)
+        return ts;
+
+    return (ts / units_per_sec) * NS_PER_SEC +
+        (uint64_t)((double)(ts % units_per_sec) * 1e9 / (double)units_per_sec);
+}
+
+static int
+fail(capfile_t *cf, const char *error)
+{
+    cf->error = error;
+
+    return -1;
+}
+
+/* Byte order of the section whose Section Header Block is at p */
+static int
+read_shb_order(capfile_t *cf, const uint8_t *p)
+{
+    uint32_t    bom;
+
+    memcpy(&bom, p + 8, sizeof(bom));
+    if (bom == PCAPNG_BYTE_ORDER_MAGIC)
+        cf->swapped = false;
+    else if (bom == bswap32(PCAPNG_BYTE_ORDER_MAGIC))
+        cf->swapped = true;
+    else
+        return fail(cf, "bad pcapng byte-order magic");
+
+    return 0;
+}
+
+static int
+add_iface(capfile_t *cf, const uint8_t *block, uint32_t block_len)
+{
+    capfile_iface_t    *iface;
+    const uint8_t      *opt = block + 16;
+    const uint8_t      *end = block + block_len - 4;
+
+    if (block_len < 20)
+        return fail(cf, "short interface description block");
+
+    if (cf->iface_count == cf->iface_capacity) {
+        size_t  capacity = cf->iface_capacity ? 2 * cf->iface_capacity : 4;
+        void   *grown = realloc(cf->ifaces, capacity * sizeof(*cf->ifaces));
+
+        if (!grown)
+            return fail(cf, "out of memory");
+        cf->ifaces = grown;
+        cf->iface_capacity = capacity;
+    }
+
+    iface = &cf->ifaces[cf->iface_count++];
+    iface->linktype      = rd16(cf, block + 8);
+    iface->units_per_sec = 1000000;
+    iface->ts_offset     = 0;
+
+    while (opt + 4 <= end) {
+        uint16_t    code = rd16(cf, opt);
+        uint16_t    len = rd16(cf, opt + 2);
+
+        if (code == PCAPNG_OPT_END || opt + 4 + len > end)
+            break;
+        if (code == PCAPNG_OPT_IF_TSRESOL && len == 1) {
+            uint8_t     v = opt[4];
+            unsigned    i;
+
+            if (v & 0x80) {
+                iface->units_per_sec = 1ULL << ((v & 0x7f) < 63 ? (v & 0x7f) : 63);
+            } else {
+                iface->units_per_sec = 1;
+                for (i = 0; i < v && i < 19; i++)
+                    iface->units_per_sec *= 10;
+            }
+        } else if (code == PCAPNG_OPT_IF_TSOFFSET && len == 8) {
+            uint64_t    v;
+
+            memcpy(&v, opt + 4, sizeof(v));
+            if (cf->swapped)
+                v = (uint64_t)bswap32((uint32_t)v) << 32 | bswap32((uint32_t)(v >> 32));
+            iface->ts_offset = (int64_t)v;
+        }
+        opt += 4 + ((len + 3u) & ~3u);
+    }
+
+    return 0;
+}
+
+static int
+open_btsnoop(capfile_t *cf)
+{
+    uint32_t    datalink;
+
+    cf->format  = CAPFILE_BTSNOOP;
+    cf->swapped = !host_big_endian();
+    if (cf->size < BTSNOOP_HEADER_LEN)
+        return fail(cf, "file too short for a capture header");
+
+    datalink = rd32(cf, cf->base + 12);
+    if (datalink == BTSNOOP_DATALINK_H4)
+        cf->linktype = CAPFILE_LINKTYPE_HCI_H4;
+    else if (datalink == BTSNOOP_DATALINK_H1)
+        cf->linktype = CAPFILE_LINKTYPE_BTSNOOP_H1;
+    else
+        return fail(cf, "unsupported btsnoop datalink");
+    cf->first = BTSNOOP_HEADER_LEN;
+    cf->pos   = BTSNOOP_HEADER_LEN;
+
+    return 0;
+}
+
+/* PacketLogger files have no header, so look for up to three records that
+ * chain together with sensible lengths and packet types. */
+static bool
+packetlogger_plausible(const uint8_t *p, size_t size, bool big_endian)
+{
+    size_t  pos = 0;
+    int     n;
+
+    for (n = 0; n < 3 && size - pos >= PKLG_RECORD_LEN; n++) {
+        const uint8_t  *rec = p + pos;
+        uint32_t        len = big_endian ?
+            (uint32_t)rec[0] << 24 | (uint32_t)rec[1] << 16 | (uint32_t)rec[2] << 8 | rec[3] :
+            (uint32_t)rec[3] << 24 | (uint32_t)rec[2] << 16 | (uint32_t)rec[1] << 8 | rec[0];
+        uint8_t         type = rec[12];
+
+        if (len < PKLG_RECORD_LEN - 4 || len > 0xffff)
+            return false;
+        if (type > 0x0b && type < 0xf0)
+            return false;
+        if (len > size - pos - 4)
+            break;
+        pos += 4 + (size_t)len;
+    }
+
+    return n > 0;
+}
+
+static int
+open_header(capfile_t *cf)
+{
+    uint32_t    magic;
+
+    cf->pos            = 0;
+    cf->swapped        = false;
+    cf->ifaces         = NULL;
+    cf->iface_count    = 0;
+    cf->iface_capacity = 0;
+    cf->state_blocks   = 0;
+    cf->section        = 0;
+    cf->error          = NULL;
+
+    if (cf->size < 12)
+        return fail(cf, "file too short for a capture header");
+
+    memcpy(&magic, cf->base, sizeof(magic));
+
+    if (memcmp(cf->base, BTSNOOP_MAGIC, sizeof(BTSNOOP_MAGIC)) == 0)
+        return open_btsnoop(cf);
+
+    if (magic == PCAPNG_BLOCK_SHB) {
+        cf->format = CAPFILE_PCAPNG;
+        cf->first  = 0;
+        return read_shb_order(cf, cf->base);
+    }
+
+    cf->format = CAPFILE_PCAP;
+    if (magic == bswap32(PCAP_MAGIC_US) || magic == bswap32(PCAP_MAGIC_NS)) {
+        cf->swapped = true;
+        magic = bswap32(magic);
+    }
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+        /* Older PacketLogger versions wrote big-endian records */
+        if (packetlogger_plausible(cf->base, cf->size, false) ||
+                packetlogger_plausible(cf->base, cf->size, true)) {
+            cf->format   = CAPFILE_PACKETLOGGER;
+            cf->swapped  = packetlogger_plausible(cf->base, cf->size, false) == host_big_endian();
+            cf->linktype = CAPFILE_LINKTYPE_PACKETLOGGER;
+            cf->first    = 0;
+            return 0;
+        }
+        return fail(cf, "not a pcap, pcapng, btsnoop or PacketLogger file");
+    }
+    if (cf->size < PCAP_HEADER_LEN)
+        return fail(cf, "file too short for a capture header");
+
+    cf->units_per_sec = magic == PCAP_MAGIC_NS ? NS_PER_SEC : 1000000;
+    cf->linktype      = rd32(cf, cf->base + 20) & 0xffff;
+    cf->first         = PCAP_HEADER_LEN;
+    cf->pos           = PCAP_HEADER_LEN;
+
+    return 0;
+}
+
+int
+capfile_open_mem(capfile_t *cf, const uint8_t *buf, size_t len)
+{
+    cf->base   = buf;
+    cf->size   = len;
+    cf->mapped = false;
+
+    return open_header(cf);
+}
+
+int
+capfile_open(capfile_t *cf, const char *path)
+{
+    struct stat st;
+    void       *map;
+    int         fd;
+    int         err;
+
+    cf->base   = NULL;
+    cf->ifaces = NULL;
+    cf->mapped = false;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return fail(cf, "cannot open file");
+    if (fstat(fd, &st) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return fail(cf, "cannot stat file");
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        errno = EINVAL;
+        return fail(cf, "not a regular, non-empty file");
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    err = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = err;
+        return fail(cf, "cannot map file");
+    }
+    posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    cf->base   = map;
+    cf->size   = (size_t)st.st_size;
+    cf->mapped = true;
+
+    return open_header(cf);
+}
+
+static int
+next_pcap(capfile_t *cf, capfile_packet_t *pkt)
+{
+    const uint8_t  *rec = cf->base + cf->pos;
+    uint32_t        caplen;
+
+    if (cf->size - cf->pos < PCAP_RECORD_LEN)
+        return 0;
+    caplen = rd32(cf, rec + 8);
+    if (cf->size - cf->pos - PCAP_RECORD_LEN < caplen)
+        return 0;
+
+    pkt->data      = rec + PCAP_RECORD_LEN;
+    pkt->caplen    = caplen;
+    pkt->origlen   = rd32(cf, rec + 12);
+    pkt->linktype  = cf->linktype;
+    pkt->interface = 0;
+    pkt->ts_ns     = (uint64_t)rd32(cf, rec) * NS_PER_SEC +
+        to_ns(rd32(cf, rec + 4), cf->units_per_sec);
+    pkt->offset    = cf->pos;
+    pkt->flags     = 0;
+
+    cf->pos += PCAP_RECORD_LEN + (size_t)caplen;
+
+    return 1;
+}
+
+static int
+next_pcapng(capfile_t *cf, capfile_packet_t *pkt)
+{
+    for (;;) {
+        const uint8_t          *block = cf->base + cf->pos;
+        const capfile_iface_t  *iface;
+        uint32_t                type;
+        uint32_t                block_len;
+        uint32_t                iface_id;
+        uint64_t                ts;
+
+        if (cf->size - cf->pos < 12)
+            return 0;
+
+        memcpy(&type, block, sizeof(type));
+        if (type == PCAPNG_BLOCK_SHB) {
+            if (read_shb_order(cf, block) < 0)
+                return -1;
+            cf->iface_count = 0;
+            cf->section     = cf->pos;
+            cf->state_blocks++;
+        }
+        type = rd32(cf, block);
+        block_len = rd32(cf, block + 4);
+
+        if (block_len < 12 || (block_len & 3))
+            return fail(cf, "bad pcapng block length");
+        if (cf->size - cf->pos < block_len)
+            return 0;
+
+        switch (type) {
+        case PCAPNG_BLOCK_IDB:
+            if (add_iface(cf, block, block_len) < 0)
+                return -1;
+            cf->state_blocks++;
+            break;
+        case PCAPNG_BLOCK_EPB:
+        case PCAPNG_BLOCK_PB:
+            if (block_len < 32)
+                return fail(cf, "short packet block");
+            iface_id = type == PCAPNG_BLOCK_EPB ? rd32(cf, block + 8) : rd16(cf, block + 8);
+            if (iface_id >= cf->iface_count)
+                return fail(cf, "packet on an undeclared interface");
+            iface = &cf->ifaces[iface_id];
+
+            pkt->caplen = rd32(cf, block + 20);
+            if (pkt->caplen > block_len - 32)
+                return fail(cf, "packet longer than its block");
+            pkt->data      = block + 28;
+            pkt->origlen   = rd32(cf, block + 24);
+            pkt->linktype  = iface->linktype;
+            pkt->interface = iface_id;
+            ts = (uint64_t)rd32(cf, block + 12) << 32 | rd32(cf, block + 16);
+            pkt->ts_ns     = to_ns(ts, iface->units_per_sec) + (uint64_t)(iface->ts_offset * (int64_t)NS_PER_SEC);
+            pkt->offset    = cf->pos;
+            pkt->flags     = 0;
+            cf->pos += block_len;
+            return 1;
+        case PCAPNG_BLOCK_SPB:
+            if (block_len < 16)
+                return fail(cf, "short packet block");
+            if (cf->iface_count == 0)
+                return fail(cf, "packet on an undeclared interface");
+            pkt->origlen   = rd32(cf, block + 8);
+            pkt->caplen    = pkt->origlen < block_len - 16 ? pkt->origlen : block_len - 16;
+            pkt->data      = block + 12;
+            pkt->linktype  = cf->ifaces[0].linktype;
+            pkt->interface = 0;
+            pkt->ts_ns     = 0;
+            pkt->offset    = cf->pos;
+            pkt->flags     = 0;
+            cf->pos += block_len;
+            return 1;
+        default:
+            break;
+        }
+
+        cf->pos += block_len;
+    }
+}
+
+static int
+next_btsnoop(capfile_t *cf, capfile_packet_t *pkt)
+{
+    const uint8_t  *rec = cf->base + cf->pos;
+    uint32_t        caplen;
+    int64_t         ts_us;
+
+    if (cf->size - cf->pos < BTSNOOP_RECORD_LEN)
+        return 0;
+    caplen = rd32(cf, rec + 4);
+    if (cf->size - cf->pos - BTSNOOP_RECORD_LEN < caplen)
+        return 0;
+
+    ts_us = (int64_t)rd64(cf, rec + 16) - BTSNOOP_EPOCH_US;
+
+    pkt->data      = rec + BTSNOOP_RECORD_LEN;
+    pkt->caplen    = caplen;
+    pkt->origlen   = rd32(cf, rec);
+    pkt->linktype  = cf->linktype;
+    pkt->interface = 0;
+    pkt->ts_ns     = ts_us > 0 ? (uint64_t)ts_us * 1000 : 0;
+    pkt->offset    = cf->pos;
+    pkt->flags     = rd32(cf, rec + 8);
+
+    cf->pos += BTSNOOP_RECORD_LEN + (size_t)caplen;
+
+    return 1;
+}
+
+static int
+next_packetlogger(capfile_t *cf, capfile_packet_t *pkt)
+{
+    const uint8_t  *rec = cf->base + cf->pos;
+    uint32_t        len;
+    uint64_t        ts;
+
+    if (cf->size - cf->pos < PKLG_RECORD_LEN)
+        return 0;
+    len = rd32(cf, rec);
+    if (len < PKLG_RECORD_LEN - 4)
+        return fail(cf, "bad PacketLogger record length");
+    if (cf->size - cf->pos - 4 < len)
+        return 0;
+
+    /* Seconds in the high half, microseconds in the low half */
+    ts = rd64(cf, rec + 4);
+
+    pkt->data      = rec + PKLG_RECORD_LEN;
+    pkt->caplen    = len - (PKLG_RECORD_LEN - 4);
+    pkt->origlen   = pkt->caplen;
+    pkt->linktype  = cf->linktype;
+    pkt->interface = 0;
+    pkt->ts_ns     = (ts >> 32) * NS_PER_SEC + (ts & 0xffffffff) * 1000;
+    pkt->offset    = cf->pos;
+    pkt->flags     = rec[12];
+
+    cf->pos += 4 + (size_t)len;
+
+    return 1;
+}
+
+int
+capfile_next(capfile_t *cf, capfile_packet_t *pkt)
+{
+    if (cf->pos >= cf->size)
+        return 0;
+
+    switch (cf->format) {
+    case CAPFILE_PCAP:          return next_pcap(cf, pkt);
+    case CAPFILE_PCAPNG:        return next_pcapng(cf, pkt);
+    case CAPFILE_BTSNOOP:       return next_btsnoop(cf, pkt);
+    default:                    return next_packetlogger(cf, pkt);
+    }
+}
+
+/* Does a well-formed block of a known type start at pos?  Sets *next to
+ * the offset after it. */
+static bool
+block_at(const capfile_t *cf, size_t pos, size_t *next)
+{
+    const uint8_t  *block = cf->base + pos;
+    uint32_t        type;
+    uint32_t        block_len;
+
+    if (cf->size - pos < 12)
+        return false;
+    type      = rd32(cf, block);
+    block_len = rd32(cf, block + 4);
+    if (block_len < 12 || (block_len & 3) || block_len > cf->size - pos)
+        return false;
+    if (rd32(cf, block + block_len - 4) != block_len)
+        return false;
+
+    switch (type) {
+    case PCAPNG_BLOCK_SHB:
+    case PCAPNG_BLOCK_IDB:
+    case PCAPNG_BLOCK_PB:
+    case PCAPNG_BLOCK_SPB:
+    case PCAPNG_BLOCK_NRB:
+    case PCAPNG_BLOCK_ISB:
+    case PCAPNG_BLOCK_EPB:
+    case PCAPNG_BLOCK_DSB:
+    case PCAPNG_BLOCK_CB:
+    case PCAPNG_BLOCK_CB_NOCOPY:
+        *next = pos + block_len;
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint64_t
+capfile_sync(const capfile_t *cf, uint64_t offset, uint64_t limit)
+{
+    size_t  pos;
+
+    if (cf->format != CAPFILE_PCAPNG)
+        return limit;
+    if (limit > cf->size)
+        limit = cf->size;
+
+    /* Blocks are 32-bit aligned from the start of the file */
+    for (pos = (size_t)((offset + 3) & ~(uint64_t)3); pos < limit; pos += 4) {
+        size_t  next = pos;
+        int     n;
+
+        for (n = 0; n < SYNC_BLOCKS && next < cf->size; n++)
+            if (!block_at(cf, next, &next))
+                break;
+        if (n == SYNC_BLOCKS || next == cf->size)
+            return pos;
+    }
+
+    return limit;
+}
+
+void
+capfile_seek(capfile_t *cf, uint64_t offset)
+{
+    cf->pos = offset < cf->size ? (size_t)offset : cf->size;
+}
+
+void
+capfile_rebase(capfile_t *cf, const uint8_t *buf, size_t len)
+{
+    cf->base = buf;
+    cf->size = len;
+    cf->pos  = 0;
+}
+
+void
+capfile_close(capfile_t *cf)
+{
+    if (cf->mapped)
+        munmap((void *)(uintptr_t)cf->base, cf->size);
+    free(cf->ifaces);
+    cf->base   = NULL;
+    cf->ifaces = NULL;
+    cf->mapped = false;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
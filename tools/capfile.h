@@ -0,0 +1,124 @@
+/* capfile.h
+ * Memory-mapped pcap and pcapng reader
+ *
+ * Packets are returned as pointers into the mapping, so reading a file
+ * costs no copies and no per-packet allocation.  Both byte orders are
+ * accepted, as are microsecond and nanosecond pcap files and any pcapng
+ * if_tsresol.  The HCI log formats btsnoop (Android btsnoop_hci.log) and
+ * PacketLogger (macOS .pklg) are read too.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPFILE_H__
+#define __CAPFILE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    CAPFILE_PCAP = 0,
+    CAPFILE_PCAPNG,
+    CAPFILE_BTSNOOP,
+    CAPFILE_PACKETLOGGER
+};
+
+/* LINKTYPE_BLUETOOTH_HCI_H4, which is also what btsnoop datalink 1002 holds */
+#define CAPFILE_LINKTYPE_HCI_H4         187
+
+/* HCI log records that have no pcap link type; the packet's flags say
+ * what the record holds. */
+#define CAPFILE_LINKTYPE_BTSNOOP_H1     0x10001     /* btsnoop datalink 1001 */
+#define CAPFILE_LINKTYPE_PACKETLOGGER   0x10002
+
+typedef struct {
+    uint32_t    linktype;
+    uint64_t    units_per_sec;      /* from if_tsresol */
+    int64_t     ts_offset;          /* if_tsoffset, seconds */
+} capfile_iface_t;
+
+typedef struct {
+    const uint8_t  *data;
+    uint32_t        caplen;
+    uint32_t        origlen;
+    uint32_t        linktype;
+    uint32_t        interface;      /* always 0 for pcap */
+    uint64_t        ts_ns;          /* since the epoch */
+    uint64_t        offset;         /* of the record or block in the file */
+    uint32_t        flags;          /* btsnoop record flags or PacketLogger
+                                     * packet type, 0 for pcap and pcapng */
+} capfile_packet_t;
+
+typedef struct {
+    const uint8_t      *base;
+    size_t              size;
+    size_t              pos;
+    int                 format;
+    bool                swapped;    /* file byte order differs from ours */
+    bool                mapped;
+    uint64_t            first;      /* offset of the first record or block */
+    /* pcap, btsnoop and PacketLogger */
+    uint32_t            linktype;
+    uint64_t            units_per_sec;
+    /* pcapng, interfaces of the current section */
+    capfile_iface_t    *ifaces;
+    size_t              iface_count;
+    size_t              iface_capacity;
+    uint64_t            state_blocks;   /* SHBs and IDBs read so far */
+    uint64_t            section;    /* offset of the current section's SHB */
+    const char         *error;      /* set when a call fails */
+} capfile_t;
+
+/* Map path and read its file header.  Returns 0, or -1 with cf->error set
+ * (errno holds the cause of an open or mmap failure). */
+int capfile_open(capfile_t *cf, const char *path);
+
+/* The same over a buffer the caller keeps alive until capfile_close() */
+int capfile_open_mem(capfile_t *cf, const uint8_t *buf, size_t len);
+
+/* Fetch the next packet.  Returns 1, 0 at the end of the file, or -1 with
+ * cf->error set on a malformed record; a truncated last record counts as
+ * the end of the file. */
+int capfile_next(capfile_t *cf, capfile_packet_t *pkt);
+
+/* Continue reading at offset, which must be the offset of a record or of
+ * a packet block in the same pcapng section as the current position. */
+void capfile_seek(capfile_t *cf, uint64_t offset);
+
+/* pcapng: the offset of the first block that starts in [offset, limit),
+ * or limit if there is none.  An offset only counts as a block start if
+ * the blocks from there on chain together with matching lengths, so a
+ * file can be split into chunks without reading it from the start.
+ * Returns limit for the other formats. */
+uint64_t capfile_sync(const capfile_t *cf, uint64_t offset, uint64_t limit);
+
+/* For readers that stream into their own buffer: the unread data now
+ * starts at buf, len bytes long, with the next record first.  Section and
+ * interface state carries over. */
+void capfile_rebase(capfile_t *cf, const uint8_t *buf, size_t len);
+
+void capfile_close(capfile_t *cf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPFILE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
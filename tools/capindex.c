@@ -0,0 +1,581 @@
+/* capindex.c
+ * Sidecar index of the Apple adverts in a capture file
+ *
+ * Layout, all little-endian:
+ *
+ *   header     magic "CIDX", version, flags, bucket width, capture size
+ *              and mtime, packets, and the four table lengths below
+ *   adverts    packet offset and frame number, 16 bytes each
+ *   sections   SHB offset and first advert, 16 bytes each
+ *   keys       key, first posting and posting count, 24 bytes each,
+ *              sorted by key
+ *   postings   advert numbers, 4 bytes each
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "capindex.h"
+
+#define INDEX_MAGIC         "CIDX"
+#define INDEX_VERSION       1
+#define HEADER_LEN          88
+#define ADVERT_LEN          16
+#define SECTION_LEN         16
+#define KEY_LEN             24
+#define POSTING_LEN         4
+
+#define NS_PER_SEC          1000000000ULL
+
+/* An address or time key of one advert, for sorting */
+typedef struct {
+    uint64_t    key;
+    uint32_t    advert;
+} key_ref_t;
+
+static void
+put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void
+put64(uint8_t *p, uint64_t v)
+{
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t
+get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t
+get64(const uint8_t *p)
+{
+    return (uint64_t)get32(p) | (uint64_t)get32(p + 4) << 32;
+}
+
+static bool
+grow(void **items, size_t *capacity, size_t count, size_t size)
+{
+    size_t  cap;
+    void   *p;
+
+    if (count < *capacity)
+        return true;
+    cap = *capacity ? 2 * *capacity : 1024;
+    if (!(p = realloc(*items, cap * size)))
+        return false;
+    *items    = p;
+    *capacity = cap;
+
+    return true;
+}
+
+void
+capindex_writer_init(capindex_writer_t *w)
+{
+    memset(w, 0, sizeof(*w));
+}
+
+void
+capindex_add_section(capindex_writer_t *w, uint64_t offset)
+{
+    void   *p = w->sections;
+
+    if (w->error)
+        return;
+    if (!grow(&p, &w->section_capacity, w->section_count, sizeof(*w->sections))) {
+        w->error = "out of memory";
+        return;
+    }
+    w->sections = p;
+    w->sections[w->section_count].offset = offset;
+    w->sections[w->section_count].frame  = w->advert_count;
+    w->section_count++;
+}
+
+void
+capindex_add(capindex_writer_t *w, uint64_t offset, uint64_t frame, uint64_t ts_ns,
+        const uint8_t addr[6])
+{
+    size_t  cap;
+    void   *p;
+
+    if (w->error)
+        return;
+    if (w->advert_count == UINT32_MAX) {
+        w->error = "too many adverts to index";
+        return;
+    }
+    if (w->advert_count == w->advert_capacity) {
+        cap = w->advert_capacity ? 2 * w->advert_capacity : 4096;
+        if ((p = realloc(w->adverts, cap * sizeof(*w->adverts))))
+            w->adverts = p;
+        if (p && (p = realloc(w->buckets, cap * sizeof(*w->buckets))))
+            w->buckets = p;
+        if (p && (p = realloc(w->addrs, cap * sizeof(*w->addrs))))
+            w->addrs = p;
+        if (!p) {
+            w->error = "out of memory";
+            return;
+        }
+        w->advert_capacity = cap;
+    }
+
+    w->adverts[w->advert_count].offset = offset;
+    w->adverts[w->advert_count].frame  = frame;
+    w->buckets[w->advert_count] = (uint32_t)(ts_ns / NS_PER_SEC / CAPINDEX_BUCKET_SECS);
+    memcpy(w->addrs[w->advert_count], addr, 6);
+    w->advert_count++;
+}
+
+void
+capindex_add_key(capindex_writer_t *w, int kind, uint8_t value)
+{
+    capindex_list_t    *l;
+    uint32_t            advert;
+    void               *p;
+
+    if (w->error || w->advert_count == 0)
+        return;
+    switch (kind) {
+    case CAPINDEX_TYPE:             l = &w->types[value]; break;
+    case CAPINDEX_NEARBY_ACTION:    l = &w->nearby_actions[value]; break;
+    case CAPINDEX_NEARBY_INFO:      l = &w->nearby_infos[value & 0x0f]; break;
+    default:                        return;
+    }
+
+    advert = (uint32_t)(w->advert_count - 1);
+    if (l->count && l->items[l->count - 1] == advert)
+        return;
+    p = l->items;
+    if (!grow(&p, &l->capacity, l->count, sizeof(*l->items))) {
+        w->error = "out of memory";
+        return;
+    }
+    l->items = p;
+    l->items[l->count++] = advert;
+}
+
+static int
+compare_key_ref(const void *a, const void *b)
+{
+    const key_ref_t    *ka = a;
+    const key_ref_t    *kb = b;
+
+    if (ka->key != kb->key)
+        return ka->key < kb->key ? -1 : 1;
+
+    return (ka->advert > kb->advert) - (ka->advert < kb->advert);
+}
+
+/* The adverts' address or time keys, sorted */
+static key_ref_t *
+sort_keys(const capindex_writer_t *w, int kind)
+{
+    key_ref_t  *refs = malloc((w->advert_count ? w->advert_count : 1) * sizeof(*refs));
+    size_t      i;
+
+    if (!refs)
+        return NULL;
+    for (i = 0; i < w->advert_count; i++) {
+        const uint8_t  *a = w->addrs[i];
+
+        refs[i].advert = (uint32_t)i;
+        if (kind == CAPINDEX_ADDR)
+            refs[i].key = CAPINDEX_KEY(kind, (uint64_t)a[0] << 40 | (uint64_t)a[1] << 32 |
+                    (uint64_t)a[2] << 24 | (uint64_t)a[3] << 16 | (uint64_t)a[4] << 8 | a[5]);
+        else
+            refs[i].key = CAPINDEX_KEY(kind, w->buckets[i]);
+    }
+    qsort(refs, w->advert_count, sizeof(*refs), compare_key_ref);
+
+    return refs;
+}
+
+static size_t
+distinct_keys(const key_ref_t *refs, size_t count)
+{
+    size_t  n = 0;
+    size_t  i;
+
+    for (i = 0; i < count; i++)
+        if (i == 0 || refs[i].key != refs[i - 1].key)
+            n++;
+
+    return n;
+}
+
+static void
+write_key(FILE *f, uint64_t key, uint64_t first, uint64_t count)
+{
+    uint8_t buf[KEY_LEN];
+
+    put64(buf, key);
+    put64(buf + 8, first);
+    put64(buf + 16, count);
+    fwrite(buf, 1, sizeof(buf), f);
+}
+
+static void
+write_postings(FILE *f, const uint32_t *items, size_t count)
+{
+    uint8_t buf[POSTING_LEN];
+    size_t  i;
+
+    for (i = 0; i < count; i++) {
+        put32(buf, items[i]);
+        fwrite(buf, 1, sizeof(buf), f);
+    }
+}
+
+/* The per-value lists of one message key kind, in key order */
+static void
+write_list_keys(FILE *f, int kind, const capindex_list_t *lists, size_t n, uint64_t *first)
+{
+    size_t  v;
+
+    for (v = 0; v < n; v++) {
+        if (!lists[v].count)
+            continue;
+        write_key(f, CAPINDEX_KEY(kind, v), *first, lists[v].count);
+        *first += lists[v].count;
+    }
+}
+
+static void
+write_ref_keys(FILE *f, const key_ref_t *refs, size_t count, uint64_t *first)
+{
+    size_t  i;
+    size_t  j;
+
+    for (i = 0; i < count; i = j) {
+        for (j = i; j < count && refs[j].key == refs[i].key; j++)
+            ;
+        write_key(f, refs[i].key, *first, j - i);
+        *first += j - i;
+    }
+}
+
+static size_t
+list_keys(const capindex_list_t *lists, size_t n, size_t *postings)
+{
+    size_t  keys = 0;
+    size_t  v;
+
+    for (v = 0; v < n; v++) {
+        if (lists[v].count)
+            keys++;
+        *postings += lists[v].count;
+    }
+
+    return keys;
+}
+
+int
+capindex_write(capindex_writer_t *w, const char *path, const char *capture_path,
+        uint64_t packets)
+{
+    char        tmp[PATH_MAX];
+    uint8_t     buf[HEADER_LEN];
+    key_ref_t  *addrs = NULL;
+    key_ref_t  *buckets = NULL;
+    struct stat st;
+    size_t      keys;
+    size_t      postings = 2 * w->advert_count;
+    uint64_t    first = 0;
+    size_t      i;
+    FILE       *f;
+    int         err;
+
+    if (w->error)
+        return -1;
+    if (stat(capture_path, &st) < 0) {
+        w->error = "cannot stat the capture";
+        return -1;
+    }
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        errno    = ENAMETOOLONG;
+        w->error = "cannot create the index";
+        return -1;
+    }
+    if (!(addrs = sort_keys(w, CAPINDEX_ADDR)) || !(buckets = sort_keys(w, CAPINDEX_BUCKET))) {
+        free(addrs);
+        w->error = "out of memory";
+        return -1;
+    }
+    if (!(f = fopen(tmp, "wb"))) {
+        free(addrs);
+        free(buckets);
+        w->error = "cannot create the index";
+        return -1;
+    }
+
+    keys  = list_keys(w->types, 256, &postings);
+    keys += list_keys(w->nearby_actions, 256, &postings);
+    keys += list_keys(w->nearby_infos, 16, &postings);
+    keys += distinct_keys(addrs, w->advert_count);
+    keys += distinct_keys(buckets, w->advert_count);
+
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, INDEX_MAGIC, 4);
+    put32(buf + 4, INDEX_VERSION);
+    put32(buf + 8, w->flags);
+    put32(buf + 12, CAPINDEX_BUCKET_SECS);
+    put64(buf + 16, (uint64_t)st.st_size);
+    put64(buf + 24, (uint64_t)st.st_mtim.tv_sec);
+    put64(buf + 32, (uint64_t)st.st_mtim.tv_nsec);
+    put64(buf + 40, packets);
+    put64(buf + 48, w->advert_count);
+    put64(buf + 56, w->section_count);
+    put64(buf + 64, keys);
+    put64(buf + 72, postings);
+    fwrite(buf, 1, HEADER_LEN, f);
+
+    for (i = 0; i < w->advert_count; i++) {
+        put64(buf, w->adverts[i].offset);
+        put64(buf + 8, w->adverts[i].frame);
+        fwrite(buf, 1, ADVERT_LEN, f);
+    }
+    for (i = 0; i < w->section_count; i++) {
+        put64(buf, w->sections[i].offset);
+        put64(buf + 8, w->sections[i].frame);
+        fwrite(buf, 1, SECTION_LEN, f);
+    }
+
+    /* Keys in CAPINDEX_KEY() order, kind by kind */
+    write_list_keys(f, CAPINDEX_TYPE, w->types, 256, &first);
+    write_list_keys(f, CAPINDEX_NEARBY_ACTION, w->nearby_actions, 256, &first);
+    write_list_keys(f, CAPINDEX_NEARBY_INFO, w->nearby_infos, 16, &first);
+    write_ref_keys(f, addrs, w->advert_count, &first);
+    write_ref_keys(f, buckets, w->advert_count, &first);
+
+    for (i = 0; i < 256; i++)
+        write_postings(f, w->types[i].items, w->types[i].count);
+    for (i = 0; i < 256; i++)
+        write_postings(f, w->nearby_actions[i].items, w->nearby_actions[i].count);
+    for (i = 0; i < 16; i++)
+        write_postings(f, w->nearby_infos[i].items, w->nearby_infos[i].count);
+    for (i = 0; i < w->advert_count; i++) {
+        put32(buf, addrs[i].advert);
+        fwrite(buf, 1, POSTING_LEN, f);
+    }
+    for (i = 0; i < w->advert_count; i++) {
+        put32(buf, buckets[i].advert);
+        fwrite(buf, 1, POSTING_LEN, f);
+    }
+    free(addrs);
+    free(buckets);
+
+    if (ferror(f) | fclose(f) || rename(tmp, path) != 0) {
+        err = errno;
+        unlink(tmp);
+        errno    = err;
+        w->error = "cannot write the index";
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+capindex_writer_free(capindex_writer_t *w)
+{
+    size_t  i;
+
+    free(w->adverts);
+    free(w->buckets);
+    free(w->addrs);
+    free(w->sections);
+    for (i = 0; i < 256; i++) {
+        free(w->types[i].items);
+        free(w->nearby_actions[i].items);
+    }
+    for (i = 0; i < 16; i++)
+        free(w->nearby_infos[i].items);
+    capindex_writer_init(w);
+}
+
+static int
+fail(capindex_t *ix, const char *error)
+{
+    ix->error = error;
+
+    return -1;
+}
+
+int
+capindex_open(capindex_t *ix, const char *path, const char *capture_path)
+{
+    struct stat st;
+    struct stat cap;
+    void       *map;
+    uint64_t    len;
+    int         fd;
+    int         err;
+
+    memset(ix, 0, sizeof(*ix));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return fail(ix, "cannot open the index");
+    if (fstat(fd, &st) < 0 || stat(capture_path, &cap) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return fail(ix, "cannot stat the index or the capture");
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size < HEADER_LEN) {
+        close(fd);
+        errno = EINVAL;
+        return fail(ix, "not an index");
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    err = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = err;
+        return fail(ix, "cannot map the index");
+    }
+    ix->base = map;
+    ix->size = (size_t)st.st_size;
+
+    errno = EINVAL;
+    if (memcmp(ix->base, INDEX_MAGIC, 4) != 0 || get32(ix->base + 4) != INDEX_VERSION ||
+            get32(ix->base + 12) != CAPINDEX_BUCKET_SECS) {
+        capindex_close(ix);
+        return fail(ix, "not an index, or from another version");
+    }
+    if (get64(ix->base + 16) != (uint64_t)cap.st_size ||
+            get64(ix->base + 24) != (uint64_t)cap.st_mtim.tv_sec ||
+            get64(ix->base + 32) != (uint64_t)cap.st_mtim.tv_nsec) {
+        capindex_close(ix);
+        return fail(ix, "the capture has changed since it was indexed");
+    }
+
+    ix->flags         = get32(ix->base + 8);
+    ix->packets       = get64(ix->base + 40);
+    ix->advert_count  = get64(ix->base + 48);
+    ix->section_count = get64(ix->base + 56);
+    ix->key_count     = get64(ix->base + 64);
+    ix->posting_count = get64(ix->base + 72);
+
+    /* The tables must fill the rest of the file exactly */
+    len = ix->size - HEADER_LEN;
+    if (ix->advert_count > len / ADVERT_LEN ||
+            ix->section_count > (len -= ix->advert_count * ADVERT_LEN) / SECTION_LEN ||
+            ix->key_count > (len -= ix->section_count * SECTION_LEN) / KEY_LEN ||
+            ix->posting_count != (len - ix->key_count * KEY_LEN) / POSTING_LEN ||
+            (len - ix->key_count * KEY_LEN) % POSTING_LEN) {
+        capindex_close(ix);
+        return fail(ix, "index is truncated");
+    }
+    ix->adverts  = ix->base + HEADER_LEN;
+    ix->sections = ix->adverts + ix->advert_count * ADVERT_LEN;
+    ix->keys     = ix->sections + ix->section_count * SECTION_LEN;
+    ix->postings = ix->keys + ix->key_count * KEY_LEN;
+    errno = 0;
+
+    return 0;
+}
+
+uint64_t
+capindex_find(const capindex_t *ix, uint64_t key)
+{
+    uint64_t    lo = 0;
+    uint64_t    hi = ix->key_count;
+
+    while (lo < hi) {
+        uint64_t    mid = lo + (hi - lo) / 2;
+
+        if (get64(ix->keys + mid * KEY_LEN) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+uint64_t
+capindex_key(const capindex_t *ix, uint64_t i, uint64_t *first, uint64_t *count)
+{
+    const uint8_t  *p = ix->keys + i * KEY_LEN;
+
+    *first = get64(p + 8);
+    *count = get64(p + 16);
+    /* Keep a damaged index from pointing past the postings */
+    if (*first > ix->posting_count || *count > ix->posting_count - *first)
+        *count = 0;
+
+    return get64(p);
+}
+
+uint64_t
+capindex_posting(const capindex_t *ix, uint64_t i)
+{
+    return get32(ix->postings + i * POSTING_LEN);
+}
+
+void
+capindex_advert(const capindex_t *ix, uint64_t i, capindex_advert_t *adv)
+{
+    uint64_t    lo = 0;
+    uint64_t    hi = ix->section_count;
+
+    adv->offset  = get64(ix->adverts + i * ADVERT_LEN);
+    adv->frame   = get64(ix->adverts + i * ADVERT_LEN + 8);
+    adv->section = CAPINDEX_NO_SECTION;
+
+    /* The last section that starts at or before advert i */
+    while (lo < hi) {
+        uint64_t    mid = lo + (hi - lo) / 2;
+
+        if (get64(ix->sections + mid * SECTION_LEN + 8) <= i)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo > 0)
+        adv->section = get64(ix->sections + (lo - 1) * SECTION_LEN);
+}
+
+void
+capindex_close(capindex_t *ix)
+{
+    if (ix->base)
+        munmap((void *)(uintptr_t)ix->base, ix->size);
+    ix->base = NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,158 @@
+/* capindex.h
+ * Sidecar index of the Apple adverts in a capture file
+ *
+ * The index lists the offset and frame number of every Apple advert in a
+ * capture, and maps keys (message type, Nearby Action type, Nearby Info
+ * action code, advertiser address and minute of capture time) to the
+ * adverts that have them.  A reader maps the index and looks keys up by
+ * binary search, so a query reads only the frames that can match.
+ *
+ * The index records the capture's size and modification time; it is
+ * refused once the capture changes.  All fields are little-endian.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPINDEX_H__
+#define __CAPINDEX_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Appended to the capture's path */
+#define CAPINDEX_SUFFIX         ".cidx"
+
+/* Width of the capture time keys */
+#define CAPINDEX_BUCKET_SECS    60
+
+enum {
+    CAPINDEX_TYPE = 1,          /* btcommon.apple.type */
+    CAPINDEX_NEARBY_ACTION,     /* btcommon.apple.nearbyaction.type */
+    CAPINDEX_NEARBY_INFO,       /* btcommon.apple.nearbyinfo.action_code */
+    CAPINDEX_ADDR,              /* the advertiser address, MSB first */
+    CAPINDEX_BUCKET             /* capture time / CAPINDEX_BUCKET_SECS */
+};
+
+/* Keys sort by kind, then by value */
+#define CAPINDEX_KEY(kind, value)   ((uint64_t)(kind) << 48 | (uint64_t)(value))
+
+/* The capture cannot be read from an advert's offset alone: it changes
+ * interfaces partway through a section, or holds HCI adverts, which
+ * depend on earlier commands. */
+#define CAPINDEX_SEQUENTIAL     0x1
+
+/* Marks an advert outside any pcapng section */
+#define CAPINDEX_NO_SECTION     UINT64_MAX
+
+typedef struct {
+    uint32_t   *items;
+    size_t      count;
+    size_t      capacity;
+} capindex_list_t;
+
+typedef struct {
+    uint64_t    offset;         /* of the packet */
+    uint64_t    frame;          /* frame number, from 1 */
+} capindex_entry_t;
+
+typedef struct {
+    uint32_t            flags;
+    capindex_entry_t   *adverts;
+    uint32_t           *buckets;    /* per advert */
+    uint8_t           (*addrs)[6];  /* per advert */
+    size_t              advert_count;
+    size_t              advert_capacity;
+    capindex_entry_t   *sections;   /* SHB offset, first advert */
+    size_t              section_count;
+    size_t              section_capacity;
+    capindex_list_t     types[256];
+    capindex_list_t     nearby_actions[256];
+    capindex_list_t     nearby_infos[16];
+    bool                oom;
+    const char         *error;      /* set when capindex_write() fails */
+} capindex_writer_t;
+
+typedef struct {
+    uint64_t    offset;
+    uint64_t    frame;
+    uint64_t    section;        /* SHB offset or CAPINDEX_NO_SECTION */
+} capindex_advert_t;
+
+typedef struct {
+    const uint8_t  *base;
+    size_t          size;
+    uint32_t        flags;
+    uint64_t        packets;        /* in the whole capture */
+    uint64_t        advert_count;
+    uint64_t        section_count;
+    uint64_t        key_count;
+    uint64_t        posting_count;
+    const uint8_t  *adverts;
+    const uint8_t  *sections;
+    const uint8_t  *keys;
+    const uint8_t  *postings;
+    const char     *error;          /* set when capindex_open() fails */
+} capindex_t;
+
+void capindex_writer_init(capindex_writer_t *w);
+
+/* A pcapng section header at offset; the adverts added after it are in
+ * that section. */
+void capindex_add_section(capindex_writer_t *w, uint64_t offset);
+
+/* An Apple advert.  Its address and time keys are added here; add its
+ * message keys with capindex_add_key() before the next advert. */
+void capindex_add(capindex_writer_t *w, uint64_t offset, uint64_t frame, uint64_t ts_ns,
+        const uint8_t addr[6]);
+
+/* A CAPINDEX_TYPE, CAPINDEX_NEARBY_ACTION or CAPINDEX_NEARBY_INFO key of
+ * the last advert added; repeats are ignored. */
+void capindex_add_key(capindex_writer_t *w, int kind, uint8_t value);
+
+/* Write the index of capture_path, which holds packets packets, to path.
+ * Returns 0, or -1 with w->error set (and errno, for a failed write). */
+int capindex_write(capindex_writer_t *w, const char *path, const char *capture_path,
+        uint64_t packets);
+
+void capindex_writer_free(capindex_writer_t *w);
+
+/* Map the index at path and check it against capture_path.  Returns 0, or
+ * -1 with ix->error set; errno is ENOENT if there is no index. */
+int capindex_open(capindex_t *ix, const char *path, const char *capture_path);
+
+/* The position of the first key not below key; key_count if none */
+uint64_t capindex_find(const capindex_t *ix, uint64_t key);
+
+/* Key i, and the range of postings holding its adverts' numbers */
+uint64_t capindex_key(const capindex_t *ix, uint64_t i, uint64_t *first, uint64_t *count);
+
+/* Posting i: the number of an advert, ascending within each key */
+uint64_t capindex_posting(const capindex_t *ix, uint64_t i);
+
+void capindex_advert(const capindex_t *ix, uint64_t i, capindex_advert_t *adv);
+
+void capindex_close(capindex_t *ix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPINDEX_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,137 @@
+/* capstream.c
+ * pcap and pcapng reader for pipes, FIFOs and other unseekable streams
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capstream.h"
+
+/* Enough for a pcap file header or the start of a pcapng SHB */
+#define HEADER_LEN  24
+
+int
+capstream_init(capstream_t *s, size_t cap)
+{
+    memset(s, 0, sizeof(*s));
+    s->fd  = -1;
+    s->cap = cap;
+    s->buf = malloc(cap);
+    if (!s->buf) {
+        s->error = "out of memory";
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+capstream_attach(capstream_t *s, int fd)
+{
+    capstream_detach(s);
+    s->fd = fd;
+}
+
+int
+capstream_next(capstream_t *s, capfile_packet_t *pkt)
+{
+    int r;
+
+    if (!s->header)
+        return 0;
+    r = capfile_next(&s->cf, pkt);
+    if (r < 0)
+        s->error = s->cf.error;
+
+    return r;
+}
+
+int
+capstream_read(capstream_t *s)
+{
+    size_t  used = s->header ? s->cf.pos : 0;
+    ssize_t n;
+
+    if (used) {
+        memmove(s->buf, s->buf + used, s->len - used);
+        s->len -= used;
+        capfile_rebase(&s->cf, s->buf, s->len);
+    }
+    if (s->len == s->cap) {
+        s->error = "record larger than the input buffer";
+        errno = 0;
+        return -1;
+    }
+
+    n = read(s->fd, s->buf + s->len, s->cap - s->len);
+    if (n < 0) {
+        if (errno == EINTR || errno == EAGAIN)
+            return 1;
+        s->error = "read error";
+        return -1;
+    }
+    if (n == 0) {
+        s->eof = true;
+        return 0;
+    }
+    s->len += (size_t)n;
+
+    if (s->header) {
+        capfile_rebase(&s->cf, s->buf, s->len);
+    } else if (s->len >= HEADER_LEN) {
+        if (capfile_open_mem(&s->cf, s->buf, s->len) < 0) {
+            s->error = s->cf.error;
+            capfile_close(&s->cf);
+            errno = 0;
+            return -1;
+        }
+        s->header = true;
+    }
+
+    return 1;
+}
+
+size_t
+capstream_pending(const capstream_t *s)
+{
+    return s->len - (s->header ? s->cf.pos : 0);
+}
+
+void
+capstream_detach(capstream_t *s)
+{
+    if (s->header)
+        capfile_close(&s->cf);
+    s->fd     = -1;
+    s->len    = 0;
+    s->header = false;
+    s->eof    = false;
+    s->error  = NULL;
+}
+
+void
+capstream_free(capstream_t *s)
+{
+    capstream_detach(s);
+    free(s->buf);
+    s->buf = NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
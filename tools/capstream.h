@@ -0,0 +1,79 @@
+/* capstream.h
+ * pcap and pcapng reader for pipes, FIFOs and other unseekable streams
+ *
+ * Reads into one fixed buffer and parses it with capfile, so a stream
+ * costs the same per packet as a mapped file and its memory use never
+ * grows.  The caller owns the file descriptor and decides when to block
+ * on it, which lets one thread poll() several streams.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPSTREAM_H__
+#define __CAPSTREAM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "capfile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int             fd;
+    uint8_t        *buf;
+    size_t          cap;
+    size_t          len;        /* bytes in buf */
+    capfile_t       cf;
+    bool            header;     /* cf holds a parsed stream header */
+    bool            eof;
+    const char     *error;      /* set when a call fails */
+} capstream_t;
+
+/* Allocate a cap-byte buffer; cap bounds the largest record.  Returns 0,
+ * or -1 if the buffer cannot be allocated. */
+int capstream_init(capstream_t *s, size_t cap);
+
+/* Start reading a new stream, header first, from fd. */
+void capstream_attach(capstream_t *s, int fd);
+
+/* Fetch the next buffered packet.  Returns 1, 0 when more data has to be
+ * read first (or the stream has ended), or -1 with s->error set on a
+ * malformed record.  pkt points into the buffer and stays valid until
+ * the next capstream_read(). */
+int capstream_next(capstream_t *s, capfile_packet_t *pkt);
+
+/* Read once from fd, after dropping the packets already fetched.  Returns
+ * 1 after reading data or being interrupted, 0 at the end of the stream,
+ * or -1 with s->error set (and errno, for a failed read). */
+int capstream_read(capstream_t *s);
+
+/* Bytes read but not yet returned as packets */
+size_t capstream_pending(const capstream_t *s);
+
+/* Forget the current stream; fd is left for the caller to close. */
+void capstream_detach(capstream_t *s);
+
+void capstream_free(capstream_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPSTREAM_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,474 @@
+/* continuity-bench.c
+ * Per-message-type microbenchmark for the Apple Continuity decoder
+ *
+ * Runs synthetic adverts of every message type, a mixed set, and
+ * optionally recorded adverts through continuity_decode() and
+ * continuity_infer_os(), the plugin's work per frame without a tree.  A
+ * fields mode adds the continuity_foreach_field() walk over the shared
+ * layout tables, which visits the items the plugin's tree would hold but
+ * not epan's cost of adding them, and a batch mode times
+ * continuity_decode_batch() filling every column set.  Reports ns and
+ * fields (or batch rows) per advert.  tests/plugin-bench.sh measures the
+ * tree and allocation costs in tshark itself.
+ *
+ * Recorded adverts are read from a text file with one Manufacturer Specific
+ * AD value per line in hex, company identifier first (4c00...).  Blank
+ * lines, lines starting with '#' and non-Apple values are skipped.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "continuity.h"
+#include "continuity_batch.h"
+#include "continuity_fields.h"
+#include "synth.h"
+
+#define POOL_ADVERTS        1024    /* synthetic adverts per row */
+#define MAX_PAYLOAD_LEN     255
+#define DEFAULT_ITERATIONS  1000000
+#define BATCH_ADVERTS       256     /* payloads per continuity_decode_batch() call */
+#define BATCH_ROWS          (BATCH_ADVERTS * CONTINUITY_MAX_MSGS)
+
+enum {
+    MODE_DECODE = 1,
+    MODE_FIELDS = 2,
+    MODE_BATCH  = 4,
+    MODE_ALL    = 7
+};
+
+typedef struct {
+    size_t      count;
+    size_t      capacity;
+    uint8_t   (*data)[MAX_PAYLOAD_LEN];
+    uint8_t    *len;
+} pool_t;
+
+/* Real-world TLV combinations for the mixed row */
+static const uint8_t mix_nearby_info[] = { CONTINUITY_TYPE_NEARBY_INFO };
+static const uint8_t mix_phone[] = { CONTINUITY_TYPE_NEARBY_ACTION, CONTINUITY_TYPE_NEARBY_INFO };
+static const uint8_t mix_handoff[] = { CONTINUITY_TYPE_HANDOFF, CONTINUITY_TYPE_NEARBY_INFO };
+static const uint8_t mix_mac[] = { CONTINUITY_TYPE_AIRPLAY_TARGET, CONTINUITY_TYPE_HANDOFF, CONTINUITY_TYPE_NEARBY_INFO };
+static const uint8_t mix_airpods[] = { CONTINUITY_TYPE_AIRPODS };
+static const uint8_t mix_findmy[] = { CONTINUITY_TYPE_FINDMY };
+
+static const struct {
+    const uint8_t  *types;
+    size_t          count;
+} mixes[] = {
+    { mix_nearby_info, 1 },
+    { mix_phone, 2 },
+    { mix_handoff, 2 },
+    { mix_mac, 3 },
+    { mix_airpods, 1 },
+    { mix_findmy, 1 }
+};
+
+static const uint8_t bench_addr[6] = { 0xd4, 0x1f, 0x0c, 0x8a, 0x37, 0x65 };
+
+static volatile uint32_t sink;
+
+/* Every column of every column set */
+/* Every column of every column set, for continuity_batch_init() */
+static uint32_t column_storage[(BATCH_ROWS * CONTINUITY_BATCH_ROW_BYTES + 3) / 4];
+static continuity_batch_t batch;
+
+static void
+usage(FILE *out)
+{
+    fprintf(out,
+        "usage: continuity-bench [-n adverts] [-s seed] [-m decode|fields|both|batch|all] [file]\n"
+        "  -n adverts   adverts decoded per row (default %d)\n"
+        "  -s seed      seed for the synthetic adverts\n"
+        "  -m mode      decode: decode and OS guess only, as without a tree\n"
+        "               fields: also walk every field; both: decode and fields\n"
+        "               batch: decode into columns; all (default)\n"
+        "  file         recorded adverts, one hex manufacturer data value per line\n",
+        DEFAULT_ITERATIONS);
+}
+
+static int
+pool_init(pool_t *pool, size_t capacity)
+{
+    pool->count    = 0;
+    pool->capacity = capacity;
+    pool->data     = malloc(capacity * sizeof(*pool->data));
+    pool->len      = malloc(capacity);
+
+    return pool->data && pool->len ? 0 : -1;
+}
+
+static void
+pool_free(pool_t *pool)
+{
+    free(pool->data);
+    free(pool->len);
+}
+
+static int
+pool_add(pool_t *pool, const uint8_t *data, size_t len)
+{
+    if (pool->count == pool->capacity) {
+        size_t      capacity = pool->capacity * 2;
+        void       *data_grown = realloc(pool->data, capacity * sizeof(*pool->data));
+        void       *len_grown;
+
+        if (!data_grown)
+            return -1;
+        pool->data = data_grown;
+        len_grown = realloc(pool->len, capacity);
+        if (!len_grown)
+            return -1;
+        pool->len = len_grown;
+        pool->capacity = capacity;
+    }
+
+    memcpy(pool->data[pool->count], data, len);
+    pool->len[pool->count] = (uint8_t)len;
+    pool->count++;
+
+    return 0;
+}
+
+static int
+hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/* Parse hex digits, skipping ':' and whitespace.  Returns the byte count or
+ * -1 on a malformed or overlong line. */
+static int
+parse_hex(const char *s, uint8_t *out, size_t cap)
+{
+    size_t  len = 0;
+    int     hi = -1;
+
+    for (; *s; s++) {
+        int nibble;
+
+        if (*s == ':' || *s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')
+            continue;
+        nibble = hex_nibble((unsigned char)*s);
+        if (nibble < 0)
+            return -1;
+        if (hi < 0) {
+            hi = nibble;
+            continue;
+        }
+        if (len == cap)
+            return -1;
+        out[len++] = (uint8_t)(hi << 4 | nibble);
+        hi = -1;
+    }
+
+    return hi < 0 ? (int)len : -1;
+}
+
+static bool
+parse_uint(const char *s, uint64_t max, uint64_t *out)
+{
+    char               *end;
+    unsigned long long  v;
+
+    /* strtoull() would take "-1" as UINT64_MAX */
+    if (*s < '0' || *s > '9')
+        return false;
+    errno = 0;
+    v = strtoull(s, &end, 10);
+    if (errno || *end != '\0' || v > max)
+        return false;
+    *out = v;
+
+    return true;
+}
+
+static int
+load_recorded(const char *path, pool_t *pool)
+{
+    FILE       *f = fopen(path, "r");
+    char        line[4 * MAX_PAYLOAD_LEN];
+    uint8_t     data[MAX_PAYLOAD_LEN + 2];
+    unsigned    lineno = 0;
+
+    if (!f) {
+        fprintf(stderr, "continuity-bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        const uint8_t  *payload;
+        size_t          payload_len;
+        int             len;
+
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        len = parse_hex(line, data, sizeof(data));
+        if (len < 0) {
+            fprintf(stderr, "continuity-bench: %s:%u: not a hex advert, skipped\n", path, lineno);
+            continue;
+        }
+        if (!continuity_manufacturer_payload(data, (size_t)len, &payload, &payload_len))
+            continue;
+        if (payload_len > MAX_PAYLOAD_LEN || pool_add(pool, payload, payload_len) < 0) {
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+
+    return 0;
+}
+
+static void
+fill_type(pool_t *pool, uint8_t type, synth_rng_t *rng)
+{
+    uint8_t buf[MAX_PAYLOAD_LEN];
+
+    pool->count = 0;
+    while (pool->count < POOL_ADVERTS)
+        pool_add(pool, buf, synth_payload(&type, 1, rng, buf, sizeof(buf)));
+}
+
+static void
+fill_mixed(pool_t *pool, synth_rng_t *rng)
+{
+    uint8_t buf[MAX_PAYLOAD_LEN];
+
+    pool->count = 0;
+    while (pool->count < POOL_ADVERTS) {
+        size_t  m = synth_next(rng) % (sizeof(mixes) / sizeof(mixes[0]));
+
+        pool_add(pool, buf, synth_payload(mixes[m].types, mixes[m].count, rng, buf, sizeof(buf)));
+    }
+}
+
+static void
+touch_field(const continuity_field_t *field, void *user)
+{
+    uint32_t   *acc = user;
+
+    *acc += field->value + field->length;
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Decode iterations adverts cycling through pool into the column sets,
+ * BATCH_ADVERTS at a time.  Returns the number of rows written. */
+static uint64_t
+run_batch(const pool_t *pool, size_t iterations)
+{
+    continuity_advert_t adverts[BATCH_ADVERTS];
+    uint64_t            rows = 0;
+    size_t              i = 0;
+    size_t              a = 0;
+
+    while (i < iterations) {
+        size_t  n;
+
+        for (n = 0; n < BATCH_ADVERTS && i < iterations; n++, i++) {
+            adverts[n].data = pool->data[a];
+            adverts[n].len  = pool->len[a];
+            if (++a == pool->count)
+                a = 0;
+        }
+        continuity_batch_reset(&batch);
+        rows += continuity_decode_batch(adverts, n, &batch);
+    }
+    sink += (uint32_t)batch.messages;
+
+    return rows;
+}
+
+/* Decode iterations adverts cycling through pool.  Returns the number of
+ * fields reported. */
+static uint64_t
+run(const pool_t *pool, bool fields, size_t iterations)
+{
+    static const continuity_ad_ctx_t ctx = { -1, false };
+    continuity_frame_t  frame;
+    uint64_t            items = 0;
+    uint32_t            acc = 0;
+    size_t              i;
+    size_t              a = 0;
+
+    for (i = 0; i < iterations; i++) {
+        continuity_decode(pool->data[a], pool->len[a], &frame);
+        continuity_infer_os(&frame, &ctx);
+        acc += frame.count + frame.os;
+        if (fields)
+            items += continuity_foreach_field(pool->data[a], &frame, bench_addr, touch_field, &acc);
+        if (++a == pool->count)
+            a = 0;
+    }
+    sink += acc;
+
+    return items;
+}
+
+static uint64_t
+run_mode(const pool_t *pool, int mode, size_t iterations)
+{
+    if (mode == MODE_BATCH)
+        return run_batch(pool, iterations);
+
+    return run(pool, mode == MODE_FIELDS, iterations);
+}
+
+static void
+bench_row(const char *label, const pool_t *pool, int mode, size_t iterations)
+{
+    uint64_t    start;
+    uint64_t    elapsed;
+    uint64_t    items;
+
+    if (pool->count == 0)
+        return;
+
+    /* Warm the caches and branch predictors on one pass over the pool */
+    run_mode(pool, mode, pool->count);
+
+    start = now_ns();
+    items = run_mode(pool, mode, iterations);
+    elapsed = now_ns() - start;
+
+    printf("%-36s %-6s %9zu %10.1f %12.2f\n", label,
+            mode == MODE_FIELDS ? "fields" : mode == MODE_BATCH ? "batch" : "decode", iterations,
+            (double)elapsed / (double)iterations, (double)items / (double)iterations);
+}
+
+static void
+bench(const char *label, const pool_t *pool, int modes, size_t iterations)
+{
+    if (modes & MODE_DECODE)
+        bench_row(label, pool, MODE_DECODE, iterations);
+    if (modes & MODE_FIELDS)
+        bench_row(label, pool, MODE_FIELDS, iterations);
+    if (modes & MODE_BATCH)
+        bench_row(label, pool, MODE_BATCH, iterations);
+}
+
+int
+main(int argc, char **argv)
+{
+    synth_rng_t rng;
+    pool_t      pool;
+    size_t      iterations = DEFAULT_ITERATIONS;
+    uint64_t    seed = 1;
+    uint64_t    v;
+    int         modes = MODE_ALL;
+    int         opt;
+    unsigned    t;
+
+    while ((opt = getopt(argc, argv, "hm:n:s:")) != -1) {
+        switch (opt) {
+        case 'm':
+            if (strcmp(optarg, "decode") == 0)
+                modes = MODE_DECODE;
+            else if (strcmp(optarg, "fields") == 0)
+                modes = MODE_FIELDS;
+            else if (strcmp(optarg, "both") == 0)
+                modes = MODE_DECODE | MODE_FIELDS;
+            else if (strcmp(optarg, "batch") == 0)
+                modes = MODE_BATCH;
+            else if (strcmp(optarg, "all") == 0)
+                modes = MODE_ALL;
+            else {
+                usage(stderr);
+                return 1;
+            }
+            break;
+        case 'n':
+            if (!parse_uint(optarg, SIZE_MAX, &v) || v == 0) {
+                fprintf(stderr, "continuity-bench: bad -n count '%s'\n", optarg);
+                return 1;
+            }
+            iterations = (size_t)v;
+            break;
+        case 's':
+            if (!parse_uint(optarg, UINT64_MAX, &seed)) {
+                fprintf(stderr, "continuity-bench: bad -s seed '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (argc - optind > 1) {
+        usage(stderr);
+        return 1;
+    }
+
+    synth_seed(&rng, seed);
+    continuity_batch_init(&batch, column_storage, BATCH_ROWS);
+    if (pool_init(&pool, POOL_ADVERTS) < 0) {
+        fprintf(stderr, "continuity-bench: out of memory\n");
+        return 1;
+    }
+
+    printf("%-36s %-6s %9s %10s %12s\n", "type", "mode", "adverts", "ns/advert", "items/advert");
+
+    for (t = 0; t < SYNTH_TYPE_COUNT; t++) {
+        fill_type(&pool, synth_types[t], &rng);
+        bench(continuity_type_name(synth_types[t]), &pool, modes, iterations);
+    }
+
+    fill_mixed(&pool, &rng);
+    bench("mixed", &pool, modes, iterations);
+
+    if (optind < argc) {
+        pool.count = 0;
+        if (load_recorded(argv[optind], &pool) < 0) {
+            pool_free(&pool);
+            return 1;
+        }
+        if (pool.count == 0)
+            fprintf(stderr, "continuity-bench: %s: no Apple adverts\n", argv[optind]);
+        bench("recorded", &pool, modes, iterations);
+    }
+
+    pool_free(&pool);
+
+    return 0;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,1146 @@
+/* continuity-capd.c
+ * Headless BLE capture daemon with a pcapng ring buffer
+ *
+ * Reads the pcap stream that ubertooth-btle -q writes into a FIFO (or any
+ * pcap or pcapng stream on a pipe, file or stdin), writes the packets to
+ * pcapng files rotated by size or time, and keeps a bounded ring of those
+ * files.  While capturing it counts the Apple Continuity messages in the
+ * advertising traffic and rewrites a small stats file.
+ *
+ * With -A or -T it doubles as a pre-filter: frames are checked for an
+ * Apple manufacturer entry, and optionally for given message types, from
+ * the AD and TLV headers alone, and only matching frames are decoded and
+ * stored.  With -w - the matches go to stdout as one pcapng stream for a
+ * live Wireshark to read.
+ *
+ * With -j the work is split over threads so that a slow disk or a burst
+ * of decoding never holds up reading the FIFO.  The reading thread copies
+ * packets into batches and hands each batch to the least busy decoder
+ * thread; decoders pass decoded batches to a single writer thread, which
+ * puts them back in order, writes them out and returns them for reuse.
+ * The queues between the stages are lock-free rings.  When every batch is
+ * in use the reader drops packets rather than wait, and counts them.
+ *
+ * Memory use is fixed at startup: one input buffer, the output stdio
+ * buffer, the ring of file names and, with -j, the batches.  Nothing is
+ * allocated per packet.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btle.h"
+#include "capstream.h"
+#include "continuity.h"
+#include "pcapng.h"
+#include "ring.h"
+
+#define DEFAULT_BUFFER_KB   1024
+#define DEFAULT_STATS_SECS  10
+#define OUTPUT_BUFFER_LEN   (256 * 1024)
+#define SNAPLEN             65535
+#define POLL_MS             1000
+#define NS_PER_SEC          1000000000ULL
+
+#define MAX_DECODERS        64
+#define DEFAULT_BATCHES     64
+#define BATCH_PACKETS       256
+#define BATCH_BYTES         (64 * 1024)
+/* How long an idle pipeline thread sleeps before looking at its queue again */
+#define IDLE_SLEEP_NS       100000
+
+/* "_NNNNN_YYYYmmddHHMMSS.pcapng" after the prefix, with room to spare */
+#define NAME_SUFFIX_LEN     48
+
+typedef struct {
+    uint64_t    packets;
+    uint64_t    bytes;          /* captured bytes read from the stream */
+    uint64_t    adverts;
+    uint64_t    apple;
+    uint64_t    filtered;       /* dropped by -A or -T */
+    uint64_t    messages;
+    uint64_t    short_msgs;
+    uint64_t    truncated_msgs;
+    uint64_t    types[256];
+    uint64_t    os[CONTINUITY_OS_IOS13 + 1];
+    uint64_t    written;        /* packets written to the ring */
+    uint64_t    written_bytes;
+    uint64_t    files;          /* output files opened */
+    uint64_t    deleted;        /* output files removed from the ring */
+    uint64_t    streams;        /* input streams opened */
+    /* -L, reset each time the stats file is written */
+    uint64_t    lag_max_ns;
+    uint64_t    lag_sum_ns;
+    uint64_t    lag_count;
+    uint64_t    lag_last_ns;
+} capd_stats_t;
+
+typedef struct {
+    capfile_packet_t    pkt;        /* data points into the batch */
+    bool                rotate;     /* SIGHUP arrived before this packet */
+    bool                keep;       /* set by the decoder */
+} capd_entry_t;
+
+/* The unit handed between pipeline stages */
+typedef struct {
+    uint64_t        seq;            /* order the reader submitted it in */
+    size_t          count;
+    size_t          used;           /* bytes of data */
+    capd_stats_t    st;             /* the decoder's counts, merged by the writer */
+    capd_entry_t    entries[BATCH_PACKETS];
+    uint8_t         data[BATCH_BYTES];
+} capd_batch_t;
+
+struct capd;
+
+typedef struct {
+    struct capd    *d;
+    ring_spsc_t     in;             /* batches from the reader */
+    pthread_t       thread;
+} capd_decoder_t;
+
+/* -j state.  The reader owns cur and next_seq, the writer owns reorder
+ * and write_seq; everything the threads share is a ring or an atomic. */
+typedef struct {
+    size_t              batches;        /* -Q */
+    capd_batch_t       *pool;
+    capd_decoder_t     *decoders;
+    unsigned            decoder_count;  /* -j */
+    ring_mpsc_t         decoded;        /* decoders to the writer */
+    ring_spsc_t         free;           /* writer back to the reader */
+    capd_batch_t       *cur;
+    uint64_t            next_seq;
+    unsigned            next_decoder;
+    capd_batch_t      **reorder;        /* indexed by seq % batches */
+    uint64_t            write_seq;
+    pthread_t           writer;
+    atomic_uint_fast64_t submitted;     /* batches handed to decoders */
+    atomic_uint_fast64_t dropped;       /* packets with no free batch */
+    atomic_uint_fast64_t streams;
+    atomic_uint_fast64_t queue_max;     /* most batches in flight at once */
+    atomic_bool         reader_done;
+    atomic_bool         failed;         /* the writer hit an error */
+    atomic_bool         stats_now;      /* SIGUSR1, passed on by the reader */
+    atomic_bool         flush_now;
+} capd_pipeline_t;
+
+typedef struct capd {
+    /* options */
+    const char     *input;
+    const char     *prefix;
+    uint64_t        max_bytes;      /* -C, 0 for no size limit */
+    uint64_t        max_ns;         /* -G, 0 for no time limit */
+    unsigned        max_files;      /* -W, 0 keeps every file */
+    bool            apple_only;     /* -A, or implied by -T */
+    uint32_t        type_mask;      /* -T, 0 for any type */
+    bool            to_stdout;      /* -w - */
+    const char     *stats_path;
+    unsigned        stats_secs;
+    bool            reopen;
+    bool            verbose;
+    bool            measure_lag;    /* -L */
+    /* input */
+    int             fd;
+    capstream_t     in;
+    /* output */
+    FILE           *out;
+    char           *out_buf;
+    pcapng_writer_t w;
+    uint32_t        out_linktype;
+    uint64_t        out_start_ns;
+    char           *ring;           /* max_files names, name_cap bytes each */
+    size_t          name_cap;
+    char           *name;           /* current file */
+    unsigned        seq;
+    bool            rotate_next;    /* start a new file at the next packet */
+    /* -j */
+    capd_pipeline_t *pipe;          /* NULL when decoding on the reader */
+    /* stats */
+    capd_stats_t    st;
+    time_t          started;
+    uint64_t        next_stats_ns;
+} capd_t;
+
+static volatile sig_atomic_t stop_requested;
+static volatile sig_atomic_t rotate_requested;
+static volatile sig_atomic_t stats_requested;
+
+static void
+on_signal(int sig)
+{
+    if (sig == SIGHUP)
+        rotate_requested = 1;
+    else if (sig == SIGUSR1)
+        stats_requested = 1;
+    else
+        stop_requested = 1;
+}
+
+static void
+usage(FILE *out)
+{
+    fprintf(out,
+        "usage: continuity-capd -w prefix [-C MB] [-G seconds] [-W files] [-A] [-T types]\n"
+        "                       [-s stats] [-i seconds] [-B KB] [-j decoders] [-Q batches]\n"
+        "                       [-L] [-r] [-v] input\n"
+        "  input        FIFO, pipe or file carrying a pcap or pcapng stream; - for stdin\n"
+        "  -w prefix    write prefix_NNNNN_YYYYmmddHHMMSS.pcapng files; - writes a\n"
+        "               single pcapng stream to stdout\n"
+        "  -C MB        start a new file once this many MB have been written\n"
+        "  -G seconds   start a new file after this much capture time\n"
+        "  -W files     keep only the newest files, deleting the oldest\n"
+        "  -A           keep only adverts with Apple manufacturer data\n"
+        "  -T types     keep only Apple adverts holding one of these message types,\n"
+        "               as a comma-separated list such as 12,16\n"
+        "  -s stats     rewrite this file with the running counters\n"
+        "  -i seconds   stats interval (default %d)\n"
+        "  -B KB        input buffer size (default %d)\n"
+        "  -j decoders  read, decode and write on separate threads, with this many\n"
+        "               decoder threads\n"
+        "  -Q batches   with -j, batches of up to %d packets in flight (default %d);\n"
+        "               packets that arrive while all are in use are dropped\n"
+        "  -r           when the writer closes the FIFO, reopen it and wait for the next\n"
+        "  -L           report decode lag, the time from each packet's timestamp to its\n"
+        "               decode, in the stats file; needs wall-clock packet timestamps\n"
+        "  -v           log file rotation and the final counters to stderr\n"
+        "SIGHUP starts a new file at the next packet, SIGUSR1 writes the stats file\n"
+        "now, SIGINT and SIGTERM close the current file and exit.\n",
+        DEFAULT_STATS_SECS, DEFAULT_BUFFER_KB, BATCH_PACKETS, DEFAULT_BATCHES);
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static bool
+take_flag(volatile sig_atomic_t *flag)
+{
+    if (!*flag)
+        return false;
+    *flag = 0;
+
+    return true;
+}
+
+static void
+idle(void)
+{
+    struct timespec ts = { 0, IDLE_SLEEP_NS };
+
+    nanosleep(&ts, NULL);
+}
+
+static bool
+parse_uint(const char *s, uint64_t max, uint64_t *out)
+{
+    char               *end;
+    unsigned long long  v;
+
+    errno = 0;
+    v = strtoull(s, &end, 10);
+    if (errno || end == s || *end != '\0' || v > max)
+        return false;
+    *out = v;
+
+    return true;
+}
+
+/* Comma-separated message types, each below 32 */
+static int
+parse_types(const char *arg, uint32_t *mask)
+{
+    char   *end;
+
+    *mask = 0;
+    while (*arg) {
+        unsigned long   type = strtoul(arg, &end, 0);
+
+        if (end == arg || type >= 32 || (*end && *end != ','))
+            return -1;
+        *mask |= CONTINUITY_TYPE_BIT(type);
+        arg = *end == ',' ? end + 1 : end;
+    }
+
+    return *mask ? 0 : -1;
+}
+
+static void
+write_stats(capd_t *d)
+{
+    char        tmp[PATH_MAX];
+    FILE       *f;
+    unsigned    i;
+
+    if (!d->stats_path)
+        return;
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", d->stats_path) >= (int)sizeof(tmp))
+        return;
+
+    f = fopen(tmp, "w");
+    if (!f) {
+        fprintf(stderr, "continuity-capd: %s: %s\n", tmp, strerror(errno));
+        return;
+    }
+
+    fprintf(f, "time %lld\n", (long long)time(NULL));
+    fprintf(f, "started %lld\n", (long long)d->started);
+    fprintf(f, "streams %" PRIu64 "\n",
+            d->st.streams + (d->pipe ? (uint64_t)atomic_load(&d->pipe->streams) : 0));
+    fprintf(f, "packets %" PRIu64 "\n", d->st.packets);
+    fprintf(f, "bytes %" PRIu64 "\n", d->st.bytes);
+    fprintf(f, "adverts %" PRIu64 "\n", d->st.adverts);
+    fprintf(f, "apple %" PRIu64 "\n", d->st.apple);
+    fprintf(f, "filtered %" PRIu64 "\n", d->st.filtered);
+    fprintf(f, "messages %" PRIu64 "\n", d->st.messages);
+    fprintf(f, "messages.short %" PRIu64 "\n", d->st.short_msgs);
+    fprintf(f, "messages.truncated %" PRIu64 "\n", d->st.truncated_msgs);
+    for (i = 0; i < 256; i++)
+        if (d->st.types[i])
+            fprintf(f, "type.%u %" PRIu64 "\t# %s\n", i, d->st.types[i],
+                    continuity_type_name((uint8_t)i));
+    for (i = 0; i <= CONTINUITY_OS_IOS13; i++)
+        if (d->st.os[i])
+            fprintf(f, "os.%u %" PRIu64 "\t# %s\n", i, d->st.os[i],
+                    continuity_os_name((continuity_os_t)i));
+    fprintf(f, "written %" PRIu64 "\n", d->st.written);
+    fprintf(f, "written.bytes %" PRIu64 "\n", d->st.written_bytes);
+    fprintf(f, "files %" PRIu64 "\n", d->st.files);
+    fprintf(f, "files.deleted %" PRIu64 "\n", d->st.deleted);
+    if (d->pipe) {
+        capd_pipeline_t    *p = d->pipe;
+        size_t              decode = 0;
+
+        for (i = 0; i < p->decoder_count; i++)
+            decode += ring_spsc_depth(&p->decoders[i].in);
+        fprintf(f, "dropped %" PRIu64 "\n", (uint64_t)atomic_load(&p->dropped));
+        fprintf(f, "queue.batches %zu\n", p->batches);
+        fprintf(f, "queue.decode %zu\n", decode);
+        fprintf(f, "queue.write %zu\n", ring_mpsc_depth(&p->decoded));
+        fprintf(f, "queue.max %" PRIu64 "\n", (uint64_t)atomic_load(&p->queue_max));
+    }
+    if (d->measure_lag) {
+        fprintf(f, "lag.last_us %" PRIu64 "\n", d->st.lag_last_ns / 1000);
+        fprintf(f, "lag.max_us %" PRIu64 "\n", d->st.lag_max_ns / 1000);
+        fprintf(f, "lag.mean_us %" PRIu64 "\n",
+                d->st.lag_count ? d->st.lag_sum_ns / d->st.lag_count / 1000 : 0);
+        d->st.lag_max_ns = 0;
+        d->st.lag_sum_ns = 0;
+        d->st.lag_count  = 0;
+    }
+    if (d->out)
+        fprintf(f, "file %s\n", d->name);
+
+    if (fclose(f) != 0 || rename(tmp, d->stats_path) != 0)
+        fprintf(stderr, "continuity-capd: %s: %s\n", d->stats_path, strerror(errno));
+}
+
+static void
+count_apple(capd_stats_t *st, const uint8_t *payload, size_t payload_len,
+        const continuity_ad_ctx_t *ctx)
+{
+    continuity_frame_t  frame;
+    unsigned            i;
+
+    continuity_decode(payload, payload_len, &frame);
+    continuity_infer_os(&frame, ctx);
+    st->messages += frame.count;
+    st->os[frame.os]++;
+    for (i = 0; i < frame.count; i++) {
+        st->types[frame.msgs[i].type]++;
+        if (frame.msgs[i].status == CONTINUITY_MSG_SHORT)
+            st->short_msgs++;
+        else if (frame.msgs[i].status == CONTINUITY_MSG_TRUNCATED)
+            st->truncated_msgs++;
+    }
+}
+
+static int
+close_output(capd_t *d)
+{
+    int ret = 0;
+
+    if (!d->out || d->to_stdout)
+        return 0;
+    if (fclose(d->out) != 0) {
+        fprintf(stderr, "continuity-capd: %s: %s\n", d->name, strerror(errno));
+        ret = -1;
+    }
+    d->out = NULL;
+
+    return ret;
+}
+
+static int
+open_output(capd_t *d, uint32_t linktype, uint64_t ts_ns)
+{
+    struct tm   tm;
+    time_t      secs = (time_t)(ts_ns / NS_PER_SEC);
+    char        stamp[16];
+
+    if (close_output(d) < 0)
+        return -1;
+
+    /* A new linktype on stdout starts a new section in the same stream */
+    if (d->to_stdout) {
+        d->out = stdout;
+        snprintf(d->name, d->name_cap, "standard output");
+        if (pcapng_open(&d->w, d->out, linktype, SNAPLEN) < 0) {
+            fprintf(stderr, "continuity-capd: %s: write error\n", d->name);
+            return -1;
+        }
+        d->out_linktype = linktype;
+        d->st.files++;
+        return 0;
+    }
+
+    /* The slot the new file takes holds the oldest name once the ring is full */
+    if (d->max_files) {
+        d->name = d->ring + (size_t)(d->seq % d->max_files) * d->name_cap;
+        if (d->name[0]) {
+            if (unlink(d->name) == 0)
+                d->st.deleted++;
+            else if (errno != ENOENT)
+                fprintf(stderr, "continuity-capd: %s: %s\n", d->name, strerror(errno));
+        }
+    }
+
+    gmtime_r(&secs, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d%H%M%S", &tm);
+    d->seq++;
+    snprintf(d->name, d->name_cap, "%s_%05u_%s.pcapng", d->prefix, d->seq, stamp);
+
+    d->out = fopen(d->name, "wb");
+    if (!d->out) {
+        fprintf(stderr, "continuity-capd: %s: %s\n", d->name, strerror(errno));
+        d->name[0] = '\0';
+        return -1;
+    }
+    setvbuf(d->out, d->out_buf, _IOFBF, OUTPUT_BUFFER_LEN);
+    if (pcapng_open(&d->w, d->out, linktype, SNAPLEN) < 0) {
+        fprintf(stderr, "continuity-capd: %s: write error\n", d->name);
+        return -1;
+    }
+
+    d->out_linktype = linktype;
+    d->out_start_ns = ts_ns;
+    d->st.files++;
+    if (d->verbose)
+        fprintf(stderr, "continuity-capd: writing %s\n", d->name);
+
+    return 0;
+}
+
+static int
+write_packet(capd_t *d, const capfile_packet_t *pkt)
+{
+    /* Enhanced Packet Block: 28 bytes of header, padded data, trailing length */
+    uint64_t    block_len = 32 + ((pkt->caplen + 3u) & ~3u);
+    bool        rotate = d->rotate_next || !d->out;
+
+    if (d->out) {
+        if (pkt->linktype != d->out_linktype)
+            rotate = true;
+        if (d->max_bytes && d->w.packets && d->w.bytes + block_len > d->max_bytes)
+            rotate = true;
+        if (d->max_ns && pkt->ts_ns >= d->out_start_ns + d->max_ns)
+            rotate = true;
+    }
+    if (rotate) {
+        d->rotate_next = false;
+        if (open_output(d, pkt->linktype, pkt->ts_ns) < 0)
+            return -1;
+    }
+
+    if (pcapng_write(&d->w, pkt->ts_ns / 1000, pkt->data, pkt->caplen, pkt->origlen) < 0) {
+        fprintf(stderr, "continuity-capd: %s: write error\n", d->name);
+        return -1;
+    }
+    d->st.written++;
+    d->st.written_bytes += block_len;
+
+    return 0;
+}
+
+static void
+measure_lag(capd_stats_t *st, const capfile_packet_t *pkt)
+{
+    struct timespec ts;
+    uint64_t        now;
+    uint64_t        lag;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    now = (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+    lag = now > pkt->ts_ns ? now - pkt->ts_ns : 0;
+
+    st->lag_last_ns = lag;
+    st->lag_sum_ns += lag;
+    st->lag_count++;
+    if (lag > st->lag_max_ns)
+        st->lag_max_ns = lag;
+}
+
+/* Count pkt into st and say whether it should be written.  The pre-filter
+ * only reads the PDU header, the AD structure headers and, with -T, the
+ * TLV headers; frames it drops are never decoded or written.  Only reads
+ * the options in d, so decoder threads can share it. */
+static bool
+decode_packet(const capd_t *d, capd_stats_t *st, const capfile_packet_t *pkt)
+{
+    btle_adv_t          adv;
+    continuity_ad_ctx_t ctx;
+    const uint8_t      *payload = NULL;
+    size_t              payload_len = 0;
+    bool                apple = false;
+
+    st->packets++;
+    st->bytes += pkt->caplen;
+    if (d->measure_lag)
+        measure_lag(st, pkt);
+
+    if (btle_parse_adv(pkt->linktype, pkt->data, pkt->caplen, &adv)) {
+        st->adverts++;
+        apple = continuity_ad_payload(adv.ad, adv.ad_len, &payload, &payload_len, &ctx);
+    }
+    if (d->apple_only && (!apple || (d->type_mask &&
+            !(continuity_type_mask(payload, payload_len) & d->type_mask)))) {
+        st->filtered++;
+        return false;
+    }
+    if (apple) {
+        st->apple++;
+        count_apple(st, payload, payload_len, &ctx);
+    }
+
+    return true;
+}
+
+static int
+handle_packet(capd_t *d, const capfile_packet_t *pkt)
+{
+    if (take_flag(&rotate_requested))
+        d->rotate_next = true;
+    if (!decode_packet(d, &d->st, pkt))
+        return 0;
+
+    return write_packet(d, pkt);
+}
+
+static void
+merge_stats(capd_stats_t *to, const capd_stats_t *from)
+{
+    unsigned    i;
+
+    to->packets        += from->packets;
+    to->bytes          += from->bytes;
+    to->adverts        += from->adverts;
+    to->apple          += from->apple;
+    to->filtered       += from->filtered;
+    to->messages       += from->messages;
+    to->short_msgs     += from->short_msgs;
+    to->truncated_msgs += from->truncated_msgs;
+    for (i = 0; i < 256; i++)
+        to->types[i] += from->types[i];
+    for (i = 0; i <= CONTINUITY_OS_IOS13; i++)
+        to->os[i] += from->os[i];
+    if (from->lag_count) {
+        to->lag_last_ns = from->lag_last_ns;
+        to->lag_sum_ns += from->lag_sum_ns;
+        to->lag_count  += from->lag_count;
+        if (from->lag_max_ns > to->lag_max_ns)
+            to->lag_max_ns = from->lag_max_ns;
+    }
+}
+
+/* Reader: hand the batch being filled to the decoder with the shortest
+ * queue, taking turns between decoders that tie */
+static void
+submit_batch(capd_t *d)
+{
+    capd_pipeline_t    *p = d->pipe;
+    capd_decoder_t     *best = NULL;
+    size_t              best_depth = SIZE_MAX;
+    uint64_t            in_flight;
+    unsigned            i;
+
+    if (!p->cur || p->cur->count == 0)
+        return;
+
+    for (i = 0; i < p->decoder_count; i++) {
+        capd_decoder_t *dec = &p->decoders[(p->next_decoder + i) % p->decoder_count];
+        size_t          depth = ring_spsc_depth(&dec->in);
+
+        if (depth < best_depth) {
+            best       = dec;
+            best_depth = depth;
+        }
+    }
+    p->next_decoder = (p->next_decoder + 1) % p->decoder_count;
+
+    p->cur->seq = p->next_seq++;
+    /* Never full: each decoder's ring can hold every batch */
+    ring_spsc_push(&best->in, p->cur);
+    p->cur = NULL;
+    atomic_store(&p->submitted, p->next_seq);
+
+    in_flight = p->batches - ring_spsc_depth(&p->free);
+    if (in_flight > atomic_load_explicit(&p->queue_max, memory_order_relaxed))
+        atomic_store_explicit(&p->queue_max, in_flight, memory_order_relaxed);
+}
+
+/* Reader: copy pkt into the current batch, or drop it if no batch is free */
+static void
+enqueue_packet(capd_t *d, const capfile_packet_t *pkt)
+{
+    capd_pipeline_t    *p = d->pipe;
+    capd_batch_t       *b = p->cur;
+    capd_entry_t       *e;
+
+    if (b && (b->count == BATCH_PACKETS || BATCH_BYTES - b->used < pkt->caplen)) {
+        submit_batch(d);
+        b = NULL;
+    }
+    if (!b && pkt->caplen <= BATCH_BYTES && (b = ring_spsc_pop(&p->free))) {
+        b->count = 0;
+        b->used  = 0;
+        p->cur   = b;
+    }
+    if (!b) {
+        atomic_fetch_add_explicit(&p->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    e = &b->entries[b->count++];
+    memcpy(b->data + b->used, pkt->data, pkt->caplen);
+    e->pkt      = *pkt;
+    e->pkt.data = b->data + b->used;
+    e->rotate   = take_flag(&rotate_requested);
+    b->used    += pkt->caplen;
+}
+
+static void *
+decoder_main(void *arg)
+{
+    capd_decoder_t     *dec = arg;
+    capd_pipeline_t    *p = dec->d->pipe;
+    capd_batch_t       *b;
+    size_t              i;
+
+    for (;;) {
+        b = ring_spsc_pop(&dec->in);
+        if (!b) {
+            /* The reader pushes its last batch before setting reader_done */
+            if (atomic_load(&p->reader_done) && !(b = ring_spsc_pop(&dec->in)))
+                break;
+            if (!b) {
+                idle();
+                continue;
+            }
+        }
+
+        memset(&b->st, 0, sizeof(b->st));
+        for (i = 0; i < b->count; i++)
+            b->entries[i].keep = decode_packet(dec->d, &b->st, &b->entries[i].pkt);
+
+        while (!ring_mpsc_push(&p->decoded, b))
+            idle();
+    }
+
+    return NULL;
+}
+
+static int
+write_batch(capd_t *d, const capd_batch_t *b)
+{
+    size_t  i;
+
+    merge_stats(&d->st, &b->st);
+    for (i = 0; i < b->count; i++) {
+        const capd_entry_t *e = &b->entries[i];
+
+        if (e->rotate)
+            d->rotate_next = true;
+        if (e->keep && write_packet(d, &e->pkt) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static void tick(capd_t *d, bool write_now);
+
+/* Writer: batches come out of the decoders in any order and are written
+ * in the order the reader submitted them */
+static void *
+writer_main(void *arg)
+{
+    capd_t             *d = arg;
+    capd_pipeline_t    *p = d->pipe;
+    capd_batch_t       *b;
+    bool                dirty = false;
+
+    for (;;) {
+        while ((b = ring_mpsc_pop(&p->decoded)))
+            p->reorder[b->seq % p->batches] = b;
+
+        tick(d, atomic_exchange(&p->stats_now, false));
+        if (atomic_exchange(&p->flush_now, false) && d->out)
+            fflush(d->out);
+
+        b = p->reorder[p->write_seq % p->batches];
+        if (b && b->seq == p->write_seq) {
+            p->reorder[p->write_seq % p->batches] = NULL;
+            if (write_batch(d, b) < 0) {
+                atomic_store(&p->failed, true);
+                break;
+            }
+            /* Never full: the ring can hold every batch */
+            ring_spsc_push(&p->free, b);
+            p->write_seq++;
+            dirty = true;
+            continue;
+        }
+
+        /* Caught up: hand a live reader what we have before waiting */
+        if (dirty && d->to_stdout && d->out)
+            fflush(d->out);
+        dirty = false;
+        if (atomic_load(&p->reader_done) && p->write_seq == atomic_load(&p->submitted))
+            break;
+        idle();
+    }
+
+    return NULL;
+}
+
+static int
+start_pipeline(capd_t *d, unsigned decoder_count, size_t batches)
+{
+    capd_pipeline_t    *p;
+    sigset_t            all;
+    sigset_t            old;
+    unsigned            started;
+    size_t              i;
+    int                 err = 0;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return -1;
+    d->pipe = p;
+    p->batches       = batches;
+    p->decoder_count = decoder_count;
+    p->pool          = calloc(batches, sizeof(*p->pool));
+    p->reorder       = calloc(batches, sizeof(*p->reorder));
+    p->decoders      = calloc(decoder_count, sizeof(*p->decoders));
+    if (!p->pool || !p->reorder || !p->decoders ||
+            ring_mpsc_init(&p->decoded, batches) < 0 ||
+            ring_spsc_init(&p->free, batches) < 0)
+        return -1;
+    for (i = 0; i < decoder_count; i++) {
+        p->decoders[i].d = d;
+        if (ring_spsc_init(&p->decoders[i].in, batches) < 0)
+            return -1;
+    }
+    for (i = 0; i < batches; i++)
+        ring_spsc_push(&p->free, &p->pool[i]);
+
+    /* Signals belong to the reading thread, whose poll() they interrupt */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (started = 0; started < decoder_count; started++) {
+        err = pthread_create(&p->decoders[started].thread, NULL, decoder_main,
+                &p->decoders[started]);
+        if (err)
+            break;
+    }
+    if (!err)
+        err = pthread_create(&p->writer, NULL, writer_main, d);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (err) {
+        errno = err;
+        atomic_store(&p->reader_done, true);
+        while (started > 0)
+            pthread_join(p->decoders[--started].thread, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Submit the last batch and wait for the writer to finish with it.
+ * Returns -1 if the writer failed. */
+static int
+stop_pipeline(capd_t *d)
+{
+    capd_pipeline_t    *p = d->pipe;
+    unsigned            i;
+
+    submit_batch(d);
+    atomic_store(&p->reader_done, true);
+    for (i = 0; i < p->decoder_count; i++)
+        pthread_join(p->decoders[i].thread, NULL);
+    pthread_join(p->writer, NULL);
+
+    return atomic_load(&p->failed) ? -1 : 0;
+}
+
+static void
+free_pipeline(capd_t *d)
+{
+    capd_pipeline_t    *p = d->pipe;
+    unsigned            i;
+
+    if (!p)
+        return;
+    if (p->decoders)
+        for (i = 0; i < p->decoder_count; i++)
+            ring_spsc_free(&p->decoders[i].in);
+    ring_mpsc_free(&p->decoded);
+    ring_spsc_free(&p->free);
+    free(p->decoders);
+    free(p->reorder);
+    free(p->pool);
+    free(p);
+    d->pipe = NULL;
+}
+
+static int
+open_input(capd_t *d)
+{
+    if (strcmp(d->input, "-") == 0) {
+        d->fd = STDIN_FILENO;
+    } else {
+        /* Opening a FIFO blocks until the sniffer opens the other end */
+        do {
+            d->fd = open(d->input, O_RDONLY);
+        } while (d->fd < 0 && errno == EINTR && !stop_requested);
+        if (d->fd < 0) {
+            if (!stop_requested)
+                fprintf(stderr, "continuity-capd: %s: %s\n", d->input, strerror(errno));
+            return -1;
+        }
+    }
+
+    capstream_attach(&d->in, d->fd);
+    if (d->pipe)
+        atomic_fetch_add(&d->pipe->streams, 1);
+    else
+        d->st.streams++;
+
+    return 0;
+}
+
+static void
+close_input(capd_t *d)
+{
+    if (d->fd > STDIN_FILENO)
+        close(d->fd);
+    d->fd = -1;
+    capstream_detach(&d->in);
+}
+
+/* Wait up to POLL_MS for more of the stream.  Returns 1 when the buffer
+ * holds new data, 0 at the end of the stream and -1 on an error; also
+ * returns 1 with nothing read on a poll timeout or a signal, so the caller
+ * gets to run its timers. */
+static int
+fill(capd_t *d)
+{
+    struct pollfd   pfd;
+    int             n;
+
+    pfd.fd     = d->fd;
+    pfd.events = POLLIN;
+    n = poll(&pfd, 1, POLL_MS);
+    if (n < 0 && errno != EINTR) {
+        d->in.error = "poll error";
+        return -1;
+    }
+    if (n <= 0)
+        return 1;
+
+    return capstream_read(&d->in);
+}
+
+static void
+tick(capd_t *d, bool write_now)
+{
+    uint64_t    now;
+
+    if (write_now)
+        write_stats(d);
+    if (d->stats_secs == 0)
+        return;
+
+    now = now_ns();
+    if (now < d->next_stats_ns)
+        return;
+    d->next_stats_ns = now + (uint64_t)d->stats_secs * NS_PER_SEC;
+
+    /* Let readers of the current file see what has arrived so far */
+    if (d->out)
+        fflush(d->out);
+    write_stats(d);
+}
+
+static int
+capture(capd_t *d)
+{
+    capfile_packet_t    pkt;
+    int                 r;
+
+    while (!stop_requested) {
+        r = capstream_next(&d->in, &pkt);
+        if (r > 0) {
+            if (d->pipe)
+                enqueue_packet(d, &pkt);
+            else if (handle_packet(d, &pkt) < 0)
+                return -1;
+            continue;
+        }
+        if (r < 0) {
+            fprintf(stderr, "continuity-capd: %s: %s\n", d->input, d->in.error);
+            return -1;
+        }
+
+        /* Hand a live reader what we have before waiting for more */
+        if (d->pipe)
+            submit_batch(d);
+        else if (d->to_stdout && d->out)
+            fflush(d->out);
+        if (d->pipe && atomic_load(&d->pipe->failed))
+            return -1;
+
+        errno = 0;
+        r = fill(d);
+        if (d->pipe) {
+            if (take_flag(&stats_requested))
+                atomic_store(&d->pipe->stats_now, true);
+        } else {
+            tick(d, take_flag(&stats_requested));
+        }
+        if (r < 0) {
+            fprintf(stderr, "continuity-capd: %s: %s", d->input, d->in.error);
+            if (errno)
+                fprintf(stderr, " (%s)", strerror(errno));
+            fputc('\n', stderr);
+            return -1;
+        }
+        if (r == 0) {
+            if (capstream_pending(&d->in) && d->verbose)
+                fprintf(stderr, "continuity-capd: %s: %zu bytes of partial record at end of stream\n",
+                        d->input, capstream_pending(&d->in));
+            close_input(d);
+            if (!d->reopen || strcmp(d->input, "-") == 0)
+                return 0;
+            if (d->pipe)
+                atomic_store(&d->pipe->flush_now, true);
+            else if (d->out)
+                fflush(d->out);
+            if (open_input(d) < 0)
+                return stop_requested ? 0 : -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct sigaction    sa;
+    capd_t              d;
+    size_t              buf_cap = (size_t)DEFAULT_BUFFER_KB * 1024;
+    unsigned            decoders = 0;
+    size_t              batches = DEFAULT_BATCHES;
+    uint64_t            v;
+    int                 opt;
+    int                 ret;
+
+    memset(&d, 0, sizeof(d));
+    d.fd         = -1;
+    d.stats_secs = DEFAULT_STATS_SECS;
+
+    while ((opt = getopt(argc, argv, "AB:C:G:LQ:T:W:hi:j:rs:vw:")) != -1) {
+        switch (opt) {
+        case 'A':
+            d.apple_only = true;
+            break;
+        case 'B':
+            if (!parse_uint(optarg, 1024 * 1024, &v) || v < 64) {
+                fprintf(stderr, "continuity-capd: -B takes 64 to 1048576 KB\n");
+                return 1;
+            }
+            buf_cap = (size_t)v * 1024;
+            break;
+        case 'C':
+            if (!parse_uint(optarg, UINT64_MAX / 1000000, &v) || v == 0) {
+                fprintf(stderr, "continuity-capd: bad -C size '%s'\n", optarg);
+                return 1;
+            }
+            d.max_bytes = v * 1000000;
+            break;
+        case 'G':
+            if (!parse_uint(optarg, UINT64_MAX / NS_PER_SEC, &v) || v == 0) {
+                fprintf(stderr, "continuity-capd: bad -G interval '%s'\n", optarg);
+                return 1;
+            }
+            d.max_ns = v * NS_PER_SEC;
+            break;
+        case 'L':
+            d.measure_lag = true;
+            break;
+        case 'Q':
+            if (!parse_uint(optarg, 65536, &v) || v < 2) {
+                fprintf(stderr, "continuity-capd: -Q takes 2 to 65536 batches\n");
+                return 1;
+            }
+            batches = (size_t)v;
+            break;
+        case 'T':
+            if (parse_types(optarg, &d.type_mask) < 0) {
+                fprintf(stderr, "continuity-capd: bad -T list '%s'\n", optarg);
+                return 1;
+            }
+            d.apple_only = true;
+            break;
+        case 'W':
+            if (!parse_uint(optarg, 100000, &v)) {
+                fprintf(stderr, "continuity-capd: -W takes 0 to 100000 files\n");
+                return 1;
+            }
+            d.max_files = (unsigned)v;
+            break;
+        case 'i':
+            if (!parse_uint(optarg, 86400, &v)) {
+                fprintf(stderr, "continuity-capd: bad -i interval '%s'\n", optarg);
+                return 1;
+            }
+            d.stats_secs = (unsigned)v;
+            break;
+        case 'j':
+            if (!parse_uint(optarg, MAX_DECODERS, &v) || v == 0) {
+                fprintf(stderr, "continuity-capd: -j takes 1 to %d decoders\n", MAX_DECODERS);
+                return 1;
+            }
+            decoders = (unsigned)v;
+            break;
+        case 'r':
+            d.reopen = true;
+            break;
+        case 's':
+            d.stats_path = optarg;
+            break;
+        case 'v':
+            d.verbose = true;
+            break;
+        case 'w':
+            d.prefix = optarg;
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || !d.prefix) {
+        usage(stderr);
+        return 1;
+    }
+    d.input = argv[optind];
+    d.to_stdout = strcmp(d.prefix, "-") == 0;
+    if (d.to_stdout && (d.max_bytes || d.max_ns || d.max_files)) {
+        fprintf(stderr, "continuity-capd: -C, -G and -W need a file prefix\n");
+        return 1;
+    }
+    if (d.max_files && !d.max_bytes && !d.max_ns)
+        fprintf(stderr, "continuity-capd: -W without -C or -G keeps a single file\n");
+
+    d.name_cap = strlen(d.prefix) + NAME_SUFFIX_LEN;
+    d.out_buf  = malloc(OUTPUT_BUFFER_LEN);
+    d.ring     = calloc(d.max_files ? d.max_files : 1, d.name_cap);
+    if (capstream_init(&d.in, buf_cap) < 0 || !d.out_buf || !d.ring) {
+        fprintf(stderr, "continuity-capd: out of memory\n");
+        return 1;
+    }
+    d.name = d.ring;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    /* No SA_RESTART: a signal has to wake the blocking open() and poll() */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    d.started       = time(NULL);
+    d.next_stats_ns = now_ns() + (uint64_t)d.stats_secs * NS_PER_SEC;
+
+    if (decoders && start_pipeline(&d, decoders, batches) < 0) {
+        fprintf(stderr, "continuity-capd: cannot start the pipeline: %s\n", strerror(errno));
+        free_pipeline(&d);
+        return 1;
+    }
+
+    ret = open_input(&d) < 0 && !stop_requested ? 1 : 0;
+    if (d.fd >= 0 && capture(&d) < 0)
+        ret = 1;
+    if (d.pipe && stop_pipeline(&d) < 0)
+        ret = 1;
+    close_input(&d);
+    if (close_output(&d) < 0 || (d.to_stdout && fflush(stdout) != 0))
+        ret = 1;
+    write_stats(&d);
+
+    if (d.verbose)
+        fprintf(stderr, "continuity-capd: packets %" PRIu64 ", adverts %" PRIu64
+                ", apple %" PRIu64 ", filtered %" PRIu64 ", messages %" PRIu64
+                ", written %" PRIu64 " in %" PRIu64 " files\n", d.st.packets,
+                d.st.adverts, d.st.apple, d.st.filtered, d.st.messages, d.st.written,
+                d.st.files);
+
+    free_pipeline(&d);
+    free(d.ring);
+    free(d.out_buf);
+    capstream_free(&d.in);
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,697 @@
+/* continuity-fuse.c
+ * Merge BLE captures from several sniffers and collapse repeated adverts
+ *
+ * Each sniffer hears one advertising channel, so an advertising event is
+ * captured up to three times per node, and again by every extra node.
+ * This tool reads several pcap or pcapng streams (files, FIFOs or pipes),
+ * merges them by timestamp and folds every copy of the same advert seen
+ * within a short window into the first one.  Each output record keeps the
+ * channel and RSSI of every sighting.
+ *
+ * Duplicates are found through a fixed-size open-addressing table keyed
+ * by a hash of the PDU type, advertiser address and AD data; entries older
+ * than the window count as free, so the table never needs clearing.
+ * Records wait in a fixed ring until their window has passed, then go out
+ * in timestamp order.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btle.h"
+#include "capstream.h"
+#include "continuity.h"
+#include "pcapng.h"
+
+#define MAX_SOURCES         32
+#define MAX_SIGHTINGS       8
+#define RECORD_DATA_LEN     512     /* longer packets are truncated */
+#define BUFFER_LEN          (256 * 1024)
+#define PROBE_LIMIT         16
+#define POLL_MS             1000
+#define SNAPLEN             RECORD_DATA_LEN
+#define COMMENT_LEN         (32 + MAX_SIGHTINGS * 40)
+#define NS_PER_SEC          1000000000ULL
+#define NS_PER_MS           1000000ULL
+
+#define DEFAULT_WINDOW_MS   10
+#define DEFAULT_LAG_MS      500
+#define DEFAULT_TABLE_BITS  16
+#define DEFAULT_RING_BITS   14
+
+enum {
+    FORMAT_PCAPNG = 0,
+    FORMAT_TEXT
+};
+
+typedef struct {
+    const char         *path;
+    int                 fd;
+    capstream_t         in;
+    capfile_packet_t    head;       /* next packet, valid while has_head */
+    bool                has_head;
+    bool                done;
+    uint64_t            waiting_since;  /* when it ran dry, 0 while it has a head */
+    uint64_t            packets;
+    uint64_t            duplicates; /* copies folded into an earlier record */
+} source_t;
+
+typedef struct {
+    uint8_t     source;
+    int8_t      channel;            /* -1 if unknown */
+    bool        has_rssi;
+    int8_t      rssi;
+    uint32_t    delay_us;           /* after the first sighting */
+} sighting_t;
+
+typedef struct {
+    uint64_t    ts_ns;
+    uint32_t    linktype;
+    uint32_t    caplen;
+    uint32_t    origlen;
+    bool        advert;             /* false for packets passed through as they are */
+    uint8_t     addr[6];
+    const uint8_t *ad;              /* into data */
+    size_t      ad_len;
+    unsigned    count;              /* sightings; only MAX_SIGHTINGS are kept */
+    sighting_t  sightings[MAX_SIGHTINGS];
+    uint8_t     data[RECORD_DATA_LEN];
+} record_t;
+
+typedef struct {
+    uint64_t    key;                /* 0 marks a slot never used */
+    uint64_t    ts_ns;              /* first sighting */
+    uint64_t    record;             /* sequence number of its record */
+} dedup_entry_t;
+
+typedef struct {
+    /* options */
+    uint64_t        window_ns;
+    uint64_t        lag_ns;
+    int             format;
+    bool            verbose;
+    /* sources */
+    source_t        sources[MAX_SOURCES];
+    size_t          source_count;
+    /* duplicate table */
+    dedup_entry_t  *table;
+    size_t          table_mask;
+    /* pending records, sequence numbers head to tail */
+    record_t       *ring;
+    size_t          ring_mask;
+    uint64_t        head_seq;
+    uint64_t        tail_seq;
+    /* output */
+    FILE           *out;
+    pcapng_writer_t w;
+    bool            w_open;
+    uint32_t        out_linktype;
+    /* totals */
+    uint64_t        packets;
+    uint64_t        adverts;
+    uint64_t        records;
+    uint64_t        duplicates;
+    uint64_t        late;           /* duplicates whose record had already gone out */
+    uint64_t        evicted;        /* table entries overwritten while still live */
+    uint64_t        early;          /* records written before their window closed */
+    uint64_t        reordered;      /* packets older than one already merged */
+    uint64_t        last_ts_ns;
+} fuse_t;
+
+static volatile sig_atomic_t stop_requested;
+
+static void
+on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void
+usage(FILE *out)
+{
+    fprintf(out,
+        "usage: continuity-fuse [-f pcapng|text] [-o file] [-w ms] [-l ms] [-H bits]\n"
+        "                       [-R bits] [-v] input...\n"
+        "  input        pcap or pcapng file, FIFO or pipe; - for stdin.  Sources are\n"
+        "               numbered from 0 in the order given\n"
+        "  -f format    pcapng (default), with the sightings as packet comments, or\n"
+        "               text, one line per advert\n"
+        "  -o file      write to file instead of stdout\n"
+        "  -w ms        copies of an advert within this window are one event (default %d)\n"
+        "  -l ms        how long to wait for a quiet live source before merging\n"
+        "               without it (default %d)\n"
+        "  -H bits      duplicate table size, 2^bits entries (default %d)\n"
+        "  -R bits      pending record ring size, 2^bits records (default %d)\n"
+        "  -v           print per-source and total counts to stderr\n",
+        DEFAULT_WINDOW_MS, DEFAULT_LAG_MS, DEFAULT_TABLE_BITS, DEFAULT_RING_BITS);
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* FNV-1a over the parts of an advert that identify one transmission */
+static uint64_t
+advert_key(const btle_adv_t *adv)
+{
+    uint64_t    h = 0xcbf29ce484222325ULL;
+    uint8_t     hdr = (uint8_t)(adv->pdu_type | (adv->random ? 0x40 : 0));
+    size_t      i;
+
+    h = (h ^ hdr) * 0x100000001b3ULL;
+    for (i = 0; i < 6; i++)
+        h = (h ^ adv->addr[i]) * 0x100000001b3ULL;
+    for (i = 0; i < adv->ad_len; i++)
+        h = (h ^ adv->ad[i]) * 0x100000001b3ULL;
+
+    return h ? h : 1;
+}
+
+static void
+format_time(uint64_t ts_ns, char *out)
+{
+    sprintf(out, "%" PRIu64 ".%09" PRIu64, (uint64_t)(ts_ns / NS_PER_SEC),
+            (uint64_t)(ts_ns % NS_PER_SEC));
+}
+
+/* "src 0 ch 37 -61 dBm +0 us; src 1 ch 38 -70 dBm +412 us" */
+static void
+format_sightings(const record_t *r, bool text, char *out, size_t cap)
+{
+    size_t      len = 0;
+    unsigned    i;
+    unsigned    n = r->count < MAX_SIGHTINGS ? r->count : MAX_SIGHTINGS;
+
+    out[0] = '\0';
+    for (i = 0; i < n && len < cap; i++) {
+        const sighting_t   *s = &r->sightings[i];
+        char                ch[8];
+        char                rssi[8];
+
+        if (s->channel >= 0)
+            snprintf(ch, sizeof(ch), "%d", s->channel);
+        else
+            strcpy(ch, "-");
+        if (s->has_rssi)
+            snprintf(rssi, sizeof(rssi), "%d", s->rssi);
+        else
+            strcpy(rssi, "-");
+
+        if (text)
+            len += (size_t)snprintf(out + len, cap - len, "%s%u:%s:%s:%" PRIu32,
+                    i ? "," : "", s->source, ch, rssi, s->delay_us);
+        else
+            len += (size_t)snprintf(out + len, cap - len, "%ssrc %u ch %s %s dBm +%" PRIu32 " us",
+                    i ? "; " : "", s->source, ch, rssi, s->delay_us);
+    }
+    if (r->count > n && len < cap)
+        snprintf(out + len, cap - len, text ? ",+%u" : "; %u more", r->count - n);
+}
+
+static int
+emit(fuse_t *f, const record_t *r)
+{
+    char    comment[COMMENT_LEN];
+
+    if (f->format == FORMAT_TEXT) {
+        char    ts[32];
+        char    ad[2 * RECORD_DATA_LEN + 1];
+
+        if (!r->advert)
+            return 0;
+        format_time(r->ts_ns, ts);
+        format_sightings(r, true, comment, sizeof(comment));
+        continuity_hex_encode(r->ad, r->ad_len, ad);
+        fprintf(f->out, "%s\t%02x:%02x:%02x:%02x:%02x:%02x\t%u\t%s\t%s\n", ts,
+                r->addr[0], r->addr[1], r->addr[2], r->addr[3], r->addr[4], r->addr[5],
+                r->count, comment, ad);
+        return ferror(f->out) ? -1 : 0;
+    }
+
+    /* A change of linktype starts a new section in the same stream */
+    if (!f->w_open || r->linktype != f->out_linktype) {
+        if (pcapng_open(&f->w, f->out, r->linktype, SNAPLEN) < 0)
+            return -1;
+        f->w_open       = true;
+        f->out_linktype = r->linktype;
+    }
+    if (r->advert)
+        format_sightings(r, false, comment, sizeof(comment));
+
+    return pcapng_write_comment(&f->w, r->ts_ns / 1000, r->data, r->caplen, r->origlen,
+            r->advert ? comment : NULL);
+}
+
+/* Write out the pending records whose window closed before ts_ns */
+static int
+flush_before(fuse_t *f, uint64_t ts_ns)
+{
+    while (f->head_seq != f->tail_seq) {
+        const record_t *r = &f->ring[f->head_seq & f->ring_mask];
+
+        if (r->ts_ns + f->window_ns >= ts_ns)
+            break;
+        if (emit(f, r) < 0)
+            return -1;
+        f->head_seq++;
+    }
+
+    return 0;
+}
+
+static int
+flush_all(fuse_t *f)
+{
+    return flush_before(f, UINT64_MAX);
+}
+
+static void
+add_sighting(record_t *r, uint8_t source, const btle_adv_t *adv, uint64_t ts_ns)
+{
+    sighting_t *s;
+
+    if (r->count++ >= MAX_SIGHTINGS)
+        return;
+    s = &r->sightings[r->count - 1];
+    s->source   = source;
+    s->channel  = (int8_t)adv->channel;
+    s->has_rssi = adv->has_rssi;
+    s->rssi     = adv->rssi;
+    s->delay_us = ts_ns > r->ts_ns ? (uint32_t)((ts_ns - r->ts_ns) / 1000) : 0;
+}
+
+static int
+new_record(fuse_t *f, uint8_t source, const capfile_packet_t *pkt, const btle_adv_t *adv)
+{
+    record_t   *r;
+
+    /* The ring is full: the oldest record goes out before its window ends */
+    if (f->tail_seq - f->head_seq > f->ring_mask) {
+        if (emit(f, &f->ring[f->head_seq & f->ring_mask]) < 0)
+            return -1;
+        f->head_seq++;
+        f->early++;
+    }
+
+    r = &f->ring[f->tail_seq++ & f->ring_mask];
+    r->ts_ns    = pkt->ts_ns;
+    r->linktype = pkt->linktype;
+    r->caplen   = pkt->caplen < RECORD_DATA_LEN ? pkt->caplen : RECORD_DATA_LEN;
+    r->origlen  = pkt->origlen;
+    r->advert   = adv != NULL;
+    r->count    = 0;
+    r->ad       = NULL;
+    r->ad_len   = 0;
+    memcpy(r->data, pkt->data, r->caplen);
+    if (adv) {
+        memcpy(r->addr, adv->addr, sizeof(r->addr));
+        r->ad     = r->data + (adv->ad - pkt->data);
+        r->ad_len = adv->ad_len;
+        add_sighting(r, source, adv, pkt->ts_ns);
+    }
+    f->records++;
+
+    return 0;
+}
+
+static int
+process(fuse_t *f, size_t source, const capfile_packet_t *pkt)
+{
+    dedup_entry_t  *free_slot = NULL;
+    dedup_entry_t  *oldest = NULL;
+    btle_adv_t      adv;
+    uint64_t        key;
+    size_t          i;
+
+    f->packets++;
+    f->sources[source].packets++;
+    if (pkt->ts_ns < f->last_ts_ns)
+        f->reordered++;
+    else
+        f->last_ts_ns = pkt->ts_ns;
+
+    if (flush_before(f, pkt->ts_ns) < 0)
+        return -1;
+
+    /* Anything but a legacy advert, or one that would not fit, goes through as it is */
+    if (!btle_parse_adv(pkt->linktype, pkt->data, pkt->caplen, &adv) ||
+            pkt->caplen > RECORD_DATA_LEN)
+        return new_record(f, (uint8_t)source, pkt, NULL);
+    f->adverts++;
+
+    key = advert_key(&adv);
+    for (i = 0; i < PROBE_LIMIT; i++) {
+        dedup_entry_t  *e = &f->table[(key + i) & f->table_mask];
+        bool            live = e->key && e->ts_ns + f->window_ns >= pkt->ts_ns;
+
+        if (live && e->key == key) {
+            f->duplicates++;
+            f->sources[source].duplicates++;
+            if (e->record >= f->head_seq)
+                add_sighting(&f->ring[e->record & f->ring_mask], (uint8_t)source, &adv, pkt->ts_ns);
+            else
+                f->late++;
+            return 0;
+        }
+        if (!live && !free_slot)
+            free_slot = e;
+        if (!oldest || e->ts_ns < oldest->ts_ns)
+            oldest = e;
+    }
+
+    if (!free_slot) {
+        free_slot = oldest;
+        f->evicted++;
+    }
+    free_slot->key    = key;
+    free_slot->ts_ns  = pkt->ts_ns;
+    free_slot->record = f->tail_seq;
+
+    return new_record(f, (uint8_t)source, pkt, &adv);
+}
+
+static int
+open_source(source_t *s)
+{
+    if (strcmp(s->path, "-") == 0) {
+        s->fd = STDIN_FILENO;
+    } else {
+        /* Opening a FIFO blocks until its sniffer opens the other end */
+        do {
+            s->fd = open(s->path, O_RDONLY);
+        } while (s->fd < 0 && errno == EINTR && !stop_requested);
+        if (s->fd < 0) {
+            fprintf(stderr, "continuity-fuse: %s: %s\n", s->path, strerror(errno));
+            return -1;
+        }
+    }
+    if (capstream_init(&s->in, BUFFER_LEN) < 0) {
+        fprintf(stderr, "continuity-fuse: %s\n", s->in.error);
+        return -1;
+    }
+    capstream_attach(&s->in, s->fd);
+
+    return 0;
+}
+
+static void
+source_failed(source_t *s)
+{
+    fprintf(stderr, "continuity-fuse: %s: %s", s->path, s->in.error);
+    if (errno)
+        fprintf(stderr, " (%s)", strerror(errno));
+    fputc('\n', stderr);
+    s->done = true;
+}
+
+/* Merge the sources by timestamp.  A live source with nothing buffered
+ * holds the merge back for up to lag_ns; after that the others go ahead
+ * without it, and its packets join late, still deduplicated within the
+ * window. */
+static int
+run(fuse_t *f)
+{
+    struct pollfd   pfds[MAX_SOURCES];
+    size_t          polled[MAX_SOURCES];
+    int             ret = 0;
+
+    while (!stop_requested) {
+        source_t   *next = NULL;
+        uint64_t    now = 0;
+        uint64_t    hold = 0;       /* longest a waiting source may still hold the merge */
+        size_t      need = 0;
+        size_t      avail = 0;
+        size_t      i;
+        int         n;
+
+        for (i = 0; i < f->source_count; i++) {
+            source_t   *s = &f->sources[i];
+
+            if (s->done)
+                continue;
+            if (!s->has_head) {
+                errno = 0;
+                n = capstream_next(&s->in, &s->head);
+                if (n > 0) {
+                    s->has_head      = true;
+                    s->waiting_since = 0;
+                } else if (n < 0) {
+                    source_failed(s);
+                    ret = -1;
+                    continue;
+                } else if (s->in.eof) {
+                    if (capstream_pending(&s->in))
+                        fprintf(stderr, "continuity-fuse: %s: partial record at end of stream\n",
+                                s->path);
+                    s->done = true;
+                    continue;
+                } else {
+                    if (!now)
+                        now = now_ns();
+                    if (!s->waiting_since)
+                        s->waiting_since = now;
+                    if (now - s->waiting_since < f->lag_ns &&
+                            f->lag_ns - (now - s->waiting_since) > hold)
+                        hold = f->lag_ns - (now - s->waiting_since);
+                    pfds[need].fd     = s->fd;
+                    pfds[need].events = POLLIN;
+                    polled[need++]    = i;
+                    continue;
+                }
+            }
+            avail++;
+            if (!next || s->head.ts_ns < next->head.ts_ns)
+                next = s;
+        }
+        if (!need && !avail)
+            break;
+
+        if (need) {
+            int timeout = avail ? (int)((hold + NS_PER_MS - 1) / NS_PER_MS) : POLL_MS;
+
+            n = poll(pfds, need, timeout);
+            if (n < 0 && errno != EINTR) {
+                perror("continuity-fuse: poll");
+                return -1;
+            }
+            if (n > 0) {
+                for (i = 0; i < need; i++) {
+                    source_t   *s = &f->sources[polled[i]];
+
+                    if (!pfds[i].revents)
+                        continue;
+                    errno = 0;
+                    if (capstream_read(&s->in) < 0) {
+                        source_failed(s);
+                        ret = -1;
+                    }
+                }
+                continue;
+            }
+            if (!avail) {
+                /* Every source is quiet: let the pending records out */
+                if (flush_all(f) < 0)
+                    return -1;
+                fflush(f->out);
+                continue;
+            }
+            if (hold)
+                continue;
+        }
+
+        next->has_head = false;
+        if (process(f, (size_t)(next - f->sources), &next->head) < 0)
+            return -1;
+    }
+
+    if (flush_all(f) < 0)
+        return -1;
+
+    return ret;
+}
+
+static bool
+parse_uint(const char *s, uint64_t max, uint64_t *out)
+{
+    char               *end;
+    unsigned long long  v;
+
+    errno = 0;
+    v = strtoull(s, &end, 10);
+    if (errno || end == s || *end != '\0' || v > max)
+        return false;
+    *out = v;
+
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    static char         out_buf[1 << 20];
+    static fuse_t       f;
+    struct sigaction    sa;
+    const char         *path = NULL;
+    uint64_t            table_bits = DEFAULT_TABLE_BITS;
+    uint64_t            ring_bits = DEFAULT_RING_BITS;
+    uint64_t            v;
+    size_t              i;
+    int                 opt;
+    int                 ret = 0;
+
+    f.window_ns = DEFAULT_WINDOW_MS * NS_PER_MS;
+    f.lag_ns    = DEFAULT_LAG_MS * NS_PER_MS;
+
+    while ((opt = getopt(argc, argv, "H:R:f:hl:o:vw:")) != -1) {
+        switch (opt) {
+        case 'H':
+            if (!parse_uint(optarg, 28, &table_bits) || table_bits < 4) {
+                fprintf(stderr, "continuity-fuse: -H takes 4 to 28 bits\n");
+                return 1;
+            }
+            break;
+        case 'R':
+            if (!parse_uint(optarg, 24, &ring_bits) || ring_bits < 4) {
+                fprintf(stderr, "continuity-fuse: -R takes 4 to 24 bits\n");
+                return 1;
+            }
+            break;
+        case 'f':
+            if (strcmp(optarg, "pcapng") == 0) {
+                f.format = FORMAT_PCAPNG;
+            } else if (strcmp(optarg, "text") == 0) {
+                f.format = FORMAT_TEXT;
+            } else {
+                usage(stderr);
+                return 1;
+            }
+            break;
+        case 'l':
+            if (!parse_uint(optarg, 3600 * 1000, &v)) {
+                fprintf(stderr, "continuity-fuse: bad -l lag '%s'\n", optarg);
+                return 1;
+            }
+            f.lag_ns = v * NS_PER_MS;
+            break;
+        case 'o':
+            path = optarg;
+            break;
+        case 'v':
+            f.verbose = true;
+            break;
+        case 'w':
+            if (!parse_uint(optarg, 3600 * 1000, &v)) {
+                fprintf(stderr, "continuity-fuse: bad -w window '%s'\n", optarg);
+                return 1;
+            }
+            f.window_ns = v * NS_PER_MS;
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind == argc) {
+        usage(stderr);
+        return 1;
+    }
+    if ((size_t)(argc - optind) > MAX_SOURCES) {
+        fprintf(stderr, "continuity-fuse: at most %d inputs\n", MAX_SOURCES);
+        return 1;
+    }
+
+    f.table_mask = ((size_t)1 << table_bits) - 1;
+    f.ring_mask  = ((size_t)1 << ring_bits) - 1;
+    f.table      = calloc(f.table_mask + 1, sizeof(*f.table));
+    f.ring       = malloc((f.ring_mask + 1) * sizeof(*f.ring));
+    if (!f.table || !f.ring) {
+        fprintf(stderr, "continuity-fuse: out of memory\n");
+        return 1;
+    }
+
+    f.out = path ? fopen(path, "wb") : stdout;
+    if (!f.out) {
+        fprintf(stderr, "continuity-fuse: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    setvbuf(f.out, out_buf, _IOFBF, sizeof(out_buf));
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (i = 0; i < (size_t)(argc - optind); i++) {
+        source_t   *s = &f.sources[f.source_count++];
+
+        s->path = argv[optind + (int)i];
+        if (open_source(s) < 0) {
+            s->done = true;
+            ret = 1;
+        }
+    }
+
+    if (run(&f) < 0)
+        ret = 1;
+    if (fflush(f.out) != 0 || (path && fclose(f.out) != 0)) {
+        fprintf(stderr, "continuity-fuse: %s: write error\n", path ? path : "standard output");
+        ret = 1;
+    }
+
+    if (f.verbose) {
+        for (i = 0; i < f.source_count; i++)
+            fprintf(stderr, "source %zu %s: packets %" PRIu64 ", duplicates %" PRIu64 "\n",
+                    i, f.sources[i].path, f.sources[i].packets, f.sources[i].duplicates);
+        fprintf(stderr, "packets %" PRIu64 ", adverts %" PRIu64 ", records %" PRIu64
+                ", duplicates %" PRIu64 ", late %" PRIu64 ", evicted %" PRIu64
+                ", early %" PRIu64 ", reordered %" PRIu64 "\n", f.packets, f.adverts,
+                f.records, f.duplicates, f.late, f.evicted, f.early, f.reordered);
+    }
+
+    for (i = 0; i < f.source_count; i++) {
+        if (f.sources[i].fd > STDIN_FILENO)
+            close(f.sources[i].fd);
+        capstream_free(&f.sources[i].in);
+    }
+    free(f.ring);
+    free(f.table);
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
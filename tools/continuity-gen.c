@@ -0,0 +1,528 @@
+/* continuity-gen.c
+ * Synthetic Apple Continuity advertisement generator
+ *
+ * Simulates a population of Apple devices advertising at a fixed interval
+ * and writes their adverts as pcapng (LINKTYPE_BLUETOOTH_LE_LL), as hex
+ * manufacturer data lines, or as raw length-prefixed buffers.  Each device
+ * is given a profile (phone, Mac, watch, AirPods, Find My tag, printer or
+ * HomeKit accessory) that decides which TLV combinations it sends; between
+ * them the profiles cover all 14 message types, including multi-TLV frames
+ * such as Handoff plus Nearby Info.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btle.h"
+#include "continuity.h"
+#include "pcapng.h"
+#include "synth.h"
+
+#define MAX_COMBO           4
+#define MAX_DEVICES         1000000
+#define MAX_TYPES           SYNTH_TYPE_COUNT
+#define ADV_DELAY_MAX_US    10000   /* advDelay, Core spec Vol 6 Part B 4.4.2.2.1 */
+#define MFR_HEADER_LEN      4       /* length, type, company identifier */
+#define PAYLOAD_MAX         (BTLE_LEGACY_AD_MAX - MFR_HEADER_LEN)
+
+enum {
+    FORMAT_PCAPNG = 0,
+    FORMAT_HEX,
+    FORMAT_RAW
+};
+
+typedef struct {
+    unsigned        weight;         /* share of devices past the first of each */
+    uint8_t         pdu_type;
+    bool            random_addr;
+    int             flags;          /* Flags AD value, -1 for none */
+    bool            tx_power;       /* sometimes adds Tx Power, as iOS 13 does */
+    const uint8_t (*combos)[MAX_COMBO];
+    size_t          combo_count;
+} profile_t;
+
+/* TLV combinations per profile; a row ends at the first 0 */
+static const uint8_t phone_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_NEARBY_ACTION, CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_HANDOFF, CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_TETHERING_TARGET, CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_TETHERING_SOURCE },
+    { CONTINUITY_TYPE_AIRPLAY_SOURCE, CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_HEY_SIRI },
+    { CONTINUITY_TYPE_AIRDROP }
+};
+static const uint8_t mac_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_AIRPLAY_TARGET, CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_HANDOFF, CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_TETHERING_TARGET },
+    { CONTINUITY_TYPE_AIRDROP }
+};
+static const uint8_t watch_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_MAGIC_SWITCH },
+    { CONTINUITY_TYPE_NEARBY_INFO },
+    { CONTINUITY_TYPE_HEY_SIRI }
+};
+static const uint8_t airpods_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_AIRPODS }
+};
+static const uint8_t tag_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_FINDMY }
+};
+static const uint8_t printer_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_AIRPRINT }
+};
+static const uint8_t homekit_combos[][MAX_COMBO] = {
+    { CONTINUITY_TYPE_HOMEKIT }
+};
+
+#define COMBOS(c)   c, sizeof(c) / sizeof((c)[0])
+
+/* Macs set the reserved Flags bits the dissector reads as macOS */
+static const profile_t profiles[] = {
+    { 40, BTLE_ADV_IND,         true,  0x1a, true,  COMBOS(phone_combos) },
+    { 10, BTLE_ADV_IND,         true,  0xda, false, COMBOS(mac_combos) },
+    { 10, BTLE_ADV_IND,         true,  0x1a, false, COMBOS(watch_combos) },
+    { 15, BTLE_ADV_NONCONN_IND, true,  -1,   false, COMBOS(airpods_combos) },
+    { 15, BTLE_ADV_NONCONN_IND, true,  -1,   false, COMBOS(tag_combos) },
+    {  5, BTLE_ADV_IND,         false, 0x06, false, COMBOS(printer_combos) },
+    {  5, BTLE_ADV_IND,         false, 0x06, false, COMBOS(homekit_combos) }
+};
+
+#define PROFILE_COUNT   (sizeof(profiles) / sizeof(profiles[0]))
+
+typedef struct {
+    uint64_t    next_us;            /* time of the next advert */
+    uint8_t     addr[6];
+    uint8_t     profile;
+    uint16_t    handoff_seq;
+} device_t;
+
+typedef struct {
+    int             format;
+    FILE           *out;
+    pcapng_writer_t pcapng;
+    synth_rng_t     rng;
+    uint64_t        interval_us;
+    uint8_t         types[MAX_TYPES];   /* -T, overrides the profiles */
+    size_t          type_count;
+    unsigned        max_tlvs;
+} gen_t;
+
+static void
+usage(FILE *out)
+{
+    fprintf(out,
+        "usage: continuity-gen [-f pcapng|hex|raw] [-o file] [-d devices] [-i interval_ms]\n"
+        "                      [-c adverts] [-t seconds] [-T types [-m max_tlvs]] [-s seed]\n"
+        "                      [-S start_epoch]\n"
+        "  -f format    pcapng (LINKTYPE_BLUETOOTH_LE_LL, default), hex (one manufacturer\n"
+        "               data value per line) or raw (1-byte length, then the value)\n"
+        "  -o file      output file (default stdout)\n"
+        "  -d devices   simulated devices (default 10)\n"
+        "  -i ms        advertising interval per device (default 100); advDelay of\n"
+        "               0-10 ms is added to every event\n"
+        "  -c adverts   stop after this many adverts (default 1000, 0 for no limit)\n"
+        "  -t seconds   stop after this much simulated time\n"
+        "  -T types     comma-separated message types to send instead of the device\n"
+        "               profiles, e.g. 12,16\n"
+        "  -m max_tlvs  with -T, up to this many TLVs per advert (default 1)\n"
+        "  -s seed      random seed (default 1)\n"
+        "  -S epoch     timestamp of the first advert (default now)\n");
+}
+
+/* Min-heap of devices on next_us */
+
+static void
+heap_sift_down(device_t **heap, size_t n, size_t i)
+{
+    for (;;) {
+        size_t      l = 2 * i + 1;
+        size_t      m = i;
+        device_t   *tmp;
+
+        if (l < n && heap[l]->next_us < heap[m]->next_us)
+            m = l;
+        if (l + 1 < n && heap[l + 1]->next_us < heap[m]->next_us)
+            m = l + 1;
+        if (m == i)
+            return;
+        tmp = heap[i];
+        heap[i] = heap[m];
+        heap[m] = tmp;
+        i = m;
+    }
+}
+
+static void
+heap_build(device_t **heap, size_t n)
+{
+    size_t  i;
+
+    for (i = n / 2; i-- > 0;)
+        heap_sift_down(heap, n, i);
+}
+
+static int
+parse_types(const char *arg, gen_t *gen)
+{
+    char   *end;
+
+    gen->type_count = 0;
+    while (*arg) {
+        unsigned long   type = strtoul(arg, &end, 0);
+        size_t          t;
+
+        if (end == arg)
+            return -1;
+        for (t = 0; t < SYNTH_TYPE_COUNT; t++)
+            if (synth_types[t] == type)
+                break;
+        if (t == SYNTH_TYPE_COUNT) {
+            fprintf(stderr, "continuity-gen: no generator for message type %lu\n", type);
+            return -1;
+        }
+        if (gen->type_count == MAX_TYPES)
+            return -1;
+        gen->types[gen->type_count++] = (uint8_t)type;
+        arg = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return -1;
+    }
+
+    return gen->type_count ? 0 : -1;
+}
+
+static bool
+parse_uint(const char *s, uint64_t max, uint64_t *out)
+{
+    char               *end;
+    unsigned long long  v;
+
+    /* strtoull() would take "-1" as UINT64_MAX */
+    if (*s < '0' || *s > '9')
+        return false;
+    errno = 0;
+    v = strtoull(s, &end, 10);
+    if (errno || *end != '\0' || v > max)
+        return false;
+    *out = v;
+
+    return true;
+}
+
+/* A positive number of seconds or milliseconds, scaled to microseconds */
+static bool
+parse_us(const char *s, double scale, double max, uint64_t *out)
+{
+    char   *end;
+    double  v;
+
+    errno = 0;
+    v = strtod(s, &end);
+    if (errno || end == s || *end != '\0' || !(v > 0) || v > max || v * scale < 1)
+        return false;
+    *out = (uint64_t)(v * scale);
+
+    return true;
+}
+
+/* Keep each device's Handoff sequence number counting up */
+static void
+stamp_handoff(device_t *dev, uint8_t *payload, size_t len)
+{
+    size_t  offset = 0;
+
+    while (offset + 2 <= len) {
+        uint8_t tlv_len = payload[offset + 1];
+
+        if (payload[offset] == CONTINUITY_TYPE_HANDOFF && tlv_len >= 3) {
+            payload[offset + 3] = (uint8_t)dev->handoff_seq;
+            payload[offset + 4] = (uint8_t)(dev->handoff_seq >> 8);
+            dev->handoff_seq++;
+        }
+        offset += 2 + (size_t)tlv_len;
+    }
+}
+
+/* Build one advert's AD structures; returns their length and sets
+ * mfr_offset to the manufacturer data value, which always comes last */
+static size_t
+build_ad(gen_t *gen, device_t *dev, uint8_t *ad, size_t *mfr_offset)
+{
+    const profile_t    *profile = &profiles[dev->profile];
+    uint8_t             types[MAX_COMBO];
+    uint8_t             payload[PAYLOAD_MAX];
+    size_t              type_count = 0;
+    size_t              payload_len;
+    size_t              ad_len = 0;
+
+    if (gen->type_count) {
+        size_t  n = 1 + synth_next(&gen->rng) % gen->max_tlvs;
+
+        for (type_count = 0; type_count < n; type_count++)
+            types[type_count] = gen->types[synth_next(&gen->rng) % gen->type_count];
+    } else {
+        const uint8_t *combo = profile->combos[synth_next(&gen->rng) % profile->combo_count];
+
+        for (type_count = 0; type_count < MAX_COMBO && combo[type_count]; type_count++)
+            types[type_count] = combo[type_count];
+    }
+
+    payload_len = synth_payload(types, type_count, &gen->rng, payload, sizeof(payload));
+    stamp_handoff(dev, payload, payload_len);
+
+    /* Flags and Tx Power only go in when the Apple data leaves room */
+    if (profile->flags >= 0 && ad_len + 3 + MFR_HEADER_LEN + payload_len <= BTLE_LEGACY_AD_MAX) {
+        ad[ad_len++] = 2;
+        ad[ad_len++] = BTLE_AD_FLAGS;
+        ad[ad_len++] = (uint8_t)profile->flags;
+    }
+    if (profile->tx_power && (synth_next(&gen->rng) & 1) &&
+            ad_len + 3 + MFR_HEADER_LEN + payload_len <= BTLE_LEGACY_AD_MAX) {
+        ad[ad_len++] = 2;
+        ad[ad_len++] = BTLE_AD_TX_POWER;
+        ad[ad_len++] = 0x0c;
+    }
+
+    *mfr_offset = ad_len + 2;
+    ad[ad_len++] = (uint8_t)(3 + payload_len);
+    ad[ad_len++] = BTLE_AD_MANUFACTURER;
+    ad[ad_len++] = (uint8_t)CONTINUITY_COMPANY_ID;
+    ad[ad_len++] = (uint8_t)(CONTINUITY_COMPANY_ID >> 8);
+    memcpy(ad + ad_len, payload, payload_len);
+
+    return ad_len + payload_len;
+}
+
+static int
+emit(gen_t *gen, device_t *dev, uint64_t ts_usec)
+{
+    const profile_t    *profile = &profiles[dev->profile];
+    uint8_t             ad[BTLE_LEGACY_AD_MAX];
+    uint8_t             pkt[BTLE_LEGACY_PACKET_MAX];
+    size_t              mfr_offset;
+    size_t              ad_len = build_ad(gen, dev, ad, &mfr_offset);
+    size_t              len;
+
+    if (gen->format == FORMAT_PCAPNG) {
+        len = btle_build_adv(pkt, profile->pdu_type, profile->random_addr, dev->addr, ad, ad_len);
+        return pcapng_write(&gen->pcapng, ts_usec, pkt, (uint32_t)len, (uint32_t)len);
+    }
+
+    len = ad_len - mfr_offset;
+
+    if (gen->format == FORMAT_RAW) {
+        uint8_t prefix = (uint8_t)len;
+
+        if (fwrite(&prefix, 1, 1, gen->out) != 1 || fwrite(ad + mfr_offset, 1, len, gen->out) != len)
+            return -1;
+        return 0;
+    }
+
+    {
+        char    hex[2 * BTLE_LEGACY_AD_MAX + 1];
+
+        continuity_hex_encode(ad + mfr_offset, len, hex);
+        return fprintf(gen->out, "%s\n", hex) < 0 ? -1 : 0;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    gen_t       gen;
+    device_t   *devices;
+    device_t  **heap;
+    const char *path = NULL;
+    size_t      device_count = 10;
+    uint64_t    max_adverts = 1000;
+    uint64_t    duration_us = 0;
+    uint64_t    start_us;
+    uint64_t    seed = 1;
+    uint64_t    adverts = 0;
+    uint64_t    v;
+    unsigned    total_weight = 0;
+    size_t      i;
+    int         opt;
+    int         ret = 0;
+
+    memset(&gen, 0, sizeof(gen));
+    gen.format      = FORMAT_PCAPNG;
+    gen.interval_us = 100000;
+    gen.max_tlvs    = 1;
+    start_us        = (uint64_t)time(NULL) * 1000000u;
+
+    while ((opt = getopt(argc, argv, "c:d:f:hi:m:o:S:s:T:t:")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (!parse_uint(optarg, UINT64_MAX, &max_adverts)) {
+                fprintf(stderr, "continuity-gen: bad -c count '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+            if (!parse_uint(optarg, MAX_DEVICES, &v) || v == 0) {
+                fprintf(stderr, "continuity-gen: -d takes 1 to %d devices\n", MAX_DEVICES);
+                return 1;
+            }
+            device_count = (size_t)v;
+            break;
+        case 'f':
+            if (strcmp(optarg, "pcapng") == 0)
+                gen.format = FORMAT_PCAPNG;
+            else if (strcmp(optarg, "hex") == 0)
+                gen.format = FORMAT_HEX;
+            else if (strcmp(optarg, "raw") == 0)
+                gen.format = FORMAT_RAW;
+            else {
+                usage(stderr);
+                return 1;
+            }
+            break;
+        case 'i':
+            if (!parse_us(optarg, 1000.0, 3600 * 1000, &gen.interval_us)) {
+                fprintf(stderr, "continuity-gen: bad -i interval '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm':
+            if (!parse_uint(optarg, MAX_COMBO, &v) || v == 0) {
+                fprintf(stderr, "continuity-gen: -m takes 1 to %d TLVs\n", MAX_COMBO);
+                return 1;
+            }
+            gen.max_tlvs = (unsigned)v;
+            break;
+        case 'o':
+            path = optarg;
+            break;
+        case 'S':
+            if (!parse_uint(optarg, UINT64_MAX / 1000000u, &v)) {
+                fprintf(stderr, "continuity-gen: bad -S epoch '%s'\n", optarg);
+                return 1;
+            }
+            start_us = v * 1000000u;
+            break;
+        case 's':
+            if (!parse_uint(optarg, UINT64_MAX, &seed)) {
+                fprintf(stderr, "continuity-gen: bad -s seed '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'T':
+            if (parse_types(optarg, &gen) < 0) {
+                usage(stderr);
+                return 1;
+            }
+            break;
+        case 't':
+            if (!parse_us(optarg, 1000000.0, 1e9, &duration_us)) {
+                fprintf(stderr, "continuity-gen: bad -t duration '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind != argc) {
+        usage(stderr);
+        return 1;
+    }
+    if (max_adverts == 0 && duration_us == 0) {
+        fprintf(stderr, "continuity-gen: -c 0 needs -t\n");
+        return 1;
+    }
+
+    gen.out = path ? fopen(path, "wb") : stdout;
+    if (!gen.out) {
+        fprintf(stderr, "continuity-gen: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (gen.format == FORMAT_PCAPNG &&
+            pcapng_open(&gen.pcapng, gen.out, LINKTYPE_BLUETOOTH_LE_LL, BTLE_LEGACY_PACKET_MAX) < 0) {
+        fprintf(stderr, "continuity-gen: write error\n");
+        return 1;
+    }
+
+    devices = calloc(device_count, sizeof(*devices));
+    heap = calloc(device_count, sizeof(*heap));
+    if (!devices || !heap) {
+        fprintf(stderr, "continuity-gen: out of memory\n");
+        return 1;
+    }
+
+    /* One device of each profile first, so small runs still cover every
+     * type, then the rest by weight.  Start times are spread over one
+     * interval. */
+    synth_seed(&gen.rng, seed);
+    for (i = 0; i < PROFILE_COUNT; i++)
+        total_weight += profiles[i].weight;
+    for (i = 0; i < device_count; i++) {
+        device_t   *dev = &devices[i];
+
+        if (i < PROFILE_COUNT) {
+            dev->profile = (uint8_t)i;
+        } else {
+            unsigned    r = synth_next(&gen.rng) % total_weight;
+
+            for (dev->profile = 0; r >= profiles[dev->profile].weight; dev->profile++)
+                r -= profiles[dev->profile].weight;
+        }
+        synth_addr(&gen.rng, dev->addr);
+        dev->handoff_seq = (uint16_t)synth_next(&gen.rng);
+        dev->next_us = start_us + synth_next(&gen.rng) % gen.interval_us;
+        heap[i] = dev;
+    }
+    heap_build(heap, device_count);
+
+    while (max_adverts == 0 || adverts < max_adverts) {
+        device_t   *dev = heap[0];
+
+        if (duration_us && dev->next_us - start_us >= duration_us)
+            break;
+        if (emit(&gen, dev, dev->next_us) < 0) {
+            fprintf(stderr, "continuity-gen: write error\n");
+            ret = 1;
+            break;
+        }
+        adverts++;
+
+        dev->next_us += gen.interval_us + synth_next(&gen.rng) % (ADV_DELAY_MAX_US + 1);
+        heap_sift_down(heap, device_count, 0);
+    }
+
+    if (fflush(gen.out) != 0)
+        ret = 1;
+    if (path)
+        fclose(gen.out);
+    free(heap);
+    free(devices);
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
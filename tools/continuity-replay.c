@@ -0,0 +1,565 @@
+/* continuity-replay.c
+ * Replay a capture into a FIFO at a ramping rate and find where it backs up
+ *
+ * Stands in for ubertooth-btle -q: writes a pcap stream into the FIFO the
+ * decode pipeline reads, at a fixed number of adverts per second that is
+ * raised step by step.  The FIFO is written non-blocking, the way a sniffer
+ * with a full USB buffer behaves, so a write that would block is counted
+ * as dropped frames.  Each step reports the send rate, drops, the FIFO
+ * backlog and, when the reader is continuity-capd -L, its decode lag; the
+ * knee is the last step with no drops and lag under the threshold.
+ *
+ * Packets are stamped with the wall-clock time they are due, so the reader
+ * can measure its lag from the packet timestamps.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capfile.h"
+
+#define PCAP_MAGIC_NS       0xa1b23c4d
+#define PCAP_RECORD_LEN     16
+#define SNAPLEN             65535
+#define NS_PER_SEC          1000000000ULL
+
+#define DEFAULT_START_RATE  1000
+#define DEFAULT_MAX_RATE    1000000
+#define DEFAULT_STEP_SECS   5
+#define DEFAULT_LAG_MS      100
+
+/* How often the stats file is read during a step */
+#define STATS_POLL_NS       (NS_PER_SEC / 4)
+
+/* Writes up to PIPE_BUF bytes to a pipe are atomic: all or nothing */
+#define BATCH_LEN           PIPE_BUF
+
+typedef struct {
+    const uint8_t  *data;
+    uint32_t        caplen;
+    uint32_t        origlen;
+} replay_packet_t;
+
+typedef struct {
+    double      rate;               /* target, adverts/s */
+    double      elapsed;            /* seconds */
+    uint64_t    offered;            /* packets due in the step */
+    uint64_t    sent;
+    uint64_t    dropped;
+    uint64_t    bytes;
+    uint64_t    backlog_max;        /* bytes queued in the FIFO */
+    bool        has_consumer;
+    uint64_t    consumer_packets;   /* decoded by the reader during the step */
+    uint64_t    consumer_lag_us;    /* worst decode lag it reported */
+    bool        ok;
+} step_t;
+
+/* One read of a continuity-capd stats file */
+typedef struct {
+    uint64_t        packets;
+    uint64_t        lag_us;         /* lag.max_us: worst since the last write */
+    bool            has_lag;
+    struct timespec mtime;
+} consumer_t;
+
+typedef struct {
+    /* options */
+    double          start_rate;
+    double          max_rate;
+    double          step_add;       /* -s */
+    double          step_mul;       /* -x, 0 for additive steps */
+    double          step_secs;
+    double          lag_ms;
+    bool            blocking;
+    bool            keep_going;
+    const char     *stats_path;
+    /* input */
+    replay_packet_t *packets;
+    size_t          packet_count;
+    size_t          next;
+    uint32_t        linktype;
+    /* output */
+    int             fd;
+    const char     *path;
+    uint64_t        rt_offset;      /* CLOCK_REALTIME minus CLOCK_MONOTONIC */
+    bool            reader_gone;
+} replay_t;
+
+static volatile sig_atomic_t stop_requested;
+
+static void
+on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void
+usage(FILE *out)
+{
+    fprintf(out,
+        "usage: continuity-replay [-r rate] [-R rate] [-s step | -x factor] [-d seconds]\n"
+        "                         [-t ms] [-S stats] [-b] [-k] capture output\n"
+        "  capture      pcap or pcapng file to replay, looped as needed\n"
+        "  output       FIFO (or pipe) the decode pipeline reads; - for stdout\n"
+        "  -r rate      first step, adverts per second (default %d)\n"
+        "  -R rate      last step (default %d)\n"
+        "  -s step      add this much to the rate each step (default: the first rate)\n"
+        "  -x factor    multiply the rate by this each step instead\n"
+        "  -d seconds   length of each step (default %d)\n"
+        "  -t ms        lag above this marks a step as not sustained (default %d)\n"
+        "  -S stats     continuity-capd stats file to read the decode lag from; run\n"
+        "               the daemon with -L and -i 1\n"
+        "  -b           block when the FIFO is full instead of dropping\n"
+        "  -k           keep ramping after the first step that is not sustained\n",
+        DEFAULT_START_RATE, DEFAULT_MAX_RATE, DEFAULT_STEP_SECS, DEFAULT_LAG_MS);
+}
+
+static uint64_t
+clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static void
+sleep_until(uint64_t mono_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec  = (time_t)(mono_ns / NS_PER_SEC);
+    ts.tv_nsec = (long)(mono_ns % NS_PER_SEC);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int
+load(replay_t *r, capfile_t *cf, const char *path)
+{
+    capfile_packet_t    pkt;
+    size_t              capacity = 0;
+    int                 ret;
+
+    if (capfile_open(cf, path) < 0) {
+        fprintf(stderr, "continuity-replay: %s: %s\n", path, cf->error);
+        return -1;
+    }
+
+    while ((ret = capfile_next(cf, &pkt)) > 0) {
+        if (r->packet_count == 0)
+            r->linktype = pkt.linktype;
+        if (pkt.linktype != r->linktype || pkt.caplen > BATCH_LEN - PCAP_RECORD_LEN)
+            continue;
+        if (r->packet_count == capacity) {
+            size_t  grown_capacity = capacity ? 2 * capacity : 4096;
+            void   *grown = realloc(r->packets, grown_capacity * sizeof(*r->packets));
+
+            if (!grown) {
+                fprintf(stderr, "continuity-replay: out of memory\n");
+                return -1;
+            }
+            r->packets = grown;
+            capacity   = grown_capacity;
+        }
+        r->packets[r->packet_count].data    = pkt.data;
+        r->packets[r->packet_count].caplen  = pkt.caplen;
+        r->packets[r->packet_count].origlen = pkt.origlen;
+        r->packet_count++;
+    }
+    if (ret < 0)
+        fprintf(stderr, "continuity-replay: %s: %s; replaying the packets before it\n",
+                path, cf->error);
+    if (r->packet_count == 0) {
+        fprintf(stderr, "continuity-replay: %s: no packets\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+open_output(replay_t *r)
+{
+    static const uint16_t version[2] = { 2, 4 };
+    uint32_t    hdr[6];
+    size_t      off = 0;
+
+    if (strcmp(r->path, "-") == 0) {
+        /* Keep the capture on its own descriptor; stdout takes the report */
+        r->fd = dup(STDOUT_FILENO);
+        if (r->fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            perror("continuity-replay: dup");
+            return -1;
+        }
+    } else {
+        /* Opening a FIFO blocks until the pipeline opens the other end */
+        r->fd = open(r->path, O_WRONLY);
+        if (r->fd < 0) {
+            fprintf(stderr, "continuity-replay: %s: %s\n", r->path, strerror(errno));
+            return -1;
+        }
+    }
+
+    hdr[0] = PCAP_MAGIC_NS;
+    memcpy(&hdr[1], version, sizeof(version));
+    hdr[2] = 0;
+    hdr[3] = 0;
+    hdr[4] = SNAPLEN;
+    hdr[5] = r->linktype;
+    while (off < sizeof(hdr)) {
+        ssize_t n = write(r->fd, (const uint8_t *)hdr + off, sizeof(hdr) - off);
+
+        if (n < 0 && errno != EINTR) {
+            fprintf(stderr, "continuity-replay: %s: %s\n", r->path, strerror(errno));
+            return -1;
+        }
+        off += n > 0 ? (size_t)n : 0;
+    }
+
+    if (!r->blocking)
+        fcntl(r->fd, F_SETFL, fcntl(r->fd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+/* Write a batch of whole records.  Returns the bytes written, 0 if the
+ * FIFO was full, or -1 if the reader has gone. */
+static ssize_t
+write_batch(replay_t *r, const uint8_t *buf, size_t len)
+{
+    size_t  off = 0;
+
+    while (off < len) {
+        ssize_t n = write(r->fd, buf + off, len - off);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN && off == 0)
+                return 0;
+            if (errno == EAGAIN)
+                continue;   /* not a pipe, so the write was not atomic */
+            if (errno != EPIPE)
+                fprintf(stderr, "continuity-replay: %s: %s\n", r->path, strerror(errno));
+            r->reader_gone = true;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+
+    return (ssize_t)len;
+}
+
+static uint64_t
+backlog(const replay_t *r)
+{
+    int queued = 0;
+
+#ifdef FIONREAD
+    if (ioctl(r->fd, FIONREAD, &queued) < 0)
+        queued = 0;
+#else
+    (void)r;
+#endif
+
+    return queued > 0 ? (uint64_t)queued : 0;
+}
+
+/* Read "name value" lines from a continuity-capd stats file.  Returns
+ * false if it can't be opened. */
+static bool
+read_consumer(const char *path, consumer_t *c)
+{
+    char        line[256];
+    struct stat sb;
+    FILE       *f = fopen(path, "r");
+
+    memset(c, 0, sizeof(*c));
+    if (!f)
+        return false;
+    if (fstat(fileno(f), &sb) == 0)
+        c->mtime = sb.st_mtim;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long  v;
+
+        if (sscanf(line, "packets %llu", &v) == 1) {
+            c->packets = v;
+        } else if (sscanf(line, "lag.max_us %llu", &v) == 1) {
+            c->lag_us  = v;
+            c->has_lag = true;
+        }
+    }
+    fclose(f);
+
+    return true;
+}
+
+/* Fold the stats file into the step.  The daemon resets lag.max_us each
+ * time it writes the file, so the step's worst lag is the largest of the
+ * writes made since it began; the one already there at the start belongs
+ * to the step before. */
+static void
+poll_consumer(const replay_t *r, step_t *st, const consumer_t *start)
+{
+    consumer_t  c;
+
+    if (!read_consumer(r->stats_path, &c) || !c.has_lag)
+        return;
+    st->has_consumer = true;
+    st->consumer_packets = c.packets > start->packets ? c.packets - start->packets : 0;
+    if (c.mtime.tv_sec == start->mtime.tv_sec && c.mtime.tv_nsec == start->mtime.tv_nsec)
+        return;
+    if (c.lag_us > st->consumer_lag_us)
+        st->consumer_lag_us = c.lag_us;
+}
+
+static void
+run_step(replay_t *r, step_t *st)
+{
+    uint8_t     batch[BATCH_LEN];
+    uint64_t    start = clock_ns(CLOCK_MONOTONIC);
+    uint64_t    interval = (uint64_t)((double)NS_PER_SEC / st->rate);
+    uint64_t    total = (uint64_t)(st->rate * r->step_secs);
+    uint64_t    done = 0;
+    uint64_t    next_poll = start + STATS_POLL_NS;
+    consumer_t  consumer_start;
+
+    if (r->stats_path)
+        read_consumer(r->stats_path, &consumer_start);
+
+    while (done < total && !stop_requested && !r->reader_gone) {
+        uint64_t    now = clock_ns(CLOCK_MONOTONIC);
+        uint64_t    due = (now - start) / interval + 1;
+        uint64_t    queued;
+        size_t      len = 0;
+        uint64_t    count = 0;
+        ssize_t     n;
+
+        if (r->stats_path && now >= next_poll) {
+            poll_consumer(r, st, &consumer_start);
+            next_poll = now + STATS_POLL_NS;
+        }
+        if (due > total)
+            due = total;
+        if (due <= done) {
+            uint64_t    wake = start + done * interval;
+
+            sleep_until(r->stats_path && next_poll < wake ? next_poll : wake);
+            continue;
+        }
+
+        /* Every packet already due goes into the batch, as far as it fits */
+        while (done + count < due) {
+            const replay_packet_t  *p = &r->packets[r->next];
+            uint64_t                ts = start + (done + count) * interval + r->rt_offset;
+            uint32_t                rec[4];
+
+            if (len + PCAP_RECORD_LEN + p->caplen > sizeof(batch))
+                break;
+            rec[0] = (uint32_t)(ts / NS_PER_SEC);
+            rec[1] = (uint32_t)(ts % NS_PER_SEC);
+            rec[2] = p->caplen;
+            rec[3] = p->origlen;
+            memcpy(batch + len, rec, sizeof(rec));
+            memcpy(batch + len + PCAP_RECORD_LEN, p->data, p->caplen);
+            len += PCAP_RECORD_LEN + p->caplen;
+            count++;
+            if (++r->next == r->packet_count)
+                r->next = 0;
+        }
+
+        n = write_batch(r, batch, len);
+        if (n < 0)
+            break;
+        if (n == 0) {
+            st->dropped += count;
+        } else {
+            st->sent  += count;
+            st->bytes += len;
+        }
+        done += count;
+
+        queued = backlog(r);
+        if (queued > st->backlog_max)
+            st->backlog_max = queued;
+    }
+
+    st->offered = done;
+    st->elapsed = (double)(clock_ns(CLOCK_MONOTONIC) - start) / 1e9;
+
+    if (r->stats_path)
+        poll_consumer(r, st, &consumer_start);
+}
+
+static void
+report_step(const replay_t *r, step_t *st)
+{
+    double  record = st->sent ? (double)st->bytes / (double)st->sent : 0;
+    double  backlog_ms = record > 0 ? (double)st->backlog_max / record / st->rate * 1e3 : 0;
+
+    st->ok = st->dropped == 0 && backlog_ms <= r->lag_ms &&
+        (!st->has_consumer || (double)st->consumer_lag_us / 1e3 <= r->lag_ms);
+
+    printf("%10.0f %10.0f %9" PRIu64 " %6.2f %10.1f %10.1f", st->rate,
+            st->elapsed > 0 ? (double)st->sent / st->elapsed : 0.0, st->dropped,
+            st->offered ? 100.0 * (double)st->dropped / (double)st->offered : 0.0,
+            (double)st->backlog_max / 1024, backlog_ms);
+    if (st->has_consumer)
+        printf(" %10.0f %10.1f", st->elapsed > 0 ? (double)st->consumer_packets / st->elapsed : 0.0,
+                (double)st->consumer_lag_us / 1e3);
+    else if (r->stats_path)
+        printf(" %10s %10s", "-", "-");
+    printf("  %s\n", st->ok ? "ok" : "NOT SUSTAINED");
+    fflush(stdout);
+}
+
+static bool
+parse_rate(const char *s, double *out)
+{
+    char   *end;
+    double  v = strtod(s, &end);
+
+    if (end == s || *end != '\0' || !(v > 0) || v > 1e9)
+        return false;
+    *out = v;
+
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    replay_t    r;
+    capfile_t   cf;
+    step_t      st;
+    double      rate;
+    double      knee = 0;
+    double      first_bad = 0;
+    int         opt;
+
+    memset(&r, 0, sizeof(r));
+    r.start_rate = DEFAULT_START_RATE;
+    r.max_rate   = DEFAULT_MAX_RATE;
+    r.step_secs  = DEFAULT_STEP_SECS;
+    r.lag_ms     = DEFAULT_LAG_MS;
+
+    while ((opt = getopt(argc, argv, "R:S:bd:hkr:s:t:x:")) != -1) {
+        double  *target = NULL;
+
+        switch (opt) {
+        case 'R': target = &r.max_rate; break;
+        case 'd': target = &r.step_secs; break;
+        case 'r': target = &r.start_rate; break;
+        case 's': target = &r.step_add; break;
+        case 't': target = &r.lag_ms; break;
+        case 'x': target = &r.step_mul; break;
+        case 'S':
+            r.stats_path = optarg;
+            break;
+        case 'b':
+            r.blocking = true;
+            break;
+        case 'k':
+            r.keep_going = true;
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+        if (target && !parse_rate(optarg, target)) {
+            fprintf(stderr, "continuity-replay: bad -%c value '%s'\n", opt, optarg);
+            return 1;
+        }
+    }
+    if (argc - optind != 2 || (r.step_mul != 0 && r.step_mul <= 1.0)) {
+        usage(stderr);
+        return 1;
+    }
+    if (r.step_add == 0)
+        r.step_add = r.start_rate;
+    r.path = argv[optind + 1];
+
+    if (load(&r, &cf, argv[optind]) < 0)
+        return 1;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (open_output(&r) < 0)
+        return 1;
+    r.rt_offset = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+
+    printf("%10s %10s %9s %6s %10s %10s", "rate/s", "sent/s", "dropped", "drop%",
+            "fifo KB", "fifo ms");
+    if (r.stats_path)
+        printf(" %10s %10s", "decoded/s", "lag ms");
+    putchar('\n');
+
+    for (rate = r.start_rate; rate <= r.max_rate * (1 + 1e-9) && !stop_requested;
+            rate = r.step_mul ? rate * r.step_mul : rate + r.step_add) {
+        memset(&st, 0, sizeof(st));
+        st.rate = rate;
+        run_step(&r, &st);
+        if (r.reader_gone) {
+            fprintf(stderr, "continuity-replay: %s: reader closed the FIFO\n", r.path);
+            break;
+        }
+        report_step(&r, &st);
+        if (st.ok && first_bad == 0) {
+            knee = rate;
+        } else if (!st.ok && first_bad == 0) {
+            first_bad = rate;
+            if (!r.keep_going)
+                break;
+        }
+    }
+
+    /* With the reader gone mid-ramp there is no knee to report */
+    if (!r.reader_gone) {
+        if (first_bad == 0)
+            printf("sustained every step up to %.0f adverts/s\n", knee);
+        else if (knee == 0)
+            printf("not sustained even at %.0f adverts/s\n", first_bad);
+        else
+            printf("knee: %.0f adverts/s sustained, %.0f adverts/s not\n", knee, first_bad);
+    }
+
+    close(r.fd);
+    free(r.packets);
+    capfile_close(&cf);
+
+    return r.reader_gone ? 1 : 0;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,2162 @@
+/* continuity-scan.c
+ * Decode Apple Continuity adverts from pcap and pcapng files without epan
+ *
+ * Memory-maps each capture, walks the BLE link-layer advertising PDUs
+ * (LINKTYPE_BLUETOOTH_LE_LL and LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR) to their
+ * AD structures, and runs the Apple manufacturer data through libcontinuity.
+ * HCI logs (H4 pcaps, btsnoop and PacketLogger) give up the advertising
+ * data their host set through the LE advertising data commands.
+ * Output uses the dissector's btcommon.apple.* field names, either as one
+ * record line per advert or, with -e, as tshark -T fields style columns.
+ *
+ * With -j a pcapng file is cut into chunks at block boundaries, found by
+ * resynchronising on the block lengths, and the chunks are decoded on
+ * several threads.  Each chunk's output is buffered with its frame numbers
+ * left open, and the chunks are printed in file order once the frames
+ * before them have been counted.  Decoding an advert needs nothing from
+ * earlier frames, so chunks are independent unless a new section,
+ * interface or HCI advertising state turns up; the rest of the file is
+ * then read on the main thread, carrying that state over.
+ *
+ * -X writes a sidecar index of each file (capindex.h), which a later run
+ * with -f filters uses to read only the frames that can match.
+ *
+ * -t writes each device's Nearby Info states as run-length intervals, and
+ * -a its AirPods battery levels as the samples where they changed
+ * (continuity_timeline.h).  -k reports each HomeKit accessory's state
+ * changes (continuity_homekit.h).
+ *
+ * With -o the files are scanned side by side into per-file outputs and a
+ * summary, files and chunks alike being tasks the threads steal from each
+ * other (see scan_batch()).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btle.h"
+#include "capfile.h"
+#include "capindex.h"
+#include "continuity.h"
+#include "continuity_fields.h"
+#include "continuity_homekit.h"
+#include "continuity_timeline.h"
+#include "deque.h"
+#include "hci.h"
+
+#define MAX_COLUMNS         64
+#define COLUMN_LEN          1024
+#define LINE_LEN            4096
+#define VALUE_LEN           (2 * 255 + 1)
+
+#define MAX_FILTERS         16
+#define MAX_THREADS         256
+#define CHUNK_BYTES         (4u << 20)
+/* Chunks decoded or waiting to be printed at once, per thread */
+#define CHUNKS_PER_THREAD   2
+/* How long a thread waiting on another sleeps before looking again */
+#define IDLE_SLEEP_NS       100000
+
+/* Pseudo-fields that come from the frame rather than the Apple data */
+#define FIELD_FRAME_NUMBER  "frame.number"
+#define FIELD_FRAME_TIME    "frame.time_epoch"
+#define FIELD_ADV_ADDRESS   "btle.advertising_address"
+
+/* Apple fields -f can select on, which the index has keys for */
+#define FIELD_TYPE          "btcommon.apple.type"
+#define FIELD_NEARBY_ACTION "btcommon.apple.nearbyaction.type"
+#define FIELD_NEARBY_INFO   "btcommon.apple.nearbyinfo.action_code"
+
+typedef struct {
+    const char *name;
+    char        value[COLUMN_LEN];
+    size_t      len;
+} column_t;
+
+/* -f: an advert matches when it has this key, or for CAPINDEX_BUCKET
+ * when its time is in [from_ns, to_ns) */
+typedef struct {
+    int         kind;           /* CAPINDEX_* */
+    uint64_t    value;          /* addresses as a 48-bit number */
+    uint64_t    from_ns;
+    uint64_t    to_ns;
+} filter_t;
+
+/* A frame number to print at pos in a chunk's buffered output */
+typedef struct {
+    size_t      pos;
+    uint64_t    frame;          /* within the chunk */
+} frame_ref_t;
+
+typedef struct {
+    /* options */
+    column_t   *columns;
+    size_t      column_count;
+    bool        quiet;
+    bool        verbose;
+    unsigned    threads;        /* -j */
+    filter_t   *filters;        /* -f */
+    size_t      filter_count;
+    bool        write_index;    /* -X */
+    const char *file_prefix;    /* set when scanning more than one file */
+    hci_adv_state_t *hci;       /* reset for each file */
+    capindex_writer_t *index;   /* the file's index, while -X builds it */
+    continuity_timeline_t *timeline;    /* -t and -a, across all files */
+    continuity_homekit_tracker_t *homekit;  /* -k, across all files */
+    bool        track_oom;
+    /* record output */
+    char       *line;
+    size_t      line_len;
+    FILE       *out;
+    /* -j: output held until the chunk's first frame number is known */
+    bool        buffered;
+    char       *buf;
+    size_t      buf_len;
+    size_t      buf_cap;
+    frame_ref_t *refs;
+    size_t      ref_count;
+    size_t      ref_cap;
+    bool        oom;
+    /* totals */
+    uint64_t    packets;
+    uint64_t    adverts;
+    uint64_t    apple;
+    uint64_t    messages;
+    uint64_t    fields;
+    uint64_t    bytes;
+} scan_t;
+
+static void
+usage(FILE *out)
+{
+    fprintf(out,
+        "usage: continuity-scan [-q] [-v] [-X] [-j threads] [-o dir] [-t file] [-a file]\n"
+        "                       [-k file] [-e field]... [-f field=value]... file|dir...\n"
+        "  -a file      write each device's AirPods battery levels, charging bits and\n"
+        "               lid open count to file wherever they changed, as CSV, or as\n"
+        "               JSON if file ends in .json; not with -o\n"
+        "  -e field     print this field as a column, tshark -T fields style; repeat\n"
+        "               for more columns.  Any btcommon.apple.* name, plus\n"
+        "               " FIELD_FRAME_NUMBER ", " FIELD_FRAME_TIME " and " FIELD_ADV_ADDRESS "\n"
+        "  -f filter    only adverts that match; repeat to match them all.  One of\n"
+        "               " FIELD_TYPE "=N, " FIELD_NEARBY_ACTION "=N,\n"
+        "               " FIELD_NEARBY_INFO "=N, " FIELD_ADV_ADDRESS "=ADDR\n"
+        "               or " FIELD_FRAME_TIME "=FROM-TO (seconds, either may be left out)\n"
+        "  -j threads   decode each pcapng file on this many threads; 0 uses every\n"
+        "               core (default 1)\n"
+        "  -k file      write a report of each HomeKit accessory's state number and\n"
+        "               configuration changes to file, busiest first; not with -o\n"
+        "  -o dir       write each file's output to dir/<name>.txt and the per-file\n"
+        "               totals to dir/summary.txt, scanning files side by side on\n"
+        "               the -j threads\n"
+        "  -q           print only the totals\n"
+        "  -t file      write each device's Nearby Info action code and status flags\n"
+        "               to file as intervals of unchanged state; not with -o\n"
+        "  -X           write an index of each file to file" CAPINDEX_SUFFIX ", which later -f\n"
+        "               runs use to read only the frames that can match\n"
+        "  -v           print the totals and scan rate to stderr as well\n"
+        "A directory stands for the files in it.\n");
+}
+
+static size_t
+format_value(const continuity_field_t *f, char *out)
+{
+    switch (f->kind) {
+    case CONTINUITY_FIELD_UINT:
+    case CONTINUITY_FIELD_BOOL:
+        return (size_t)sprintf(out, "%" PRIu32, f->value);
+    case CONTINUITY_FIELD_BYTES:
+        continuity_hex_encode(f->bytes, f->length, out);
+        return 2u * f->length;
+    case CONTINUITY_FIELD_IPV4:
+        inet_ntop(AF_INET, f->bytes, out, VALUE_LEN);
+        return strlen(out);
+    case CONTINUITY_FIELD_IPV6:
+        inet_ntop(AF_INET6, f->bytes, out, VALUE_LEN);
+        return strlen(out);
+    case CONTINUITY_FIELD_STRING:
+        return (size_t)sprintf(out, "%.*s", VALUE_LEN - 1, f->str);
+    default:
+        out[0] = '\0';
+        return 0;
+    }
+}
+
+static void
+append(char *buf, size_t *len, size_t cap, const char *s, size_t n)
+{
+    if (*len + n >= cap)
+        n = *len < cap - 1 ? cap - 1 - *len : 0;
+    memcpy(buf + *len, s, n);
+    *len += n;
+    buf[*len] = '\0';
+}
+
+/* Record mode: name=value tokens, space separated */
+static void
+record_field(const continuity_field_t *f, void *user)
+{
+    scan_t *scan = user;
+    char    value[VALUE_LEN];
+    size_t  n;
+
+    if (f->kind == CONTINUITY_FIELD_NONE)
+        return;
+
+    n = format_value(f, value);
+    append(scan->line, &scan->line_len, LINE_LEN, " ", 1);
+    append(scan->line, &scan->line_len, LINE_LEN, f->name, strlen(f->name));
+    append(scan->line, &scan->line_len, LINE_LEN, "=", 1);
+    append(scan->line, &scan->line_len, LINE_LEN, value, n);
+}
+
+/* Column mode: repeated occurrences are joined with ',' */
+static void
+column_field(const continuity_field_t *f, void *user)
+{
+    scan_t *scan = user;
+    char    value[VALUE_LEN];
+    size_t  n = 0;
+    size_t  c;
+
+    if (f->kind == CONTINUITY_FIELD_NONE)
+        return;
+
+    for (c = 0; c < scan->column_count; c++) {
+        column_t   *col = &scan->columns[c];
+
+        if (strcmp(col->name, f->name) != 0)
+            continue;
+        if (n == 0)
+            n = format_value(f, value);
+        if (col->len)
+            append(col->value, &col->len, COLUMN_LEN, ",", 1);
+        append(col->value, &col->len, COLUMN_LEN, value, n);
+    }
+}
+
+static void
+format_addr(const uint8_t addr[6], char *out)
+{
+    sprintf(out, "%02x:%02x:%02x:%02x:%02x:%02x",
+            addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+}
+
+static void
+format_time(uint64_t ts_ns, char *out)
+{
+    sprintf(out, "%" PRIu64 ".%09" PRIu64, ts_ns / 1000000000u, ts_ns % 1000000000u);
+}
+
+static void
+out_write(scan_t *scan, const char *s, size_t n)
+{
+    if (!scan->buffered) {
+        fwrite(s, 1, n, scan->out);
+        return;
+    }
+    if (scan->buf_cap - scan->buf_len < n) {
+        size_t  cap = scan->buf_cap ? scan->buf_cap : 64 * 1024;
+        char   *buf;
+
+        while (cap - scan->buf_len < n)
+            cap *= 2;
+        if (!(buf = realloc(scan->buf, cap))) {
+            scan->oom = true;
+            return;
+        }
+        scan->buf     = buf;
+        scan->buf_cap = cap;
+    }
+    memcpy(scan->buf + scan->buf_len, s, n);
+    scan->buf_len += n;
+}
+
+static void
+out_str(scan_t *scan, const char *s)
+{
+    out_write(scan, s, strlen(s));
+}
+
+static void
+out_frame(scan_t *scan, uint64_t frame_number)
+{
+    if (!scan->buffered) {
+        fprintf(scan->out, "%" PRIu64, frame_number);
+        return;
+    }
+    if (scan->ref_count == scan->ref_cap) {
+        size_t          cap = scan->ref_cap ? 2 * scan->ref_cap : 1024;
+        frame_ref_t    *refs = realloc(scan->refs, cap * sizeof(*refs));
+
+        if (!refs) {
+            scan->oom = true;
+            return;
+        }
+        scan->refs    = refs;
+        scan->ref_cap = cap;
+    }
+    scan->refs[scan->ref_count].pos   = scan->buf_len;
+    scan->refs[scan->ref_count].frame = frame_number;
+    scan->ref_count++;
+}
+
+/* Print a chunk's buffered output to out, numbering its frames from base */
+static void
+out_print(const scan_t *scan, FILE *out, uint64_t base)
+{
+    size_t  pos = 0;
+    size_t  i;
+
+    for (i = 0; i < scan->ref_count; i++) {
+        fwrite(scan->buf + pos, 1, scan->refs[i].pos - pos, out);
+        fprintf(out, "%" PRIu64, base + scan->refs[i].frame);
+        pos = scan->refs[i].pos;
+    }
+    fwrite(scan->buf + pos, 1, scan->buf_len - pos, out);
+}
+
+static uint64_t
+addr48(const uint8_t addr[6])
+{
+    return (uint64_t)addr[0] << 40 | (uint64_t)addr[1] << 32 | (uint64_t)addr[2] << 24 |
+        (uint64_t)addr[3] << 16 | (uint64_t)addr[4] << 8 | addr[5];
+}
+
+/* The value msg has for a CAPINDEX_TYPE, CAPINDEX_NEARBY_ACTION or
+ * CAPINDEX_NEARBY_INFO key, if any */
+static bool
+msg_key(const continuity_msg_t *msg, int kind, uint8_t *value)
+{
+    switch (kind) {
+    case CAPINDEX_TYPE:
+        *value = msg->type;
+        return true;
+    case CAPINDEX_NEARBY_ACTION:
+        if (msg->type != CONTINUITY_TYPE_NEARBY_ACTION || msg->status == CONTINUITY_MSG_SHORT ||
+                msg->u.nearby_action.short_form)
+            return false;
+        *value = msg->u.nearby_action.type;
+        return true;
+    case CAPINDEX_NEARBY_INFO:
+        if (msg->type != CONTINUITY_TYPE_NEARBY_INFO || msg->status == CONTINUITY_MSG_SHORT)
+            return false;
+        *value = msg->u.nearby_info.action_code;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void
+index_advert(capindex_writer_t *w, uint64_t frame_number, const capfile_packet_t *pkt,
+        const btle_adv_t *adv, const continuity_frame_t *frame)
+{
+    unsigned    i;
+    int         kind;
+    uint8_t     value;
+
+    capindex_add(w, pkt->offset, frame_number, pkt->ts_ns, adv->addr);
+    for (i = 0; i < frame->count; i++)
+        for (kind = CAPINDEX_TYPE; kind <= CAPINDEX_NEARBY_INFO; kind++)
+            if (msg_key(&frame->msgs[i], kind, &value))
+                capindex_add_key(w, kind, value);
+}
+
+static bool
+match_filters(const scan_t *scan, const continuity_frame_t *frame, const capfile_packet_t *pkt,
+        const btle_adv_t *adv)
+{
+    size_t      i;
+    unsigned    m;
+    uint8_t     value;
+
+    for (i = 0; i < scan->filter_count; i++) {
+        const filter_t *f = &scan->filters[i];
+        bool            found = false;
+
+        switch (f->kind) {
+        case CAPINDEX_BUCKET:
+            found = pkt->ts_ns >= f->from_ns && pkt->ts_ns < f->to_ns;
+            break;
+        case CAPINDEX_ADDR:
+            found = addr48(adv->addr) == f->value;
+            break;
+        default:
+            for (m = 0; m < frame->count && !found; m++)
+                found = msg_key(&frame->msgs[m], f->kind, &value) && value == f->value;
+            break;
+        }
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
+static void
+scan_advert(scan_t *scan, uint64_t frame_number, const capfile_packet_t *pkt,
+        const btle_adv_t *adv)
+{
+    continuity_frame_t  frame;
+    continuity_ad_ctx_t ctx;
+    const uint8_t      *payload;
+    size_t              payload_len;
+    char                addr[18];
+    char                ts[32];
+    size_t              c;
+
+    if (!continuity_ad_payload(adv->ad, adv->ad_len, &payload, &payload_len, &ctx))
+        return;
+
+    continuity_decode(payload, payload_len, &frame);
+    continuity_infer_os(&frame, &ctx);
+    if (scan->index)
+        index_advert(scan->index, frame_number, pkt, adv, &frame);
+    if (scan->filter_count) {
+        /* Only matching adverts count */
+        if (!match_filters(scan, &frame, pkt, adv))
+            return;
+        scan->adverts++;
+    }
+    scan->apple++;
+    scan->messages += frame.count;
+    if (scan->timeline && !scan->track_oom &&
+            continuity_timeline_add_frame(scan->timeline, adv->addr, pkt->ts_ns, &frame) < 0)
+        scan->track_oom = true;
+    if (scan->homekit && !scan->track_oom &&
+            continuity_homekit_add_frame(scan->homekit, pkt->ts_ns, &frame) < 0)
+        scan->track_oom = true;
+
+    if (scan->quiet) {
+        scan->fields += continuity_foreach_field(payload, &frame, adv->addr, NULL, NULL);
+        return;
+    }
+
+    format_addr(adv->addr, addr);
+    format_time(pkt->ts_ns, ts);
+
+    if (scan->column_count == 0) {
+        scan->line_len = 0;
+        scan->line[0] = '\0';
+        scan->fields += continuity_foreach_field(payload, &frame, adv->addr, record_field, scan);
+        if (scan->file_prefix) {
+            out_str(scan, scan->file_prefix);
+            out_write(scan, "\t", 1);
+        }
+        out_frame(scan, frame_number);
+        out_write(scan, "\t", 1);
+        out_str(scan, ts);
+        out_write(scan, "\t", 1);
+        out_str(scan, addr);
+        out_write(scan, "\t", 1);
+        if (scan->line_len)
+            out_write(scan, scan->line + 1, scan->line_len - 1);
+        out_write(scan, "\n", 1);
+        return;
+    }
+
+    for (c = 0; c < scan->column_count; c++) {
+        column_t   *col = &scan->columns[c];
+
+        col->len = 0;
+        col->value[0] = '\0';
+        if (strcmp(col->name, FIELD_FRAME_TIME) == 0)
+            col->len = (size_t)sprintf(col->value, "%s", ts);
+        else if (strcmp(col->name, FIELD_ADV_ADDRESS) == 0)
+            col->len = (size_t)sprintf(col->value, "%s", addr);
+    }
+    scan->fields += continuity_foreach_field(payload, &frame, adv->addr, column_field, scan);
+
+    if (scan->file_prefix) {
+        out_str(scan, scan->file_prefix);
+        out_write(scan, "\t", 1);
+    }
+    for (c = 0; c < scan->column_count; c++) {
+        column_t   *col = &scan->columns[c];
+
+        if (c)
+            out_write(scan, "\t", 1);
+        if (strcmp(col->name, FIELD_FRAME_NUMBER) == 0)
+            out_frame(scan, frame_number);
+        else
+            out_write(scan, col->value, col->len);
+    }
+    out_write(scan, "\n", 1);
+}
+
+/* What scan_packets() read */
+typedef struct {
+    uint64_t    first;          /* offset of the first packet scanned, or end */
+    uint64_t    end;            /* offset of the first packet left unscanned */
+    uint64_t    frames;
+    bool        stateful;       /* read something later frames depend on */
+    int         ret;            /* 0 at the end of the file, -1 on an error */
+} scan_range_t;
+
+/* Scan from cf's position up to the first packet at or after limit,
+ * numbering frames from base + 1 */
+static void
+scan_packets(scan_t *scan, capfile_t *cf, uint64_t limit, uint64_t base, scan_range_t *r)
+{
+    capfile_packet_t    pkt;
+    uint64_t            state_blocks = cf->state_blocks;
+    uint64_t            seen_blocks = state_blocks;
+    uint64_t            section = CAPINDEX_NO_SECTION;
+
+    r->frames   = 0;
+    r->stateful = false;
+    r->end      = cf->size;
+    while ((r->ret = capfile_next(cf, &pkt)) > 0) {
+        btle_adv_t      adv;
+        hci_packet_t    hci;
+        bool            is_adv;
+
+        if (pkt.offset >= limit) {
+            r->end = pkt.offset;
+            r->ret = 1;
+            break;
+        }
+        if (r->frames++ == 0)
+            r->first = pkt.offset;
+        if (scan->index && cf->state_blocks != seen_blocks) {
+            /* A new section is a place to start reading again; new
+             * interfaces partway through one are not */
+            if (cf->section != section)
+                capindex_add_section(scan->index, cf->section);
+            else
+                scan->index->flags |= CAPINDEX_SEQUENTIAL;
+            seen_blocks = cf->state_blocks;
+            section     = cf->section;
+        }
+
+        is_adv = btle_parse_adv(pkt.linktype, pkt.data, pkt.caplen, &adv);
+        if (!is_adv && hci_packet(pkt.linktype, pkt.flags, pkt.data, pkt.caplen, &hci)) {
+            r->stateful = true;
+            if (scan->index)
+                scan->index->flags |= CAPINDEX_SEQUENTIAL;
+            is_adv = hci_adv_packet(scan->hci, &hci, &adv);
+        }
+        if (!is_adv)
+            continue;
+        if (!scan->filter_count)
+            scan->adverts++;
+        scan_advert(scan, base + r->frames, &pkt, &adv);
+    }
+    if (r->frames == 0)
+        r->first = r->end;
+    if (cf->state_blocks != state_blocks)
+        r->stateful = true;
+}
+
+static void
+idle(void)
+{
+    struct timespec ts = { 0, IDLE_SLEEP_NS };
+
+    nanosleep(&ts, NULL);
+}
+
+/* One chunk of a file being scanned with -j, and the worker state that
+ * decoded it.  A slot is reused once its chunk has been printed. */
+typedef struct {
+    scan_t          scan;
+    column_t        columns[MAX_COLUMNS];
+    char            line[LINE_LEN];
+    hci_adv_state_t hci;
+    capfile_t       cf;
+    bool            open;
+    bool            empty;          /* no block starts in the chunk */
+    scan_range_t    range;
+    atomic_uint_fast64_t done;      /* chunk number + 1 once decoded */
+} chunk_t;
+
+typedef struct {
+    const scan_t       *opts;
+    const uint8_t      *base;
+    size_t              size;
+    uint64_t            chunk_count;
+    chunk_t            *chunks;
+    size_t              slots;
+    atomic_uint_fast64_t next_chunk;
+    atomic_uint_fast64_t released;  /* chunks before this have given up their slot */
+    atomic_bool         stop;
+} parallel_t;
+
+static uint64_t
+chunk_offset(size_t size, uint64_t count, uint64_t k)
+{
+    return k >= count ? size : k * CHUNK_BYTES;
+}
+
+/* Open a reader of its own over a mapped file.  Past the file header it
+ * starts with the interfaces of the first section, which reading the
+ * first packet gets past; sets *first to that packet's offset. */
+static int
+open_shared(capfile_t *cf, const uint8_t *base, size_t size, uint64_t *first)
+{
+    capfile_packet_t    pkt;
+    int                 r;
+
+    if (capfile_open_mem(cf, base, size) < 0 || (r = capfile_next(cf, &pkt)) < 0)
+        return -1;
+    *first = r > 0 ? pkt.offset : cf->size;
+
+    return 0;
+}
+
+/* Decode chunk k of count into scan, numbering its frames from 1.  cf is
+ * left for the caller to close.  Returns false if no block starts in the
+ * chunk. */
+static bool
+scan_chunk(const uint8_t *base, size_t size, uint64_t count, uint64_t k,
+        scan_t *scan, capfile_t *cf, scan_range_t *r)
+{
+    uint64_t    lo;
+    uint64_t    hi;
+
+    memset(r, 0, sizeof(*r));
+    if (open_shared(cf, base, size, &lo) < 0) {
+        r->ret = -1;
+        return true;
+    }
+    if (k > 0)
+        lo = capfile_sync(cf, chunk_offset(size, count, k), chunk_offset(size, count, k + 1));
+    hi = capfile_sync(cf, chunk_offset(size, count, k + 1), chunk_offset(size, count, k + 2));
+    if (k > 0 && lo == chunk_offset(size, count, k + 1))
+        return false;
+
+    capfile_seek(cf, lo);
+    scan_packets(scan, cf, hi, 0, r);
+
+    return true;
+}
+
+/* Clear what a chunk's scan counted and printed, keeping its buffers */
+static void
+reset_scan(scan_t *scan, const scan_t *opts)
+{
+    size_t  i;
+
+    scan->file_prefix = opts->file_prefix;
+    scan->line_len    = 0;
+    scan->buf_len     = 0;
+    scan->ref_count   = 0;
+    scan->oom         = false;
+    scan->adverts     = 0;
+    scan->apple       = 0;
+    scan->messages    = 0;
+    scan->fields      = 0;
+    for (i = 0; i < scan->column_count; i++)
+        scan->columns[i].name = opts->columns[i].name;
+    hci_adv_init(scan->hci);
+}
+
+static void
+run_slot(parallel_t *par, uint64_t k, chunk_t *c)
+{
+    reset_scan(&c->scan, par->opts);
+    if (c->open)
+        capfile_close(&c->cf);
+    c->empty = !scan_chunk(par->base, par->size, par->chunk_count, k, &c->scan, &c->cf, &c->range);
+    c->open  = true;
+}
+
+static void *
+scan_worker(void *arg)
+{
+    parallel_t *par = arg;
+    uint64_t    k;
+
+    while ((k = atomic_fetch_add(&par->next_chunk, 1)) < par->chunk_count) {
+        chunk_t    *c = &par->chunks[k % par->slots];
+
+        while (k >= atomic_load(&par->released) + par->slots && !atomic_load(&par->stop))
+            idle();
+        if (atomic_load(&par->stop))
+            break;
+        run_slot(par, k, c);
+        atomic_store(&c->done, k + 1);
+    }
+
+    return NULL;
+}
+
+static void
+add_totals(scan_t *to, const scan_t *from)
+{
+    to->adverts  += from->adverts;
+    to->apple    += from->apple;
+    to->messages += from->messages;
+    to->fields   += from->fields;
+    to->track_oom = to->track_oom || from->track_oom;
+}
+
+static void
+report_error(const char *path, uint64_t frame, const capfile_t *cf)
+{
+    fprintf(stderr, "continuity-scan: %s: frame %" PRIu64 ": %s\n", path, frame, cf->error);
+}
+
+/* Scan a mapped pcapng file on scan->threads threads.  Chunks are printed
+ * in order; a chunk whose first packet is not where the one before it
+ * stopped, or any chunk after one that carried state, is left unprinted
+ * and the file is finished on this thread from the last good chunk. */
+static int
+scan_parallel(scan_t *scan, const char *path, const capfile_t *file)
+{
+    parallel_t  par;
+    pthread_t   threads[MAX_THREADS];
+    chunk_t    *good = NULL;
+    uint64_t    frames = 0;
+    uint64_t    k;
+    unsigned    started;
+    unsigned    t;
+    size_t      i;
+    int         err = 0;
+    int         ret = 0;
+
+    memset(&par, 0, sizeof(par));
+    par.opts        = scan;
+    par.base        = file->base;
+    par.size        = file->size;
+    par.chunk_count = (file->size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    par.slots       = (size_t)scan->threads * CHUNKS_PER_THREAD;
+    par.chunks      = calloc(par.slots, sizeof(*par.chunks));
+    if (!par.chunks) {
+        fprintf(stderr, "continuity-scan: %s: out of memory\n", path);
+        return -1;
+    }
+    for (i = 0; i < par.slots; i++) {
+        chunk_t    *c = &par.chunks[i];
+
+        c->scan              = *scan;
+        c->scan.columns      = c->columns;
+        c->scan.line         = c->line;
+        c->scan.hci          = &c->hci;
+        c->scan.buffered     = true;
+        c->scan.buf          = NULL;
+        c->scan.buf_cap      = 0;
+        c->scan.refs         = NULL;
+        c->scan.ref_cap      = 0;
+        atomic_init(&c->done, 0);
+    }
+
+    for (started = 0; started < scan->threads; started++)
+        if ((err = pthread_create(&threads[started], NULL, scan_worker, &par)) != 0)
+            break;
+    if (started == 0) {
+        fprintf(stderr, "continuity-scan: cannot start threads: %s\n", strerror(err));
+        free(par.chunks);
+        return -1;
+    }
+
+    for (k = 0; k < par.chunk_count; k++) {
+        chunk_t    *c = &par.chunks[k % par.slots];
+
+        while (atomic_load(&c->done) != k + 1)
+            idle();
+        /* A block bigger than a chunk; simplest to carry on from here alone */
+        if (c->empty)
+            break;
+        if (good && c->range.first != good->range.end)
+            break;
+
+        if (c->scan.oom) {
+            fprintf(stderr, "continuity-scan: %s: out of memory\n", path);
+            ret = -1;
+            break;
+        }
+        out_print(&c->scan, stdout, frames);
+        add_totals(scan, &c->scan);
+        frames += c->range.frames;
+        if (c->range.ret < 0) {
+            report_error(path, frames + 1, &c->cf);
+            ret = -1;
+            break;
+        }
+
+        /* The previous chunk only had to be kept for a fallback until now */
+        atomic_store(&par.released, k);
+        good = c;
+        if (c->range.stateful || c->range.ret == 0)
+            break;
+    }
+    atomic_store(&par.stop, true);
+    for (t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+
+    /* Finish on this thread with the state the last good chunk ended in */
+    if (ret == 0 && good && good->range.ret > 0) {
+        scan_range_t    r;
+
+        good->scan.buffered = false;
+        good->scan.adverts  = 0;
+        good->scan.apple    = 0;
+        good->scan.messages = 0;
+        good->scan.fields   = 0;
+        capfile_seek(&good->cf, good->range.end);
+        scan_packets(&good->scan, &good->cf, UINT64_MAX, frames, &r);
+        add_totals(scan, &good->scan);
+        frames += r.frames;
+        if (r.ret < 0) {
+            report_error(path, frames + 1, &good->cf);
+            ret = -1;
+        }
+    }
+
+    scan->packets += frames;
+    for (i = 0; i < par.slots; i++) {
+        if (par.chunks[i].open)
+            capfile_close(&par.chunks[i].cf);
+        free(par.chunks[i].scan.buf);
+        free(par.chunks[i].scan.refs);
+    }
+    free(par.chunks);
+
+    return ret;
+}
+
+/* The sidecar index's path, or NULL when out of memory */
+static char *
+index_path(const char *path)
+{
+    size_t  len = strlen(path) + sizeof(CAPINDEX_SUFFIX);
+    char   *p = malloc(len);
+
+    if (p)
+        snprintf(p, len, "%s%s", path, CAPINDEX_SUFFIX);
+
+    return p;
+}
+
+/* Open path's index if -f can use it.  Only a missing index goes
+ * unreported. */
+static bool
+open_index(const scan_t *scan, const char *path, capindex_t *ix)
+{
+    char   *ix_path;
+
+    if (!scan->filter_count || scan->write_index || !(ix_path = index_path(path)))
+        return false;
+    if (capindex_open(ix, ix_path, path) < 0) {
+        if (errno != ENOENT)
+            fprintf(stderr, "continuity-scan: %s: %s, reading the whole capture\n",
+                    ix_path, ix->error);
+        free(ix_path);
+        return false;
+    }
+    free(ix_path);
+    if (ix->flags & CAPINDEX_SEQUENTIAL) {
+        capindex_close(ix);
+        return false;
+    }
+
+    return true;
+}
+
+/* Mark the adverts with one of filter f's keys whose hits so far are
+ * filter number n */
+static void
+mark_filter(const capindex_t *ix, const filter_t *f, uint8_t n, uint8_t *hits)
+{
+    uint64_t    lo = CAPINDEX_KEY(f->kind, f->value);
+    uint64_t    hi = lo;
+    uint64_t    k;
+
+    if (f->kind == CAPINDEX_BUCKET) {
+        uint64_t    last = f->to_ns == UINT64_MAX ? UINT32_MAX :
+            (f->to_ns - 1) / 1000000000u / CAPINDEX_BUCKET_SECS;
+
+        lo = CAPINDEX_KEY(CAPINDEX_BUCKET, f->from_ns / 1000000000u / CAPINDEX_BUCKET_SECS);
+        hi = CAPINDEX_KEY(CAPINDEX_BUCKET, last < UINT32_MAX ? last : UINT32_MAX);
+    }
+
+    for (k = capindex_find(ix, lo); k < ix->key_count; k++) {
+        uint64_t    first;
+        uint64_t    count;
+        uint64_t    j;
+
+        if (capindex_key(ix, k, &first, &count) > hi)
+            break;
+        for (j = first; j < first + count; j++) {
+            uint64_t    a = capindex_posting(ix, j);
+
+            if (a < ix->advert_count && hits[a] == n)
+                hits[a] = (uint8_t)(n + 1);
+        }
+    }
+}
+
+/* Scan only the adverts whose keys match every filter, reading each from
+ * its offset in the index.  The filters still decide; the keys only rule
+ * frames out.  Returns false if there is no memory to try. */
+static bool
+scan_indexed(scan_t *scan, capfile_t *cf, const capindex_t *ix, scan_range_t *r)
+{
+    capfile_packet_t    pkt;
+    capindex_advert_t   a;
+    btle_adv_t          adv;
+    uint64_t            section = CAPINDEX_NO_SECTION;
+    uint64_t            i;
+    uint8_t            *hits;
+    size_t              n;
+
+    if (!(hits = calloc(ix->advert_count ? ix->advert_count : 1, 1)))
+        return false;
+    for (n = 0; n < scan->filter_count; n++)
+        mark_filter(ix, &scan->filters[n], (uint8_t)n, hits);
+
+    memset(r, 0, sizeof(*r));
+    r->frames = ix->packets;
+    for (i = 0; i < ix->advert_count; i++) {
+        if (hits[i] != scan->filter_count)
+            continue;
+        capindex_advert(ix, i, &a);
+
+        /* Reading the section header sets up its interfaces */
+        if (a.section != section && a.section != CAPINDEX_NO_SECTION) {
+            capfile_seek(cf, a.section);
+            if (capfile_next(cf, &pkt) < 0) {
+                r->ret = -1;
+                break;
+            }
+            section = a.section;
+        }
+        capfile_seek(cf, a.offset);
+        if ((r->ret = capfile_next(cf, &pkt)) <= 0 || pkt.offset != a.offset ||
+                !btle_parse_adv(pkt.linktype, pkt.data, pkt.caplen, &adv)) {
+            if (r->ret >= 0)
+                cf->error = "the index does not match the capture";
+            r->ret = -1;
+            break;
+        }
+        r->ret = 0;
+        scan_advert(scan, a.frame, &pkt, &adv);
+    }
+    if (r->ret < 0)
+        r->frames = a.frame - 1;
+    free(hits);
+
+    return true;
+}
+
+/* Scan cf from the start on this thread, and with -X write its index.
+ * Returns NULL, or why the index was not written. */
+static const char *
+scan_sequential(scan_t *scan, const char *path, capfile_t *cf, scan_range_t *r)
+{
+    capindex_writer_t  *w = NULL;
+    const char         *error = NULL;
+    char               *ix_path;
+
+    if (scan->write_index && (w = malloc(sizeof(*w))))
+        capindex_writer_init(w);
+    scan->index = w;
+    hci_adv_init(scan->hci);
+    scan_packets(scan, cf, UINT64_MAX, 0, r);
+    scan->index = NULL;
+
+    /* A damaged capture is reported, and left without an index */
+    if (!scan->write_index || r->ret < 0) {
+        /* Nothing to write */
+    } else if (!w || !(ix_path = index_path(path))) {
+        error = "out of memory";
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, error);
+    } else {
+        errno = 0;
+        if (capindex_write(w, ix_path, path, r->frames) < 0) {
+            error = w->error;
+            fprintf(stderr, "continuity-scan: %s: %s", ix_path, error);
+            if (errno)
+                fprintf(stderr, " (%s)", strerror(errno));
+            fputc('\n', stderr);
+        }
+        free(ix_path);
+    }
+    if (w) {
+        capindex_writer_free(w);
+        free(w);
+    }
+
+    return error;
+}
+
+static int
+scan_file(scan_t *scan, const char *path)
+{
+    capfile_t       cf;
+    capindex_t      ix;
+    scan_range_t    r;
+    bool            indexed = false;
+    int             ret = 0;
+
+    if (capfile_open(&cf, path) < 0) {
+        fprintf(stderr, "continuity-scan: %s: %s", path, cf.error);
+        if (errno)
+            fprintf(stderr, " (%s)", strerror(errno));
+        fputc('\n', stderr);
+        capfile_close(&cf);
+        return -1;
+    }
+
+    if (open_index(scan, path, &ix)) {
+        indexed = scan_indexed(scan, &cf, &ix, &r);
+        capindex_close(&ix);
+    }
+    if (!indexed && scan->threads > 1 && !scan->write_index && !scan->timeline &&
+            !scan->homekit && cf.format == CAPFILE_PCAPNG &&
+            cf.size > 2 * CHUNK_BYTES) {
+        ret = scan_parallel(scan, path, &cf);
+    } else {
+        if (!indexed && scan_sequential(scan, path, &cf, &r))
+            ret = -1;
+        if (r.ret < 0) {
+            report_error(path, r.frames + 1, &cf);
+            ret = -1;
+        }
+        scan->packets += r.frames;
+    }
+
+    scan->bytes += cf.size;
+    capfile_close(&cf);
+
+    return ret;
+}
+
+/* Batch mode (-o).  Files, and chunks of the big pcapng files, are tasks
+ * on a work-stealing scheduler: each worker runs tasks from its own deque,
+ * newest first, and when that is empty takes the oldest task from another
+ * worker's.  A file task maps the file and either scans it whole or pushes
+ * tasks for its first chunks.  Chunks are printed in order under the
+ * file's lock by whichever worker finishes the one that was holding the
+ * rest back, and each chunk printed pushes the next, so the output held
+ * back is bounded as in scan_parallel().  When a chunk cannot be trusted,
+ * for the reasons scan_parallel() falls back, the rest of the file becomes
+ * one more task that reads it in order. */
+
+enum {
+    TASK_FILE,
+    TASK_CHUNK,
+    TASK_TAIL
+};
+
+struct batch_file;
+
+typedef struct {
+    int                 kind;
+    struct batch_file  *file;
+    uint64_t            chunk;
+} batch_task_t;
+
+typedef struct {
+    scan_t          scan;           /* buffered output and counts */
+    scan_range_t    range;
+    const char     *error;          /* the reader's, when range.ret < 0 */
+    bool            empty;
+    bool            done;
+} batch_chunk_t;
+
+typedef struct batch_file {
+    const char     *path;
+    char           *out_path;       /* NULL with -q */
+    uint64_t        size;           /* before opening, to order the tasks */
+    capfile_t       cf;
+    FILE           *out;
+    batch_task_t    task;
+    batch_task_t    tail;
+    batch_task_t   *chunk_tasks;
+    batch_chunk_t  *chunks;
+    uint64_t        chunk_count;
+    atomic_uint     tasks;          /* left to run; the last one closes the file */
+    /* guarded by lock while chunks are being printed */
+    pthread_mutex_t lock;
+    uint64_t        next_chunk;
+    uint64_t        next_push;      /* chunks before this have been pushed */
+    uint64_t        end;            /* where the last printed chunk stopped */
+    bool            stopped;        /* no more chunks are printed */
+    /* results */
+    scan_t          totals;
+    const char     *error;
+} batch_file_t;
+
+struct batch;
+
+typedef struct {
+    struct batch   *batch;
+    wsdeque_t       deque;
+    scan_t          scan;           /* for whole files and tails */
+    column_t        columns[MAX_COLUMNS];
+    char            line[LINE_LEN];
+    hci_adv_state_t hci;
+    uint32_t        rand;           /* picks whom to steal from */
+} batch_worker_t;
+
+typedef struct batch {
+    const scan_t       *opts;
+    batch_worker_t     *workers;
+    unsigned            worker_count;
+    atomic_uint_fast64_t pending;   /* tasks pushed and not finished */
+} batch_t;
+
+static void run_task(batch_worker_t *w, batch_task_t *t);
+
+static void
+batch_push(batch_worker_t *w, batch_task_t *t)
+{
+    atomic_fetch_add(&w->batch->pending, 1);
+    /* The deque only fails to grow when memory runs out; run it here */
+    if (wsdeque_push(&w->deque, t) < 0) {
+        run_task(w, t);
+        atomic_fetch_sub(&w->batch->pending, 1);
+    }
+}
+
+static batch_task_t *
+batch_steal(batch_worker_t *w)
+{
+    batch_t        *b = w->batch;
+    batch_task_t   *t;
+    unsigned        start;
+    unsigned        i;
+
+    /* xorshift32 */
+    w->rand ^= w->rand << 13;
+    w->rand ^= w->rand >> 17;
+    w->rand ^= w->rand << 5;
+    start = w->rand % b->worker_count;
+    for (i = 0; i < b->worker_count; i++) {
+        batch_worker_t *victim = &b->workers[(start + i) % b->worker_count];
+
+        if (victim != w && (t = wsdeque_steal(&victim->deque)))
+            return t;
+    }
+
+    return NULL;
+}
+
+static void
+file_error(batch_file_t *f, uint64_t frame, const char *error)
+{
+    if (f->error)
+        return;
+    f->error = error;
+    fprintf(stderr, "continuity-scan: %s: frame %" PRIu64 ": %s\n", f->path, frame, error);
+}
+
+/* The worker's own scan, writing straight to f's output */
+static scan_t *
+worker_scan(batch_worker_t *w, batch_file_t *f)
+{
+    reset_scan(&w->scan, w->batch->opts);
+    w->scan.out = f->out;
+
+    return &w->scan;
+}
+
+static void
+finish_task(batch_file_t *f)
+{
+    uint64_t    k;
+
+    if (atomic_fetch_sub(&f->tasks, 1) != 1)
+        return;
+
+    if (f->out && fclose(f->out) != 0 && !f->error) {
+        f->error = "write error";
+        fprintf(stderr, "continuity-scan: %s: %s\n", f->out_path, strerror(errno));
+    }
+    f->out = NULL;
+    capfile_close(&f->cf);
+    for (k = 0; k < f->chunk_count; k++) {
+        free(f->chunks[k].scan.buf);
+        free(f->chunks[k].scan.refs);
+    }
+    free(f->chunks);
+    free(f->chunk_tasks);
+    f->chunks      = NULL;
+    f->chunk_tasks = NULL;
+    f->chunk_count = 0;
+}
+
+/* Push the next chunk of f, if any.  Called with f->lock held. */
+static void
+push_chunk(batch_worker_t *w, batch_file_t *f)
+{
+    batch_task_t   *t;
+
+    if (f->stopped || f->next_push == f->chunk_count)
+        return;
+    t = &f->chunk_tasks[f->next_push];
+    t->kind  = TASK_CHUNK;
+    t->file  = f;
+    t->chunk = f->next_push++;
+    atomic_fetch_add(&f->tasks, 1);
+    batch_push(w, t);
+}
+
+static void
+run_file(batch_worker_t *w, batch_file_t *f)
+{
+    const scan_t   *opts = w->batch->opts;
+    const char     *error = NULL;
+    capindex_t      ix;
+    scan_range_t    r;
+    bool            indexed = false;
+    uint64_t        k;
+
+    errno = 0;
+    if (capfile_open(&f->cf, f->path) < 0) {
+        f->error = f->cf.error;
+        fprintf(stderr, "continuity-scan: %s: %s", f->path, f->cf.error);
+        if (errno)
+            fprintf(stderr, " (%s)", strerror(errno));
+        fputc('\n', stderr);
+        return;
+    }
+    f->totals.bytes = f->cf.size;
+    if (f->out_path && !(f->out = fopen(f->out_path, "w"))) {
+        f->error = "cannot create the output file";
+        fprintf(stderr, "continuity-scan: %s: %s\n", f->out_path, strerror(errno));
+        return;
+    }
+
+    if (open_index(opts, f->path, &ix)) {
+        indexed = scan_indexed(worker_scan(w, f), &f->cf, &ix, &r);
+        capindex_close(&ix);
+    }
+    if (!indexed && w->batch->worker_count > 1 && !opts->write_index &&
+            f->cf.format == CAPFILE_PCAPNG && f->cf.size > 2 * CHUNK_BYTES) {
+        f->chunk_count = (f->cf.size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+        f->chunks      = calloc(f->chunk_count, sizeof(*f->chunks));
+        f->chunk_tasks = calloc(f->chunk_count, sizeof(*f->chunk_tasks));
+        if (f->chunks && f->chunk_tasks) {
+            /* A chunk's output is held until the ones before it are
+             * printed, so only a window of chunks is in flight; printing
+             * one pushes the next.  Thieves take the oldest, which is the
+             * next chunk of the file. */
+            pthread_mutex_lock(&f->lock);
+            for (k = 0; k < (uint64_t)w->batch->worker_count * CHUNKS_PER_THREAD; k++)
+                push_chunk(w, f);
+            pthread_mutex_unlock(&f->lock);
+            return;
+        }
+        free(f->chunks);
+        free(f->chunk_tasks);
+        f->chunks      = NULL;
+        f->chunk_tasks = NULL;
+        f->chunk_count = 0;
+    }
+
+    if (!indexed)
+        error = scan_sequential(worker_scan(w, f), f->path, &f->cf, &r);
+    add_totals(&f->totals, &w->scan);
+    f->totals.packets = r.frames;
+    if (r.ret < 0)
+        file_error(f, r.frames + 1, f->cf.error);
+    else if (error)
+        f->error = error;
+}
+
+/* Print the chunks that are ready, in order.  Called with f->lock held. */
+static void
+print_chunks(batch_worker_t *w, batch_file_t *f)
+{
+    while (!f->stopped && f->next_chunk < f->chunk_count && f->chunks[f->next_chunk].done) {
+        batch_chunk_t  *c = &f->chunks[f->next_chunk];
+
+        if (c->empty || c->range.stateful || c->scan.oom ||
+                (f->next_chunk > 0 && c->range.first != f->end)) {
+            /* Nothing before this chunk carried state, so the tail can
+             * start from the state of the first packet */
+            f->stopped    = true;
+            f->tail.kind  = TASK_TAIL;
+            f->tail.file  = f;
+            f->tail.chunk = f->next_chunk;
+            atomic_fetch_add(&f->tasks, 1);
+            batch_push(w, &f->tail);
+            return;
+        }
+
+        if (f->out)
+            out_print(&c->scan, f->out, f->totals.packets);
+        add_totals(&f->totals, &c->scan);
+        f->totals.packets += c->range.frames;
+        f->end = c->range.end;
+        free(c->scan.buf);
+        free(c->scan.refs);
+        c->scan.buf  = NULL;
+        c->scan.refs = NULL;
+        f->next_chunk++;
+
+        if (c->range.ret < 0)
+            file_error(f, f->totals.packets + 1, c->error);
+        if (c->range.ret <= 0)
+            f->stopped = true;
+        push_chunk(w, f);
+    }
+}
+
+static void
+run_chunk(batch_worker_t *w, batch_file_t *f, uint64_t k)
+{
+    batch_chunk_t  *c = &f->chunks[k];
+    capfile_t       cf;
+    bool            stopped;
+
+    pthread_mutex_lock(&f->lock);
+    stopped = f->stopped;
+    pthread_mutex_unlock(&f->lock);
+
+    /* Chunks after a fallback are read by the tail instead */
+    if (!stopped) {
+        c->scan          = w->scan;
+        c->scan.buffered = true;
+        reset_scan(&c->scan, w->batch->opts);
+        c->empty = !scan_chunk(f->cf.base, f->cf.size, f->chunk_count, k, &c->scan, &cf, &c->range);
+        c->error = cf.error;
+        capfile_close(&cf);
+    }
+
+    pthread_mutex_lock(&f->lock);
+    c->done = true;
+    print_chunks(w, f);
+    pthread_mutex_unlock(&f->lock);
+}
+
+static void
+run_tail(batch_worker_t *w, batch_file_t *f)
+{
+    capfile_t       cf;
+    scan_range_t    r;
+    uint64_t        first;
+
+    if (open_shared(&cf, f->cf.base, f->cf.size, &first) < 0) {
+        file_error(f, f->totals.packets + 1, cf.error);
+        capfile_close(&cf);
+        return;
+    }
+    capfile_seek(&cf, f->tail.chunk == 0 ? first : f->end);
+
+    scan_packets(worker_scan(w, f), &cf, UINT64_MAX, f->totals.packets, &r);
+    add_totals(&f->totals, &w->scan);
+    f->totals.packets += r.frames;
+    if (r.ret < 0)
+        file_error(f, f->totals.packets + 1, cf.error);
+    capfile_close(&cf);
+}
+
+static void
+run_task(batch_worker_t *w, batch_task_t *t)
+{
+    switch (t->kind) {
+    case TASK_FILE:
+        run_file(w, t->file);
+        break;
+    case TASK_CHUNK:
+        run_chunk(w, t->file, t->chunk);
+        break;
+    default:
+        run_tail(w, t->file);
+        break;
+    }
+    finish_task(t->file);
+}
+
+static void *
+batch_worker(void *arg)
+{
+    batch_worker_t *w = arg;
+    batch_task_t   *t;
+
+    for (;;) {
+        if ((t = wsdeque_pop(&w->deque)) || (t = batch_steal(w))) {
+            run_task(w, t);
+            atomic_fetch_sub(&w->batch->pending, 1);
+        } else if (atomic_load(&w->batch->pending) == 0) {
+            break;
+        } else {
+            idle();
+        }
+    }
+
+    return NULL;
+}
+
+static int
+compare_size(const void *a, const void *b)
+{
+    const batch_file_t *fa = *(batch_file_t *const *)a;
+    const batch_file_t *fb = *(batch_file_t *const *)b;
+
+    return (fa->size > fb->size) - (fa->size < fb->size);
+}
+
+static int
+write_summary(const char *dir, const batch_file_t *files, size_t count, const scan_t *total)
+{
+    char        path[PATH_MAX];
+    FILE       *f;
+    size_t      i;
+
+    if (snprintf(path, sizeof(path), "%s/summary.txt", dir) >= (int)sizeof(path) ||
+            !(f = fopen(path, "w"))) {
+        fprintf(stderr, "continuity-scan: %s/summary.txt: %s\n", dir,
+                strerror(errno ? errno : ENAMETOOLONG));
+        return -1;
+    }
+
+    fprintf(f, "# file\tpackets\tadverts\tapple\tmessages\tfields\tbytes\tstatus\n");
+    for (i = 0; i < count; i++) {
+        const scan_t   *t = &files[i].totals;
+
+        fprintf(f, "%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64
+                "\t%" PRIu64 "\t%s\n", files[i].path, t->packets, t->adverts, t->apple,
+                t->messages, t->fields, t->bytes, files[i].error ? files[i].error : "ok");
+    }
+    fprintf(f, "total\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64
+            "\t%" PRIu64 "\t%zu files\n", total->packets, total->adverts, total->apple,
+            total->messages, total->fields, total->bytes, count);
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Per-file output name: the file's base name with .txt added */
+static char *
+batch_out_path(const char *dir, const char *path)
+{
+    const char *name = strrchr(path, '/');
+    size_t      len;
+    char       *out;
+
+    name = name ? name + 1 : path;
+    len  = strlen(dir) + strlen(name) + sizeof("/.txt");
+    if ((out = malloc(len)))
+        snprintf(out, len, "%s/%s.txt", dir, name);
+
+    return out;
+}
+
+/* Scan paths into dir on scan->threads workers.  Adds the files' totals
+ * to scan. */
+static int
+scan_batch(scan_t *scan, const char *dir, char **paths, size_t count)
+{
+    batch_t         b;
+    batch_file_t   *files;
+    batch_file_t  **order;
+    pthread_t       threads[MAX_THREADS];
+    unsigned        started;
+    unsigned        t;
+    size_t          i;
+    size_t          j;
+    int             err = 0;
+    int             ret = 0;
+
+    if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    memset(&b, 0, sizeof(b));
+    b.opts         = scan;
+    b.worker_count = scan->threads;
+    files   = calloc(count, sizeof(*files));
+    order   = calloc(count, sizeof(*order));
+    b.workers = calloc(b.worker_count, sizeof(*b.workers));
+    if (!files || !order || !b.workers) {
+        fprintf(stderr, "continuity-scan: out of memory\n");
+        free(files);
+        free(order);
+        free(b.workers);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        batch_file_t   *f = &files[i];
+        struct stat     st;
+
+        f->path      = paths[i];
+        f->task.kind = TASK_FILE;
+        f->task.file = f;
+        atomic_init(&f->tasks, 1);
+        pthread_mutex_init(&f->lock, NULL);
+        if (stat(f->path, &st) == 0)
+            f->size = (uint64_t)st.st_size;
+        if (!scan->quiet && !(f->out_path = batch_out_path(dir, f->path))) {
+            fprintf(stderr, "continuity-scan: out of memory\n");
+            ret = -1;
+        }
+        for (j = 0; j < i && f->out_path; j++) {
+            if (files[j].out_path && strcmp(files[j].out_path, f->out_path) == 0) {
+                fprintf(stderr, "continuity-scan: %s and %s would both be written to %s\n",
+                        files[j].path, f->path, f->out_path);
+                ret = -1;
+            }
+        }
+        order[i] = f;
+    }
+
+    for (t = 0; ret == 0 && t < b.worker_count; t++) {
+        batch_worker_t *w = &b.workers[t];
+
+        w->batch          = &b;
+        w->scan           = *scan;
+        w->scan.columns   = w->columns;
+        w->scan.line      = w->line;
+        w->scan.hci       = &w->hci;
+        w->scan.file_prefix = NULL;
+        w->scan.buffered  = false;
+        w->rand           = 0x9e3779b9u * (t + 1);
+        if (wsdeque_init(&w->deque, count / b.worker_count + 16) < 0) {
+            fprintf(stderr, "continuity-scan: out of memory\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Deal the files out smallest first, so each worker pops its
+         * biggest file first and thieves take the small ones */
+        qsort(order, count, sizeof(*order), compare_size);
+        for (i = 0; i < count; i++)
+            batch_push(&b.workers[i % b.worker_count], &order[i]->task);
+
+        /* Tasks dealt to a worker that did not start are stolen */
+        for (started = 0; started < b.worker_count; started++)
+            if ((err = pthread_create(&threads[started], NULL, batch_worker, &b.workers[started])) != 0)
+                break;
+        if (started == 0) {
+            fprintf(stderr, "continuity-scan: cannot start threads: %s\n", strerror(err));
+            ret = -1;
+        }
+        for (t = 0; t < started; t++)
+            pthread_join(threads[t], NULL);
+    }
+
+    if (ret == 0) {
+        scan_t  total;
+
+        memset(&total, 0, sizeof(total));
+        for (i = 0; i < count; i++) {
+            add_totals(&total, &files[i].totals);
+            total.packets += files[i].totals.packets;
+            total.bytes   += files[i].totals.bytes;
+            if (files[i].error)
+                ret = -1;
+        }
+        add_totals(scan, &total);
+        scan->packets += total.packets;
+        scan->bytes   += total.bytes;
+        if (write_summary(dir, files, count, &total) < 0)
+            ret = -1;
+    }
+
+    for (t = 0; t < scan->threads; t++)
+        if (b.workers[t].batch)
+            wsdeque_free(&b.workers[t].deque);
+    for (i = 0; i < count; i++) {
+        pthread_mutex_destroy(&files[i].lock);
+        free(files[i].out_path);
+    }
+    free(b.workers);
+    free(order);
+    free(files);
+
+    return ret;
+}
+
+static bool
+is_field(const char *arg, size_t len, const char *name)
+{
+    return len == strlen(name) && strncmp(arg, name, len) == 0;
+}
+
+/* -f field=value */
+static int
+parse_filter(const char *arg, filter_t *f)
+{
+    const char     *value = strchr(arg, '=');
+    unsigned long   v;
+    unsigned        a[6];
+    uint8_t         addr[6];
+    char           *end;
+    size_t          len;
+    int             n = 0;
+    int             i;
+
+    if (!value)
+        return -1;
+    len = (size_t)(value - arg);
+    value++;
+    memset(f, 0, sizeof(*f));
+
+    if (is_field(arg, len, FIELD_ADV_ADDRESS)) {
+        if (sscanf(value, "%2x:%2x:%2x:%2x:%2x:%2x%n", &a[0], &a[1], &a[2], &a[3], &a[4],
+                    &a[5], &n) != 6 || value[n])
+            return -1;
+        for (i = 0; i < 6; i++)
+            addr[i] = (uint8_t)a[i];
+        f->kind  = CAPINDEX_ADDR;
+        f->value = addr48(addr);
+        return 0;
+    }
+    if (is_field(arg, len, FIELD_FRAME_TIME)) {
+        f->kind  = CAPINDEX_BUCKET;
+        f->to_ns = UINT64_MAX;
+        errno = 0;
+        if (*value != '-') {
+            v = strtoul(value, &end, 10);
+            if (errno || end == value || v >= UINT64_MAX / 1000000000u)
+                return -1;
+            f->from_ns = (uint64_t)v * 1000000000u;
+            value = end;
+        }
+        if (*value++ != '-')
+            return -1;
+        if (*value) {
+            v = strtoul(value, &end, 10);
+            if (errno || *end || v >= UINT64_MAX / 1000000000u)
+                return -1;
+            f->to_ns = (uint64_t)v * 1000000000u;
+        }
+        return 0;
+    }
+
+    if (is_field(arg, len, FIELD_TYPE))
+        f->kind = CAPINDEX_TYPE;
+    else if (is_field(arg, len, FIELD_NEARBY_ACTION))
+        f->kind = CAPINDEX_NEARBY_ACTION;
+    else if (is_field(arg, len, FIELD_NEARBY_INFO))
+        f->kind = CAPINDEX_NEARBY_INFO;
+    else
+        return -1;
+    errno = 0;
+    v = strtoul(value, &end, 0);
+    if (errno || end == value || *end || v > (f->kind == CAPINDEX_NEARBY_INFO ? 15u : 255u))
+        return -1;
+    f->value = v;
+
+    return 0;
+}
+
+static int
+compare_str(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+typedef struct {
+    char      **paths;
+    size_t      count;
+    size_t      cap;
+} path_list_t;
+
+static int
+add_path(path_list_t *l, char *path)
+{
+    if (!path)
+        return -1;
+    if (l->count == l->cap) {
+        size_t  cap = l->cap ? 2 * l->cap : 64;
+        char  **paths = realloc(l->paths, cap * sizeof(*paths));
+
+        if (!paths) {
+            free(path);
+            return -1;
+        }
+        l->paths = paths;
+        l->cap   = cap;
+    }
+    l->paths[l->count++] = path;
+
+    return 0;
+}
+
+static bool
+is_index(const char *name)
+{
+    size_t  len = strlen(name);
+
+    return len >= strlen(CAPINDEX_SUFFIX) &&
+        strcmp(name + len - strlen(CAPINDEX_SUFFIX), CAPINDEX_SUFFIX) == 0;
+}
+
+/* Add the regular files in dir, in name order, leaving out hidden ones
+ * and indexes */
+static int
+add_dir(path_list_t *l, const char *name)
+{
+    struct dirent  *de;
+    DIR            *dir;
+    size_t          first = l->count;
+    int             ret = 0;
+
+    if (!(dir = opendir(name))) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    while (ret == 0 && (de = readdir(dir))) {
+        size_t      len = strlen(name) + strlen(de->d_name) + 2;
+        struct stat st;
+        char       *path;
+
+        if (de->d_name[0] == '.' || is_index(de->d_name))
+            continue;
+        if (!(path = malloc(len))) {
+            ret = -1;
+            break;
+        }
+        snprintf(path, len, "%s/%s", name, de->d_name);
+        if (stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+            free(path);
+        else
+            ret = add_path(l, path);
+    }
+    closedir(dir);
+    if (ret < 0)
+        fprintf(stderr, "continuity-scan: out of memory\n");
+    if (l->count > first)
+        qsort(l->paths + first, l->count - first, sizeof(*l->paths), compare_str);
+
+    return ret;
+}
+
+/* -t: one line per interval, each device's in time order, the devices in
+ * the order they were first seen */
+static int
+write_timeline(const char *path, const continuity_timeline_t *tl)
+{
+    FILE       *f;
+    char        addr[18];
+    char        start[32];
+    char        end[32];
+    size_t      d;
+    size_t      i;
+
+    if (!(f = fopen(path, "w"))) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(f, "# address\tstart\tend\tadverts\taction_code\tstatus_flags\n");
+    for (d = 0; d < tl->count; d++) {
+        const continuity_timeline_device_t *device = &tl->devices[d];
+
+        format_addr(device->addr, addr);
+        for (i = 0; i < device->count; i++) {
+            const continuity_interval_t *iv = &device->intervals[i];
+
+            format_time(iv->start_ns, start);
+            format_time(iv->end_ns, end);
+            fprintf(f, "%s\t%s\t%s\t%" PRIu32 "\t%u\t0x%x\n", addr, start, end, iv->adverts,
+                    iv->action_code, iv->status_flags);
+        }
+    }
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* A battery level as a percentage, or an empty CSV field or JSON null
+ * when unknown */
+static const char *
+format_battery(uint8_t level, bool json, char *out)
+{
+    if (level > 10)
+        return json ? "null" : "";
+    sprintf(out, "%u", level * 10u);
+
+    return out;
+}
+
+/* -a: one row per stored sample.  CSV has a header line; JSON is an array
+ * of devices, each with its samples. */
+static int
+write_airpods(const char *path, const continuity_timeline_t *tl)
+{
+    FILE       *f;
+    size_t      len = strlen(path);
+    bool        json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+    bool        first_device = true;
+    char        addr[18];
+    char        ts[32];
+    char        left[4];
+    char        right[4];
+    char        case_level[4];
+    size_t      d;
+
+    if (!(f = fopen(path, "w"))) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (json)
+        fputs("[", f);
+    else
+        fputs("address,time,left_battery,right_battery,case_battery,"
+                "left_charging,right_charging,case_charging,open_count\n", f);
+    for (d = 0; d < tl->count; d++) {
+        const continuity_timeline_device_t *device = &tl->devices[d];
+        continuity_airpods_cursor_t         cursor;
+        bool                                first_sample = true;
+
+        if (!device->airpods_count)
+            continue;
+        format_addr(device->addr, addr);
+        if (json) {
+            fprintf(f, "%s\n{\"address\": \"%s\", \"adverts\": %" PRIu64 ", \"samples\": [",
+                    first_device ? "" : ",", addr, device->airpods_adverts);
+            first_device = false;
+        }
+
+        memset(&cursor, 0, sizeof(cursor));
+        while (continuity_airpods_next(device, &cursor)) {
+            const continuity_airpods_sample_t *sample = &cursor.sample;
+
+            format_time(sample->ts_ns, ts);
+            if (json) {
+                fprintf(f, "%s\n  {\"time\": %s, \"left_battery\": %s, \"right_battery\": %s, "
+                        "\"case_battery\": %s, \"left_charging\": %u, \"right_charging\": %u, "
+                        "\"case_charging\": %u, \"open_count\": %u}", first_sample ? "" : ",", ts,
+                        format_battery(sample->left_battery, json, left),
+                        format_battery(sample->right_battery, json, right),
+                        format_battery(sample->case_battery, json, case_level),
+                        sample->charging & 1u, sample->charging >> 1 & 1u, sample->charging >> 2 & 1u,
+                        sample->open_count);
+                first_sample = false;
+            } else {
+                fprintf(f, "%s,%s,%s,%s,%s,%u,%u,%u,%u\n", addr, ts,
+                        format_battery(sample->left_battery, json, left),
+                        format_battery(sample->right_battery, json, right),
+                        format_battery(sample->case_battery, json, case_level),
+                        sample->charging & 1u, sample->charging >> 1 & 1u, sample->charging >> 2 & 1u,
+                        sample->open_count);
+            }
+        }
+        if (json)
+            fputs("]}", f);
+    }
+    if (json)
+        fputs("\n]\n", f);
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Busiest accessories first */
+static int
+compare_homekit(const void *a, const void *b)
+{
+    const continuity_homekit_accessory_t *x = *(const continuity_homekit_accessory_t * const *)a;
+    const continuity_homekit_accessory_t *y = *(const continuity_homekit_accessory_t * const *)b;
+
+    if (x->state_changes != y->state_changes)
+        return x->state_changes < y->state_changes ? 1 : -1;
+
+    return memcmp(x->device_id, y->device_id, 6);
+}
+
+static void
+format_gap(uint64_t ns, bool known, char *out)
+{
+    if (known)
+        sprintf(out, "%.3f", (double)ns / 1e9);
+    else
+        strcpy(out, "-");
+}
+
+/* -k: one line per accessory.  Gaps are the seconds between adverts that
+ * brought a new state number. */
+static int
+write_homekit(const char *path, const continuity_homekit_tracker_t *t)
+{
+    const continuity_homekit_accessory_t **order;
+    FILE       *f;
+    char        id[18];
+    char        first[32];
+    char        last[32];
+    char        gap_min[32];
+    char        gap_mean[32];
+    char        gap_max[32];
+    uint64_t    changes = 0;
+    size_t      n;
+    size_t      s;
+
+    if (!(order = malloc((t->count ? t->count : 1) * sizeof(*order)))) {
+        fprintf(stderr, "continuity-scan: out of memory\n");
+        return -1;
+    }
+    for (n = 0; n < t->count; n++)
+        order[n] = &t->accessories[n];
+    qsort(order, n, sizeof(*order), compare_homekit);
+
+    if (!(f = fopen(path, "w"))) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        free(order);
+        return -1;
+    }
+
+    fprintf(f, "# device_id\tcategory\tadverts\tfirst\tlast\tstate_number\tstate_changes"
+            "\tstate_resets\tconfig_num\tconfig_changes\tgap_min\tgap_mean\tgap_max\n");
+    for (s = 0; s < n; s++) {
+        const continuity_homekit_accessory_t *a = order[s];
+        bool                                  gaps = a->state_events > 1;
+
+        format_addr(a->device_id, id);
+        format_time(a->first_ns, first);
+        format_time(a->last_ns, last);
+        format_gap(a->gap_min_ns, gaps, gap_min);
+        format_gap(gaps ? a->gap_sum_ns / (a->state_events - 1) : 0, gaps, gap_mean);
+        format_gap(a->gap_max_ns, gaps, gap_max);
+        fprintf(f, "%s\t0x%04x\t%" PRIu64 "\t%s\t%s\t%u\t%" PRIu32 "\t%" PRIu32 "\t%u\t%" PRIu32
+                "\t%s\t%s\t%s\n", id, a->category, a->adverts, first, last, a->global_state,
+                a->state_changes, a->state_resets, a->config_num, a->config_changes,
+                gap_min, gap_mean, gap_max);
+        changes += a->state_changes;
+    }
+    fprintf(f, "total\t%zu accessories\t%" PRIu64 " state changes\n", n, changes);
+    free(order);
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "continuity-scan: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+int
+main(int argc, char **argv)
+{
+    static char stdout_buf[1 << 20];
+    static char line[LINE_LEN];
+    static column_t columns[MAX_COLUMNS];
+    static hci_adv_state_t hci;
+    static filter_t filters[MAX_FILTERS];
+    static continuity_timeline_t timeline;
+    static continuity_homekit_tracker_t homekit;
+    scan_t          scan;
+    path_list_t     files;
+    const char     *out_dir = NULL;
+    const char     *timeline_path = NULL;
+    const char     *airpods_path = NULL;
+    const char     *homekit_path = NULL;
+    char           *end;
+    unsigned long   v;
+    uint64_t        start;
+    double          elapsed;
+    int             opt;
+    int             ret = 0;
+    int             i;
+    size_t          f;
+
+    memset(&scan, 0, sizeof(scan));
+    memset(&files, 0, sizeof(files));
+    scan.columns = columns;
+    scan.line    = line;
+    scan.hci     = &hci;
+    scan.threads = 1;
+    scan.out     = stdout;
+    scan.filters = filters;
+
+    while ((opt = getopt(argc, argv, "a:e:f:hj:k:o:qt:vX")) != -1) {
+        switch (opt) {
+        case 'a':
+            airpods_path = optarg;
+            break;
+        case 'e':
+            if (scan.column_count == MAX_COLUMNS) {
+                fprintf(stderr, "continuity-scan: at most %d -e fields\n", MAX_COLUMNS);
+                return 1;
+            }
+            columns[scan.column_count++].name = optarg;
+            break;
+        case 'f':
+            if (scan.filter_count == MAX_FILTERS) {
+                fprintf(stderr, "continuity-scan: at most %d -f filters\n", MAX_FILTERS);
+                return 1;
+            }
+            if (parse_filter(optarg, &filters[scan.filter_count++]) < 0) {
+                fprintf(stderr, "continuity-scan: bad filter %s\n", optarg);
+                usage(stderr);
+                return 1;
+            }
+            break;
+        case 'j':
+            errno = 0;
+            v = strtoul(optarg, &end, 10);
+            if (errno || end == optarg || *end || v > MAX_THREADS) {
+                fprintf(stderr, "continuity-scan: -j takes 0 to %d threads\n", MAX_THREADS);
+                return 1;
+            }
+            scan.threads = (unsigned)v;
+            if (v == 0) {
+                long    cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+                scan.threads = cores < 1 ? 1 : cores > MAX_THREADS ? MAX_THREADS : (unsigned)cores;
+            }
+            break;
+        case 'k':
+            homekit_path = optarg;
+            break;
+        case 'o':
+            out_dir = optarg;
+            break;
+        case 'q':
+            scan.quiet = true;
+            break;
+        case 't':
+            timeline_path = optarg;
+            break;
+        case 'v':
+            scan.verbose = true;
+            break;
+        case 'X':
+            scan.write_index = true;
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 1;
+        }
+    }
+    if (optind == argc) {
+        usage(stderr);
+        return 1;
+    }
+    if ((timeline_path || airpods_path || homekit_path) && out_dir) {
+        fprintf(stderr, "continuity-scan: -t, -a and -k cannot be used with -o\n");
+        return 1;
+    }
+    if (timeline_path || airpods_path) {
+        continuity_timeline_init(&timeline);
+        scan.timeline = &timeline;
+    }
+    if (homekit_path) {
+        if (continuity_homekit_init(&homekit, 1024) < 0) {
+            fprintf(stderr, "continuity-scan: out of memory\n");
+            return 1;
+        }
+        scan.homekit = &homekit;
+    }
+
+    for (i = optind; i < argc; i++) {
+        struct stat st;
+
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (add_dir(&files, argv[i]) < 0)
+                return 1;
+        } else if (add_path(&files, strdup(argv[i])) < 0) {
+            fprintf(stderr, "continuity-scan: out of memory\n");
+            return 1;
+        }
+    }
+    if (files.count == 0) {
+        fprintf(stderr, "continuity-scan: no files to scan\n");
+        return 1;
+    }
+
+    setvbuf(stdout, stdout_buf, _IOFBF, sizeof(stdout_buf));
+
+    start = now_ns();
+    if (out_dir) {
+        if (scan_batch(&scan, out_dir, files.paths, files.count) < 0)
+            ret = 1;
+    } else {
+        for (f = 0; f < files.count; f++) {
+            scan.file_prefix = files.count > 1 ? files.paths[f] : NULL;
+            errno = 0;
+            if (scan_file(&scan, files.paths[f]) < 0)
+                ret = 1;
+        }
+    }
+    elapsed = (double)(now_ns() - start) / 1e9;
+
+    if (scan.track_oom) {
+        fprintf(stderr, "continuity-scan: out of memory tracking devices\n");
+        ret = 1;
+    } else {
+        if (timeline_path && write_timeline(timeline_path, &timeline) < 0)
+            ret = 1;
+        if (airpods_path && write_airpods(airpods_path, &timeline) < 0)
+            ret = 1;
+        if (homekit_path && write_homekit(homekit_path, &homekit) < 0)
+            ret = 1;
+    }
+
+    if (scan.quiet || scan.verbose) {
+        FILE   *out = scan.quiet ? stdout : stderr;
+
+        fprintf(out, "packets %" PRIu64 ", adverts %" PRIu64 ", apple %" PRIu64
+                ", messages %" PRIu64 ", fields %" PRIu64 "\n",
+                scan.packets, scan.adverts, scan.apple, scan.messages, scan.fields);
+        if (scan.verbose)
+            fprintf(stderr, "%.3f s, %.1f MB/s, %.0f packets/s\n", elapsed,
+                    elapsed > 0 ? (double)scan.bytes / 1e6 / elapsed : 0.0,
+                    elapsed > 0 ? (double)scan.packets / elapsed : 0.0);
+    }
+
+    if (fflush(stdout) != 0)
+        ret = 1;
+    for (f = 0; f < files.count; f++)
+        free(files.paths[f]);
+    free(files.paths);
+    continuity_timeline_free(&timeline);
+    continuity_homekit_free(&homekit);
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,158 @@
+/* deque.c
+ * Work-stealing deque of pointers (Chase-Lev)
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdlib.h>
+
+#include "deque.h"
+
+static wsdeque_array_t *
+new_array(size_t size)
+{
+    wsdeque_array_t    *a = malloc(sizeof(*a) + size * sizeof(a->items[0]));
+    size_t              i;
+
+    if (!a)
+        return NULL;
+    a->size  = size;
+    a->older = NULL;
+    for (i = 0; i < size; i++)
+        atomic_init(&a->items[i], NULL);
+
+    return a;
+}
+
+static void *
+get(wsdeque_array_t *a, long long i)
+{
+    return atomic_load_explicit(&a->items[(size_t)i & (a->size - 1)], memory_order_relaxed);
+}
+
+static void
+put(wsdeque_array_t *a, long long i, void *item)
+{
+    atomic_store_explicit(&a->items[(size_t)i & (a->size - 1)], item, memory_order_relaxed);
+}
+
+int
+wsdeque_init(wsdeque_t *q, size_t capacity)
+{
+    size_t              size = 16;
+    wsdeque_array_t    *a;
+
+    while (size < capacity)
+        size <<= 1;
+    if (!(a = new_array(size)))
+        return -1;
+    atomic_init(&q->top, 0);
+    atomic_init(&q->bottom, 0);
+    atomic_init(&q->array, a);
+
+    return 0;
+}
+
+int
+wsdeque_push(wsdeque_t *q, void *item)
+{
+    long long           b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long long           t = atomic_load_explicit(&q->top, memory_order_acquire);
+    wsdeque_array_t    *a = atomic_load_explicit(&q->array, memory_order_relaxed);
+
+    if (b - t > (long long)a->size - 1) {
+        wsdeque_array_t    *bigger = new_array(2 * a->size);
+        long long           i;
+
+        if (!bigger)
+            return -1;
+        for (i = t; i < b; i++)
+            put(bigger, i, get(a, i));
+        bigger->older = a;
+        atomic_store_explicit(&q->array, bigger, memory_order_release);
+        a = bigger;
+    }
+    put(a, b, item);
+    /* A release store rather than a release fence and a relaxed store:
+     * the same ordering, but one ThreadSanitizer understands */
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_release);
+
+    return 0;
+}
+
+void *
+wsdeque_pop(wsdeque_t *q)
+{
+    long long           b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    wsdeque_array_t    *a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    long long           t;
+    void               *item = NULL;
+
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+    if (t <= b) {
+        item = get(a, b);
+        if (t == b) {
+            /* The last entry: a thief may be after it too */
+            if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                        memory_order_seq_cst, memory_order_relaxed))
+                item = NULL;
+            atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return item;
+}
+
+void *
+wsdeque_steal(wsdeque_t *q)
+{
+    long long           t = atomic_load_explicit(&q->top, memory_order_acquire);
+    long long           b;
+    wsdeque_array_t    *a;
+    void               *item;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+
+    a    = atomic_load_explicit(&q->array, memory_order_acquire);
+    item = get(a, t);
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+
+    return item;
+}
+
+void
+wsdeque_free(wsdeque_t *q)
+{
+    wsdeque_array_t    *a = atomic_load(&q->array);
+
+    while (a) {
+        wsdeque_array_t    *older = a->older;
+
+        free(a);
+        a = older;
+    }
+    atomic_store(&q->array, NULL);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
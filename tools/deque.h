@@ -0,0 +1,74 @@
+/* deque.h
+ * Work-stealing deque of pointers (Chase-Lev)
+ *
+ * Each worker thread owns one deque.  The owner pushes and pops at the
+ * bottom, last in first out, so it keeps working on what it just made;
+ * other threads steal from the top, taking the oldest entries.  Only a
+ * steal racing the owner for the last entry needs a compare-and-swap.
+ * The array doubles when full; the arrays it outgrows are kept until
+ * wsdeque_free(), since a thief may still be reading one.
+ *
+ * See Chase and Lev, "Dynamic Circular Work-Stealing Deque" (SPAA 2005),
+ * and Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (PPoPP 2013), whose C11 orderings this follows.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __DEQUE_H__
+#define __DEQUE_H__
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct wsdeque_array {
+    size_t                  size;       /* a power of two */
+    struct wsdeque_array   *older;      /* outgrown, freed with the deque */
+    _Atomic(void *)         items[];
+} wsdeque_array_t;
+
+typedef struct {
+    atomic_llong                top;
+    char                        pad[64];
+    atomic_llong                bottom;
+    _Atomic(wsdeque_array_t *)  array;
+} wsdeque_t;
+
+/* Returns 0, or -1 if the array cannot be allocated. */
+int wsdeque_init(wsdeque_t *q, size_t capacity);
+
+/* Owner only.  Returns 0, or -1 if the deque is full and cannot grow. */
+int wsdeque_push(wsdeque_t *q, void *item);
+
+/* Owner only.  Returns NULL when the deque is empty. */
+void *wsdeque_pop(wsdeque_t *q);
+
+/* Any thread.  Returns NULL when the deque is empty or another thread
+ * took the entry first. */
+void *wsdeque_steal(wsdeque_t *q);
+
+void wsdeque_free(wsdeque_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DEQUE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
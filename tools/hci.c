@@ -0,0 +1,304 @@
+/* hci.c
+ * Host advertising data from Bluetooth HCI logs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <string.h>
+
+#include "capfile.h"
+#include "hci.h"
+
+/* LINKTYPE_BLUETOOTH_HCI_H4_WITH_PHDR direction, big-endian */
+#define PHDR_LEN                        4
+#define PHDR_DIRECTION_RECEIVED         0x00000001
+
+/* btsnoop record flags */
+#define BTSNOOP_FLAG_RECEIVED           0x01
+#define BTSNOOP_FLAG_COMMAND_EVENT      0x02
+
+/* PacketLogger packet types */
+#define PKLG_COMMAND                    0x00
+#define PKLG_EVENT                      0x01
+#define PKLG_ACL_SENT                   0x02
+#define PKLG_ACL_RECEIVED               0x03
+
+#define OP_READ_BD_ADDR                 0x1009
+#define OP_LE_SET_RANDOM_ADDRESS        0x2005
+#define OP_LE_SET_ADV_PARAMETERS        0x2006
+#define OP_LE_SET_ADV_DATA              0x2008
+#define OP_LE_SET_SCAN_RSP_DATA         0x2009
+#define OP_LE_SET_ADV_SET_RANDOM_ADDR   0x2035
+#define OP_LE_SET_EXT_ADV_PARAMETERS    0x2036
+#define OP_LE_SET_EXT_ADV_DATA          0x2037
+#define OP_LE_SET_EXT_SCAN_RSP_DATA     0x2038
+#define OP_LE_REMOVE_ADV_SET            0x203c
+#define OP_LE_CLEAR_ADV_SETS            0x203d
+
+#define EVT_COMMAND_COMPLETE            0x0e
+
+/* Set Extended Advertising and Scan Response Data operations */
+enum {
+    EXT_OP_INTERMEDIATE = 0,
+    EXT_OP_FIRST        = 1,
+    EXT_OP_LAST         = 2,
+    EXT_OP_COMPLETE     = 3,
+    EXT_OP_UNCHANGED    = 4
+};
+
+bool
+hci_packet(uint32_t linktype, uint32_t flags, const uint8_t *data, size_t len,
+        hci_packet_t *pkt)
+{
+    switch (linktype) {
+    case LINKTYPE_BLUETOOTH_HCI_H4:
+        /* Plain H4 carries no direction; btsnoop sets it in the flags */
+        if (len < 1)
+            return false;
+        pkt->type     = data[0];
+        pkt->received = (flags & BTSNOOP_FLAG_RECEIVED) || data[0] == HCI_EVENT;
+        pkt->data     = data + 1;
+        pkt->len      = len - 1;
+        return true;
+    case LINKTYPE_BLUETOOTH_HCI_H4_WITH_PHDR:
+        if (len < PHDR_LEN + 1)
+            return false;
+        pkt->type     = data[PHDR_LEN];
+        pkt->received = (data[PHDR_LEN - 1] & PHDR_DIRECTION_RECEIVED) != 0;
+        pkt->data     = data + PHDR_LEN + 1;
+        pkt->len      = len - PHDR_LEN - 1;
+        return true;
+    case CAPFILE_LINKTYPE_BTSNOOP_H1:
+        pkt->received = (flags & BTSNOOP_FLAG_RECEIVED) != 0;
+        if (flags & BTSNOOP_FLAG_COMMAND_EVENT)
+            pkt->type = pkt->received ? HCI_EVENT : HCI_COMMAND;
+        else
+            pkt->type = HCI_ACL;
+        pkt->data     = data;
+        pkt->len      = len;
+        return true;
+    case CAPFILE_LINKTYPE_PACKETLOGGER:
+        switch (flags) {
+        case PKLG_COMMAND:      pkt->type = HCI_COMMAND; pkt->received = false; break;
+        case PKLG_EVENT:        pkt->type = HCI_EVENT;   pkt->received = true;  break;
+        case PKLG_ACL_SENT:     pkt->type = HCI_ACL;     pkt->received = false; break;
+        case PKLG_ACL_RECEIVED: pkt->type = HCI_ACL;     pkt->received = true;  break;
+        default:
+            return false;
+        }
+        pkt->data     = data;
+        pkt->len      = len;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void
+hci_adv_init(hci_adv_state_t *st)
+{
+    memset(st, 0, sizeof(*st));
+}
+
+/* HCI sends BD_ADDRs least significant byte first */
+static void
+copy_addr(uint8_t out[6], const uint8_t *in)
+{
+    int i;
+
+    for (i = 0; i < 6; i++)
+        out[i] = in[5 - i];
+}
+
+static hci_adv_set_t *
+find_set(hci_adv_state_t *st, uint8_t handle, bool create)
+{
+    hci_adv_set_t  *free_set = NULL;
+    int             i;
+
+    for (i = 0; i < HCI_ADV_SETS; i++) {
+        hci_adv_set_t  *set = &st->sets[i];
+
+        if (set->used && set->handle == handle)
+            return set;
+        if (!set->used && !free_set)
+            free_set = set;
+    }
+    if (!create || !free_set)
+        return NULL;
+
+    memset(free_set, 0, sizeof(*free_set));
+    free_set->used   = true;
+    free_set->handle = handle;
+
+    return free_set;
+}
+
+static void
+fill_adv(btle_adv_t *adv, uint8_t pdu_type, bool random, const uint8_t random_addr[6],
+        const uint8_t public_addr[6], const uint8_t *ad, size_t ad_len)
+{
+    adv->pdu_type = pdu_type;
+    adv->random   = random;
+    memcpy(adv->addr, random ? random_addr : public_addr, 6);
+    adv->ad       = ad;
+    adv->ad_len   = ad_len;
+    adv->channel  = -1;
+    adv->has_rssi = false;
+    adv->rssi     = 0;
+}
+
+/* Legacy LE Set Advertising Data and Set Scan Response Data */
+static bool
+legacy_data(hci_adv_state_t *st, uint16_t opcode, const uint8_t *p, size_t plen,
+        btle_adv_t *adv)
+{
+    size_t  len;
+
+    if (plen < 1)
+        return false;
+    len = p[0];
+    if (len > BTLE_LEGACY_AD_MAX || len > plen - 1)
+        return false;
+    memcpy(st->ad, p + 1, len);
+
+    fill_adv(adv, opcode == OP_LE_SET_ADV_DATA ? BTLE_ADV_IND : BTLE_SCAN_RSP,
+            st->random, st->random_addr, st->public_addr, st->ad, len);
+
+    return true;
+}
+
+/* LE Set Extended Advertising Data and Set Extended Scan Response Data,
+ * which a host may split over several commands */
+static bool
+extended_data(hci_adv_state_t *st, uint16_t opcode, const uint8_t *p, size_t plen,
+        btle_adv_t *adv)
+{
+    hci_adv_set_t  *set;
+    uint8_t        *buf;
+    size_t         *buf_len;
+    size_t          len;
+    uint8_t         op;
+
+    if (plen < 4)
+        return false;
+    op  = p[1];
+    len = p[3];
+    if (len > plen - 4 || op == EXT_OP_UNCHANGED)
+        return false;
+    if (!(set = find_set(st, p[0], true)))
+        return false;
+
+    if (opcode == OP_LE_SET_EXT_ADV_DATA) {
+        buf     = set->ad;
+        buf_len = &set->ad_len;
+    } else {
+        buf     = set->scan;
+        buf_len = &set->scan_len;
+    }
+
+    if (op == EXT_OP_FIRST || op == EXT_OP_COMPLETE)
+        *buf_len = 0;
+    /* A fragment that would overflow is dropped; the rest still completes */
+    if (len <= HCI_EXT_AD_MAX - *buf_len) {
+        memcpy(buf + *buf_len, p + 4, len);
+        *buf_len += len;
+    }
+    if (op != EXT_OP_LAST && op != EXT_OP_COMPLETE)
+        return false;
+
+    fill_adv(adv, opcode == OP_LE_SET_EXT_ADV_DATA ? BTLE_ADV_IND : BTLE_SCAN_RSP,
+            set->random && set->has_random, set->random_addr, st->public_addr,
+            buf, *buf_len);
+
+    return true;
+}
+
+static bool
+command(hci_adv_state_t *st, const uint8_t *data, size_t len, btle_adv_t *adv)
+{
+    const uint8_t  *p;
+    hci_adv_set_t  *set;
+    uint16_t        opcode;
+    size_t          plen;
+
+    if (len < 3)
+        return false;
+    opcode = (uint16_t)(data[0] | data[1] << 8);
+    plen   = data[2];
+    p      = data + 3;
+    if (plen > len - 3)
+        return false;
+
+    switch (opcode) {
+    case OP_LE_SET_RANDOM_ADDRESS:
+        if (plen >= 6)
+            copy_addr(st->random_addr, p);
+        return false;
+    case OP_LE_SET_ADV_PARAMETERS:
+        if (plen >= 6)
+            st->random = p[5] != 0;
+        return false;
+    case OP_LE_SET_ADV_DATA:
+    case OP_LE_SET_SCAN_RSP_DATA:
+        return legacy_data(st, opcode, p, plen, adv);
+    case OP_LE_SET_ADV_SET_RANDOM_ADDR:
+        if (plen >= 7 && (set = find_set(st, p[0], true))) {
+            copy_addr(set->random_addr, p + 1);
+            set->has_random = true;
+        }
+        return false;
+    case OP_LE_SET_EXT_ADV_PARAMETERS:
+        if (plen >= 11 && (set = find_set(st, p[0], true)))
+            set->random = p[10] != 0;
+        return false;
+    case OP_LE_SET_EXT_ADV_DATA:
+    case OP_LE_SET_EXT_SCAN_RSP_DATA:
+        return extended_data(st, opcode, p, plen, adv);
+    case OP_LE_REMOVE_ADV_SET:
+        if (plen >= 1 && (set = find_set(st, p[0], false)))
+            set->used = false;
+        return false;
+    case OP_LE_CLEAR_ADV_SETS:
+        memset(st->sets, 0, sizeof(st->sets));
+        return false;
+    default:
+        return false;
+    }
+}
+
+/* Command Complete for Read BD_ADDR: num packets, opcode, status, BD_ADDR */
+static void
+event(hci_adv_state_t *st, const uint8_t *data, size_t len)
+{
+    if (len < 12 || data[0] != EVT_COMMAND_COMPLETE || data[1] < 10)
+        return;
+    if ((data[3] | data[4] << 8) != OP_READ_BD_ADDR || data[5] != 0)
+        return;
+
+    copy_addr(st->public_addr, data + 6);
+}
+
+bool
+hci_adv_packet(hci_adv_state_t *st, const hci_packet_t *pkt, btle_adv_t *adv)
+{
+    if (pkt->type == HCI_COMMAND && !pkt->received)
+        return command(st, pkt->data, pkt->len, adv);
+    if (pkt->type == HCI_EVENT)
+        event(st, pkt->data, pkt->len);
+
+    return false;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,104 @@
+/* hci.h
+ * Host advertising data from Bluetooth HCI logs
+ *
+ * A host hands its advertising data to the controller with the LE Set
+ * Advertising Data, Set Scan Response Data and their extended counterparts,
+ * so a device's own adverts can be recovered from an HCI log.  The tracker
+ * follows the commands that set the advertiser address and reassembles
+ * fragmented extended data, and hands each completed set of AD structures
+ * back as a btle_adv_t.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __HCI_H__
+#define __HCI_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "btle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINKTYPE_BLUETOOTH_HCI_H4           187
+#define LINKTYPE_BLUETOOTH_HCI_H4_WITH_PHDR 201
+
+/* H4 packet indicators */
+enum {
+    HCI_COMMAND = 0x01,
+    HCI_ACL     = 0x02,
+    HCI_SCO     = 0x03,
+    HCI_EVENT   = 0x04,
+    HCI_ISO     = 0x05
+};
+
+/* Largest extended advertising data a host can set */
+#define HCI_EXT_AD_MAX      1650
+/* Advertising sets followed at once; more are dropped */
+#define HCI_ADV_SETS        4
+
+typedef struct {
+    uint8_t         type;           /* HCI_COMMAND etc. */
+    bool            received;       /* controller to host */
+    const uint8_t  *data;           /* after the packet indicator */
+    size_t          len;
+} hci_packet_t;
+
+typedef struct {
+    bool            used;
+    uint8_t         handle;
+    bool            random;         /* own address type is not public */
+    bool            has_random;
+    uint8_t         random_addr[6];
+    size_t          ad_len;
+    size_t          scan_len;
+    uint8_t         ad[HCI_EXT_AD_MAX];
+    uint8_t         scan[HCI_EXT_AD_MAX];
+} hci_adv_set_t;
+
+typedef struct {
+    uint8_t         public_addr[6]; /* from Read BD_ADDR, zero until seen */
+    /* legacy advertising */
+    bool            random;
+    uint8_t         random_addr[6];
+    uint8_t         ad[BTLE_LEGACY_AD_MAX];
+    /* extended advertising */
+    hci_adv_set_t   sets[HCI_ADV_SETS];
+} hci_adv_state_t;
+
+/* Pick the HCI packet out of a record of linktype 187 or 201, or of a
+ * btsnoop or PacketLogger record (capfile.h linktypes, whose flags say
+ * what the record holds).  Returns false for anything else. */
+bool hci_packet(uint32_t linktype, uint32_t flags, const uint8_t *data, size_t len,
+        hci_packet_t *pkt);
+
+void hci_adv_init(hci_adv_state_t *st);
+
+/* Feed one HCI packet to the tracker.  Returns true when it completes a set
+ * of advertising or scan response data; adv then describes it as an
+ * ADV_IND or SCAN_RSP whose AD points into st or pkt, valid until the next
+ * call.  The channel is -1 and there is no RSSI. */
+bool hci_adv_packet(hci_adv_state_t *st, const hci_packet_t *pkt, btle_adv_t *adv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HCI_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,122 @@
+/* pcapng.c
+ * Minimal pcapng writer: one section, one interface, Enhanced Packet Blocks
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <string.h>
+
+#include "pcapng.h"
+
+#define BLOCK_SHB               0x0a0d0d0a
+#define BLOCK_IDB               0x00000001
+#define BLOCK_EPB               0x00000006
+#define BYTE_ORDER_MAGIC        0x1a2b3c4d
+
+#define OPT_ENDOFOPT            0
+#define OPT_COMMENT             1
+
+#define PAD4(n)                 (((n) + 3u) & ~3u)
+
+static int
+put(pcapng_writer_t *w, const void *data, size_t len)
+{
+    if (len && fwrite(data, 1, len, w->f) != len)
+        return -1;
+    w->bytes += len;
+
+    return 0;
+}
+
+int
+pcapng_open(pcapng_writer_t *w, FILE *f, uint32_t linktype, uint32_t snaplen)
+{
+    uint32_t    shb[7];
+    uint32_t    idb[5];
+
+    w->f       = f;
+    w->bytes   = 0;
+    w->packets = 0;
+
+    shb[0] = BLOCK_SHB;
+    shb[1] = sizeof(shb);
+    shb[2] = BYTE_ORDER_MAGIC;
+    shb[3] = 1;                 /* major 1, minor 0 */
+    shb[4] = 0xffffffff;        /* section length unknown */
+    shb[5] = 0xffffffff;
+    shb[6] = sizeof(shb);
+
+    idb[0] = BLOCK_IDB;
+    idb[1] = sizeof(idb);
+    idb[2] = linktype & 0xffff; /* reserved half stays 0 */
+    idb[3] = snaplen;
+    idb[4] = sizeof(idb);
+
+    if (put(w, shb, sizeof(shb)) < 0 || put(w, idb, sizeof(idb)) < 0)
+        return -1;
+
+    return 0;
+}
+
+int
+pcapng_write(pcapng_writer_t *w, uint64_t ts_usec, const uint8_t *data,
+        uint32_t len, uint32_t orig_len)
+{
+    return pcapng_write_comment(w, ts_usec, data, len, orig_len, NULL);
+}
+
+int
+pcapng_write_comment(pcapng_writer_t *w, uint64_t ts_usec, const uint8_t *data,
+        uint32_t len, uint32_t orig_len, const char *comment)
+{
+    static const uint8_t pad[3];
+    static const uint16_t opt_end[2] = { OPT_ENDOFOPT, 0 };
+    uint32_t    hdr[7];
+    uint16_t    opt[2];
+    size_t      comment_len = comment ? strlen(comment) : 0;
+    uint32_t    total;
+
+    if (comment_len > 0xffff)
+        comment_len = 0xffff;
+    total = (uint32_t)sizeof(hdr) + PAD4(len) + 4;
+    if (comment_len)
+        total += (uint32_t)(sizeof(opt) + PAD4(comment_len) + sizeof(opt_end));
+
+    hdr[0] = BLOCK_EPB;
+    hdr[1] = total;
+    hdr[2] = 0;                 /* interface 0 */
+    hdr[3] = (uint32_t)(ts_usec >> 32);
+    hdr[4] = (uint32_t)ts_usec;
+    hdr[5] = len;
+    hdr[6] = orig_len;
+
+    if (put(w, hdr, sizeof(hdr)) < 0 || put(w, data, len) < 0 ||
+            put(w, pad, PAD4(len) - len) < 0)
+        return -1;
+    if (comment_len) {
+        opt[0] = OPT_COMMENT;
+        opt[1] = (uint16_t)comment_len;
+        if (put(w, opt, sizeof(opt)) < 0 || put(w, comment, comment_len) < 0 ||
+                put(w, pad, PAD4(comment_len) - comment_len) < 0 ||
+                put(w, opt_end, sizeof(opt_end)) < 0)
+            return -1;
+    }
+    if (put(w, &total, sizeof(total)) < 0)
+        return -1;
+    w->packets++;
+
+    return 0;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
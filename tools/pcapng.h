@@ -0,0 +1,57 @@
+/* pcapng.h
+ * Minimal pcapng writer: one section, one interface, Enhanced Packet Blocks
+ *
+ * Blocks are written in host byte order with microsecond timestamps, which
+ * every pcapng reader accepts.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __PCAPNG_H__
+#define __PCAPNG_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    FILE       *f;
+    uint64_t    bytes;      /* written to f so far */
+    uint64_t    packets;
+} pcapng_writer_t;
+
+/* Start a file on f: Section Header Block, then one Interface Description
+ * Block for linktype.  Returns 0, or -1 on a write error. */
+int pcapng_open(pcapng_writer_t *w, FILE *f, uint32_t linktype, uint32_t snaplen);
+
+/* Append one packet; ts_usec is microseconds since the epoch and orig_len
+ * the length on the wire.  Returns 0, or -1 on a write error. */
+int pcapng_write(pcapng_writer_t *w, uint64_t ts_usec, const uint8_t *data,
+        uint32_t len, uint32_t orig_len);
+
+/* The same, with comment (UTF-8, at most 65535 bytes) attached as the
+ * packet's opt_comment; Wireshark shows it as a packet comment. */
+int pcapng_write_comment(pcapng_writer_t *w, uint64_t ts_usec, const uint8_t *data,
+        uint32_t len, uint32_t orig_len, const char *comment);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PCAPNG_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,177 @@
+/* ring.c
+ * Bounded lock-free rings of pointers between threads
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring.h"
+
+static size_t
+round_up_pow2(size_t n)
+{
+    size_t  p = 1;
+
+    while (p < n)
+        p <<= 1;
+
+    return p;
+}
+
+int
+ring_spsc_init(ring_spsc_t *r, size_t capacity)
+{
+    size_t  n = round_up_pow2(capacity ? capacity : 1);
+
+    memset(r, 0, sizeof(*r));
+    r->slots = calloc(n, sizeof(*r->slots));
+    if (!r->slots)
+        return -1;
+    r->mask = n - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+
+    return 0;
+}
+
+bool
+ring_spsc_push(ring_spsc_t *r, void *item)
+{
+    size_t  tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&r->head, memory_order_acquire) > r->mask)
+        return false;
+    r->slots[tail & r->mask] = item;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+void *
+ring_spsc_pop(ring_spsc_t *r)
+{
+    size_t  head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    void   *item;
+
+    if (head == atomic_load_explicit(&r->tail, memory_order_acquire))
+        return NULL;
+    item = r->slots[head & r->mask];
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+    return item;
+}
+
+size_t
+ring_spsc_depth(ring_spsc_t *r)
+{
+    size_t  head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t  tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    return tail - head > r->mask + 1 ? 0 : tail - head;
+}
+
+void
+ring_spsc_free(ring_spsc_t *r)
+{
+    free(r->slots);
+    r->slots = NULL;
+}
+
+/* A cell is free for the push at position pos when its sequence equals
+ * pos, and holds that push's item once the sequence reaches pos + 1; the
+ * pop moves it on to pos + capacity for the next lap. */
+int
+ring_mpsc_init(ring_mpsc_t *r, size_t capacity)
+{
+    size_t  n = round_up_pow2(capacity ? capacity : 1);
+    size_t  i;
+
+    memset(r, 0, sizeof(*r));
+    r->cells = calloc(n, sizeof(*r->cells));
+    if (!r->cells)
+        return -1;
+    for (i = 0; i < n; i++)
+        atomic_init(&r->cells[i].seq, i);
+    r->mask = n - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+
+    return 0;
+}
+
+bool
+ring_mpsc_push(ring_mpsc_t *r, void *item)
+{
+    size_t          pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    ring_cell_t    *cell;
+
+    for (;;) {
+        size_t      seq;
+        intptr_t    diff;
+
+        cell = &r->cells[pos & r->mask];
+        seq  = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1,
+                        memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;       /* a full lap behind: the ring is full */
+        } else {
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        }
+    }
+    cell->item = item;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return true;
+}
+
+void *
+ring_mpsc_pop(ring_mpsc_t *r)
+{
+    size_t          pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    ring_cell_t    *cell = &r->cells[pos & r->mask];
+    void           *item;
+
+    if (atomic_load_explicit(&cell->seq, memory_order_acquire) != pos + 1)
+        return NULL;
+    item = cell->item;
+    atomic_store_explicit(&cell->seq, pos + r->mask + 1, memory_order_release);
+    atomic_store_explicit(&r->head, pos + 1, memory_order_relaxed);
+
+    return item;
+}
+
+size_t
+ring_mpsc_depth(ring_mpsc_t *r)
+{
+    size_t  head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t  tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    return tail - head > r->mask + 1 ? 0 : tail - head;
+}
+
+void
+ring_mpsc_free(ring_mpsc_t *r)
+{
+    free(r->cells);
+    r->cells = NULL;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,85 @@
+/* ring.h
+ * Bounded lock-free rings of pointers between threads
+ *
+ * An SPSC ring has one producer and one consumer thread and costs a load
+ * and a store per operation.  An MPSC ring takes any number of producers
+ * and one consumer; each slot carries a sequence number, so producers
+ * claim slots with a compare-and-swap and never wait on one another.
+ * Neither ring blocks: a push to a full ring and a pop from an empty one
+ * fail, and the caller decides whether to drop, wait or do something else.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Keeps the producer and consumer indexes out of each other's cache line */
+#define RING_CACHE_LINE     64
+
+typedef struct {
+    void          **slots;
+    size_t          mask;
+    char            pad0[RING_CACHE_LINE];
+    atomic_size_t   head;           /* next slot to pop, consumer side */
+    char            pad1[RING_CACHE_LINE];
+    atomic_size_t   tail;           /* next slot to push, producer side */
+    char            pad2[RING_CACHE_LINE];
+} ring_spsc_t;
+
+typedef struct {
+    atomic_size_t   seq;
+    void           *item;
+} ring_cell_t;
+
+typedef struct {
+    ring_cell_t    *cells;
+    size_t          mask;
+    char            pad0[RING_CACHE_LINE];
+    atomic_size_t   head;
+    char            pad1[RING_CACHE_LINE];
+    atomic_size_t   tail;
+    char            pad2[RING_CACHE_LINE];
+} ring_mpsc_t;
+
+/* Room for at least capacity items, rounded up to a power of two.
+ * Returns 0, or -1 if the slots cannot be allocated. */
+int ring_spsc_init(ring_spsc_t *r, size_t capacity);
+bool ring_spsc_push(ring_spsc_t *r, void *item);
+void *ring_spsc_pop(ring_spsc_t *r);
+/* Items queued; from a third thread this is only an estimate */
+size_t ring_spsc_depth(ring_spsc_t *r);
+void ring_spsc_free(ring_spsc_t *r);
+
+int ring_mpsc_init(ring_mpsc_t *r, size_t capacity);
+bool ring_mpsc_push(ring_mpsc_t *r, void *item);
+void *ring_mpsc_pop(ring_mpsc_t *r);
+size_t ring_mpsc_depth(ring_mpsc_t *r);
+void ring_mpsc_free(ring_mpsc_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RING_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
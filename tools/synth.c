@@ -0,0 +1,262 @@
+/* synth.c
+ * Synthetic Apple Continuity messages
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <string.h>
+
+#include "synth.h"
+
+#define ARRAY_LEN(a)    (sizeof(a) / sizeof((a)[0]))
+
+const uint8_t synth_types[SYNTH_TYPE_COUNT] = {
+    CONTINUITY_TYPE_AIRPRINT,
+    CONTINUITY_TYPE_AIRDROP,
+    CONTINUITY_TYPE_HOMEKIT,
+    CONTINUITY_TYPE_AIRPODS,
+    CONTINUITY_TYPE_HEY_SIRI,
+    CONTINUITY_TYPE_AIRPLAY_TARGET,
+    CONTINUITY_TYPE_AIRPLAY_SOURCE,
+    CONTINUITY_TYPE_MAGIC_SWITCH,
+    CONTINUITY_TYPE_HANDOFF,
+    CONTINUITY_TYPE_TETHERING_TARGET,
+    CONTINUITY_TYPE_TETHERING_SOURCE,
+    CONTINUITY_TYPE_NEARBY_ACTION,
+    CONTINUITY_TYPE_NEARBY_INFO,
+    CONTINUITY_TYPE_FINDMY
+};
+
+/* Observed field values, see the value_strings in the plugin */
+static const uint16_t airpods_models[] = { 0x0220, 0x0f20, 0x0e20, 0x0320, 0x0520, 0x0620 };
+static const uint8_t airpods_status[] = { 0x2b, 0x0b, 0x01, 0x21, 0x02, 0x22, 0x75, 0x55, 0x03, 0x23, 0x33, 0x13 };
+static const uint8_t siri_classes[] = { 0x02, 0x03, 0x07, 0x09, 0x0a };
+static const uint8_t wrist_confidence[] = { 0x03, 0x1f, 0x3f };
+static const uint8_t nearbyaction_types[] = { 0x01, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x13, 0x14 };
+static const uint8_t setup_classes[] = { 0x2, 0x4, 0x6, 0x8, 0xa, 0xc, 0xe };
+static const uint8_t findmy_status[] = { 0x00, 0xe4, 0xa4, 0x64, 0x24 };
+static const uint16_t homekit_categories[] = { 0x0200, 0x0500, 0x0600, 0x0700, 0x0800, 0x0900, 0x0a00 };
+
+#define PICK(rng, a)    ((a)[synth_next(rng) % ARRAY_LEN(a)])
+
+void
+synth_seed(synth_rng_t *rng, uint64_t seed)
+{
+    rng->state = seed ? seed : 0x9e3779b97f4a7c15ULL;
+}
+
+uint32_t
+synth_next(synth_rng_t *rng)
+{
+    uint64_t    x = rng->state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+
+    return (uint32_t)((x * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static void
+fill(synth_rng_t *rng, uint8_t *out, size_t len)
+{
+    size_t  i;
+
+    for (i = 0; i < len; i++)
+        out[i] = (uint8_t)synth_next(rng);
+}
+
+static uint8_t
+battery_nibble(synth_rng_t *rng)
+{
+    /* 0-10 in steps of 10%, 15 when the part is not reporting */
+    uint32_t    r = synth_next(rng) % 12;
+
+    return (uint8_t)(r == 11 ? 0x0f : r);
+}
+
+size_t
+synth_value(uint8_t type, synth_rng_t *rng, uint8_t *out)
+{
+    uint16_t    u16;
+    size_t      len;
+
+    switch (type) {
+    case CONTINUITY_TYPE_AIRPRINT:
+        out[0] = (uint8_t)(synth_next(rng) & 0x01);
+        out[1] = (uint8_t)(synth_next(rng) & 0x01);
+        out[2] = (uint8_t)(synth_next(rng) & 0x03);
+        out[3] = 0x02;
+        out[4] = 0x77;              /* port 631 */
+        memset(out + 5, 0, 10);
+        out[15] = 0xff;
+        out[16] = 0xff;
+        fill(rng, out + 17, 4);     /* IPv4-mapped address */
+        out[21] = 0xc5;
+        return 22;
+    case CONTINUITY_TYPE_AIRDROP:
+        memset(out, 0, 8);
+        out[8] = 0x01;
+        fill(rng, out + 9, 8);
+        out[17] = 0x00;
+        return 18;
+    case CONTINUITY_TYPE_HOMEKIT:
+        out[0] = 0x31;
+        fill(rng, out + 1, 6);
+        u16 = PICK(rng, homekit_categories);
+        out[7] = (uint8_t)(u16 >> 8);
+        out[8] = (uint8_t)u16;
+        fill(rng, out + 9, 2);
+        out[11] = (uint8_t)(1 + synth_next(rng) % 8);
+        out[12] = 0x02;
+        return 13;
+    case CONTINUITY_TYPE_AIRPODS:
+        out[0] = 0x01;
+        u16 = PICK(rng, airpods_models);
+        out[1] = (uint8_t)(u16 >> 8);
+        out[2] = (uint8_t)u16;
+        out[3] = PICK(rng, airpods_status);
+        out[4] = (uint8_t)(battery_nibble(rng) << 4 | battery_nibble(rng));
+        out[5] = (uint8_t)((synth_next(rng) & 0x70) | battery_nibble(rng));
+        out[6] = (uint8_t)synth_next(rng);
+        out[7] = (uint8_t)(synth_next(rng) % 13);
+        out[8] = 0x00;
+        fill(rng, out + 9, 16);
+        return 25;
+    case CONTINUITY_TYPE_HEY_SIRI:
+        fill(rng, out, 2);
+        out[2] = (uint8_t)(synth_next(rng) % 64);
+        out[3] = PICK(rng, wrist_confidence);
+        out[4] = 0x00;
+        out[5] = PICK(rng, siri_classes);
+        out[6] = (uint8_t)synth_next(rng);
+        return 7;
+    case CONTINUITY_TYPE_AIRPLAY_TARGET:
+        out[0] = 0x03;
+        out[1] = (uint8_t)synth_next(rng);
+        out[2] = 192;
+        out[3] = 168;
+        fill(rng, out + 4, 2);
+        return 6;
+    case CONTINUITY_TYPE_AIRPLAY_SOURCE:
+        out[0] = 0x00;
+        return 1;
+    case CONTINUITY_TYPE_MAGIC_SWITCH:
+        fill(rng, out, 2);
+        out[2] = PICK(rng, wrist_confidence);
+        return 3;
+    case CONTINUITY_TYPE_HANDOFF:
+        out[0] = (uint8_t)(synth_next(rng) % 5 == 0 ? 0x08 : 0x00);
+        fill(rng, out + 1, 13);
+        return 14;
+    case CONTINUITY_TYPE_TETHERING_TARGET:
+        fill(rng, out, 4);
+        return 4;
+    case CONTINUITY_TYPE_TETHERING_SOURCE:
+        out[0] = 0x01;
+        out[1] = 0x00;
+        out[2] = (uint8_t)(synth_next(rng) % 101);
+        out[3] = 0x00;
+        out[4] = (uint8_t)(synth_next(rng) % 8);
+        out[5] = (uint8_t)(synth_next(rng) % 5);
+        return 6;
+    case CONTINUITY_TYPE_NEARBY_ACTION:
+        switch (synth_next(rng) % 4) {
+        case 0:
+            /* Short form */
+            fill(rng, out, 2);
+            return 2;
+        case 1:
+            /* Wi-Fi Password with auth tag */
+            out[0] = 0x80 | (uint8_t)(synth_next(rng) & 0x1f);
+            out[1] = CONTINUITY_NEARBY_ACTION_WIFI_PASSWORD;
+            fill(rng, out + 2, 3 + 12);
+            return 17;
+        case 2:
+            /* iOS Setup with auth tag */
+            out[0] = 0x80 | (uint8_t)(synth_next(rng) & 0x1f);
+            out[1] = CONTINUITY_NEARBY_ACTION_IOS_SETUP;
+            fill(rng, out + 2, 3);
+            out[5] = (uint8_t)(PICK(rng, setup_classes) << 4 | synth_next(rng) % 4);
+            out[6] = (uint8_t)(synth_next(rng) % 10);
+            out[7] = 0x10;
+            return 8;
+        default:
+            /* Other action types, raw parameters */
+            len = 2 + synth_next(rng) % 4;
+            out[0] = (uint8_t)(synth_next(rng) & 0x1f);
+            out[1] = PICK(rng, nearbyaction_types);
+            fill(rng, out + 2, len - 2);
+            return len;
+        }
+    case CONTINUITY_TYPE_NEARBY_INFO:
+        out[0] = (uint8_t)((synth_next(rng) & 0x30) | synth_next(rng) % 16);
+        out[1] = (uint8_t)synth_next(rng);
+        /* Auth tag of 3 or 4 bytes when flagged, then up to 3 bytes after it */
+        len = 2;
+        if (out[1] & 0x10)
+            len += (out[1] & 0x02) ? 4 : 3;
+        len += synth_next(rng) % 4;
+        fill(rng, out + 2, len - 2);
+        return len;
+    case CONTINUITY_TYPE_FINDMY:
+        out[0] = PICK(rng, findmy_status);
+        if (synth_next(rng) % 4 == 0) {
+            out[1] = (uint8_t)(synth_next(rng) & 0x03);
+            return CONTINUITY_FINDMY_SHORT_LEN;
+        }
+        fill(rng, out + 1, 22);
+        out[23] = (uint8_t)(synth_next(rng) & 0x03);
+        out[24] = (uint8_t)synth_next(rng);
+        return CONTINUITY_FINDMY_FULL_LEN;
+    default:
+        return 0;
+    }
+}
+
+size_t
+synth_payload(const uint8_t *types, size_t n, synth_rng_t *rng,
+        uint8_t *out, size_t cap)
+{
+    uint8_t     value[SYNTH_MAX_VALUE_LEN];
+    size_t      len = 0;
+    size_t      i;
+
+    for (i = 0; i < n; i++) {
+        size_t  value_len = synth_value(types[i], rng, value);
+
+        if (len + 2 + value_len > cap)
+            break;
+        out[len]     = types[i];
+        out[len + 1] = (uint8_t)value_len;
+        memcpy(out + len + 2, value, value_len);
+        len += 2 + value_len;
+    }
+
+    return len;
+}
+
+void
+synth_addr(synth_rng_t *rng, uint8_t addr[6])
+{
+    uint32_t    r = synth_next(rng);
+
+    addr[0] = (uint8_t)((r & 0x3f) | ((r & 0x100) ? 0xc0 : 0x40));
+    addr[1] = (uint8_t)(r >> 16);
+    addr[2] = (uint8_t)(r >> 24);
+    fill(rng, addr + 3, 3);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,74 @@
+/* synth.h
+ * Synthetic Apple Continuity messages
+ *
+ * Builds well-formed TLVs for every message type the dissector decodes
+ * (AirPrint through Find My), with field values drawn from the ranges
+ * documented under messages/.  Used by the benchmark and the traffic
+ * generator.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __SYNTH_H__
+#define __SYNTH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "continuity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of entries in synth_types */
+#define SYNTH_TYPE_COUNT        14
+
+/* Longest value synth_value() writes */
+#define SYNTH_MAX_VALUE_LEN     32
+
+/* Message types 3 and 5-16 and 18, in type order */
+extern const uint8_t synth_types[SYNTH_TYPE_COUNT];
+
+/* xorshift64*; any seed but 0 */
+typedef struct {
+    uint64_t    state;
+} synth_rng_t;
+
+void synth_seed(synth_rng_t *rng, uint64_t seed);
+uint32_t synth_next(synth_rng_t *rng);
+
+/* Write one well-formed value of the given type to out, which must hold
+ * SYNTH_MAX_VALUE_LEN bytes.  Variable-length types vary their length and
+ * form from call to call.  Returns the value length, or 0 for a type with no
+ * known layout. */
+size_t synth_value(uint8_t type, synth_rng_t *rng, uint8_t *out);
+
+/* Append the TLVs of the n given types to out as one Apple payload (no
+ * company identifier).  Stops before a TLV that would not fit in cap.
+ * Returns the payload length. */
+size_t synth_payload(const uint8_t *types, size_t n, synth_rng_t *rng,
+        uint8_t *out, size_t cap);
+
+/* A random advertiser address, most significant byte first.  Half are
+ * resolvable private (top bits 01), the rest static random (top bits 11). */
+void synth_addr(synth_rng_t *rng, uint8_t addr[6]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYNTH_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */